@@ -0,0 +1,143 @@
+#!/bin/bash
+#
+# amr.sh
+#
+# Time to solution and accuracy of block-structured refinement (AMR = 1,
+# amr.cpp) against a uniform grid at the fine spacing, on one of the
+# examples (default examples/Fig.7(4), a dendrite growing from a small seed
+# into a melt that stays quiescent far from it). The AMR run takes the
+# example at twice its spacing, with half the interior cells per axis; the
+# uniform run keeps the example's spacing. Both seeds are given in coarse
+# cells and doubled for the uniform run, so the two start from the same
+# shape. A third run on the coarse grid alone shows what the refinement
+# recovers. All runs take STEPS steps with output every INTERVAL steps.
+# Reported per interval: the share of blocks refined, the share of the
+# fine-grid cell updates done, seconds, and the speedup over the mean
+# throughput of the uniform run; then the whole run, and the solid
+# fraction and largest phi difference of the AMR and coarse runs from the
+# uniform result, both on the fine grid.
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/amr.sh [example]
+#   benchmarks/amr.sh "Fig.6(6)"
+#
+# Step count, output interval, block size, tolerances and thread count can
+# be set through the environment (INTERVAL must divide STEPS):
+#   STEPS=4000 INTERVAL=1000 AMR_BLOCK=8 AMR_PHI_TOL=1e-3 AMR_GRAD_TOL=1e-2 THREADS=4 benchmarks/amr.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+EXAMPLE=${1:-Fig.7(4)}
+STEPS=${STEPS:-2000}
+INTERVAL=${INTERVAL:-500}
+AMR_BLOCK=${AMR_BLOCK:-8}
+AMR_PHI_TOL=${AMR_PHI_TOL:-1e-3}
+AMR_GRAD_TOL=${AMR_GRAD_TOL:-1e-2}
+THREADS=${THREADS:-1}
+IN="$ROOT/examples/$EXAMPLE/outfile.in"
+
+requireBinary
+requireFile "$IN"
+requireDivides
+for key in Num_X Num_Y Num_Z; do
+    n=$(sed -n -e "s/^$key *= *\([0-9]*\).*/\1/p" "$IN")
+    if [ -n "$n" ] && [ $(((n - 2) % 2)) -ne 0 ]; then
+        echo "Error: $key = $n has an odd number of interior cells." >&2
+        exit 1
+    fi
+done
+
+# Example geometry at the given refinement (1 = coarse, 2 = the example's
+# spacing): cell counts and spacings from the example, seed positions and
+# sizes rounded to coarse cells
+geometry() {
+    awk -v r="$1" -F'[=,;]' '
+        /^Num_[XYZ]/ { n = $2 + 0; printf "%s= %d\n", $1, (n - 2) / 2 * r + 2; next }
+        /^d[xyz] /   { printf "%s= %g\n", $1, $2 * 2 / r; next }
+        /^Fill_Sphere|^Fill_Cube/ {
+            printf "%s=%s,%s", $1, $2, $3
+            for (i = 4; i <= NF; ++i) if ($i != "") printf ",%d", int($i / 2 + 0.5) * r
+            printf ";\n"; next
+        }
+        /^Fill/ { print; next }' "$IN"
+}
+
+# Input at the given refinement with the step counts, followed by extra
+# lines; boundaries precede the fills
+makeInput() {
+    local r=$1
+    shift
+    grep -v "^total_steps\|^timebreak\|^WRITE\|^Fill\|^boundary\|^theta_0\|^Num_\|^d[xyz] " "$IN"
+    geometry "$r" | grep -v "^Fill"
+    grep "^boundary" "$IN"
+    geometry "$r" | grep "^Fill"
+    echo "theta_0 = 0"
+    echo "total_steps = $STEPS"
+    echo "timebreak = $INTERVAL"
+    echo "WRITE_TO_VTK = 1"
+    echo "NUM_THREADS = $THREADS"
+    for line in "$@"; do echo "$line"; done
+}
+
+# Solid fraction (phi > 1/2) and maximum difference of two VTK files, over
+# the values after LOOKUP_TABLE
+vtkcompare() {
+    awk 'FNR == 1 { f++; on = 0 }
+         on { v[f, FNR - start] = $1; n[f] = FNR - start; if ($1 > 0.5) s[f]++ }
+         /^LOOKUP_TABLE/ { on = 1; start = FNR }
+         END {
+             if (n[1] != n[2] || n[1] == 0) { printf "mismatch"; exit }
+             for (i = 1; i <= n[1]; ++i) {
+                 d = v[1, i] - v[2, i]; if (d < 0) d = -d
+                 if (d > m) m = d
+             }
+             printf "solid fraction %.5f (uniform %.5f), largest phi difference %.3e", s[1] / n[1], s[2] / n[2], m
+         }' "$1" "$2"
+}
+
+# Coarse field on the fine grid: every coarse cell becomes 2^DIM fine cells
+upsample() {
+    awk 'on { v[c++] = $1; next }
+         /^DIMENSIONS/ { nx = $2; ny = $3; nz = $4; fz = (nz > 1) ? 2 : 1
+                         $2 = 2 * nx; $3 = 2 * ny; $4 = fz * nz }
+         /^POINT_DATA/ { $2 = 4 * fz * nx * ny * nz }
+         /^LOOKUP_TABLE/ { on = 1 }
+         { print }
+         END {
+             for (k = 0; k < nz * fz; ++k)
+                 for (j = 0; j < ny * 2; ++j)
+                     for (i = 0; i < nx * 2; ++i)
+                         print v[(int(k / fz) * ny + int(j / 2)) * nx + int(i / 2)]
+         }' "$1"
+}
+
+{
+    echo "AMR vs uniform fine grid: $EXAMPLE, $STEPS steps, output every $INTERVAL, AMR_BLOCK = $AMR_BLOCK, AMR_PHI_TOL = $AMR_PHI_TOL, AMR_GRAD_TOL = $AMR_GRAD_TOL, $THREADS thread(s)"
+    printf "%-16s %14s %14s %10s %9s\n" steps "refined" "fine updates" "time [s]" speedup
+} | tee "$REPORT"
+
+set -- $(run uniform 2)
+FINE_SECS=${1:-0}
+FINE_RATE=${2:-0}
+set -- $(run coarse 1)
+COARSE_SECS=${1:-0}
+set -- $(run amr 1 "AMR = 1" "AMR_BLOCK = $AMR_BLOCK" "AMR_PHI_TOL = $AMR_PHI_TOL" "AMR_GRAD_TOL = $AMR_GRAD_TOL")
+AMR_SECS=${1:-0}
+
+# AMR, steps a-b: x% of the blocks refined, y% of the fine-grid cell updates, s s, r Mcell-updates/s
+grep "^AMR, steps" "$WORK/amr/log.txt" |
+    sed -e 's/^AMR, steps \([0-9-]*\): \([0-9.]*\)% of the blocks refined, \([0-9.]*\)% of the fine-grid cell updates, \([0-9.]*\) s, \([0-9.]*\) Mcell.*/\1 \2 \3 \4 \5/' |
+    awk -v f="$FINE_RATE" '{ printf "%-16s %13.2f%% %13.2f%% %10.3f %9.2f\n", $1, $2, $3, $4, (f > 0) ? $5 / f : 0 }' | tee -a "$REPORT"
+
+MEAN=$(grep "^AMR: .* over" "$WORK/amr/log.txt" | sed -e 's/^AMR: \([0-9.]*\)% of the blocks refined and \([0-9.]*\)% of the fine-grid.*/\1 \2/')
+set -- $MEAN
+awk -v s="1-$STEPS" -v p="$1" -v q="$2" -v t="$AMR_SECS" -v b="$FINE_SECS" \
+    'BEGIN { printf "%-16s %13.2f%% %13.2f%% %10.3f %9.2f\n", s, p, q, t, (t > 0) ? b / t : 0 }' | tee -a "$REPORT"
+upsample "$WORK/coarse/output/phi_$STEPS.vtk" > "$WORK/coarse/phi_up.vtk"
+{
+    echo "Uniform fine grid: $FINE_SECS s; coarse grid alone: $COARSE_SECS s"
+    echo "AMR at step $STEPS: $(vtkcompare "$WORK/amr/output/phi_fine_$STEPS.vtk" "$WORK/uniform/output/phi_$STEPS.vtk")"
+    echo "Coarse at step $STEPS: $(vtkcompare "$WORK/coarse/phi_up.vtk" "$WORK/uniform/output/phi_$STEPS.vtk")"
+} | tee -a "$REPORT"
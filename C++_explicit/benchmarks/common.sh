@@ -0,0 +1,108 @@
+#!/bin/bash
+#
+# common.sh
+#
+# Shared parts of the benchmark scripts, sourced by each of them:
+#   . "$(dirname "$0")/common.sh"
+#
+#  - ROOT, BIN: the C++_explicit directory and the solver built by make
+#  - WORK: a temporary work directory, removed when the script exits
+#  - REPORT: file the report is written to. The report is always printed;
+#    set REPORT to keep a copy, e.g. REPORT=scaling.txt benchmarks/strong_scaling.sh.
+#    By default it goes to the work directory and is removed with it.
+#  - requireBinary, requireFile, requireDivides: argument checks
+#  - buildCopy: build the solver with other make options in a copy of the sources
+#  - exampleInput: input from an example with the step counts and extra lines
+#  - run: run one case in the work directory, with the caller's makeInput
+#  - vtkdiff: largest difference of two VTK files
+
+ROOT=$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)
+BIN="$ROOT/src/simulation"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+REPORT=${REPORT:-$WORK/report.txt}
+
+# Stop unless make has built the solver
+requireBinary() {
+    if [ ! -x "$BIN" ]; then
+        echo "Error: $BIN not found; run make first." >&2
+        exit 1
+    fi
+}
+
+# Stop unless file $1 exists
+requireFile() {
+    if [ ! -f "$1" ]; then
+        echo "Error: $1 not found." >&2
+        exit 1
+    fi
+}
+
+# Stop unless the output interval INTERVAL divides STEPS
+requireDivides() {
+    if [ $((STEPS % INTERVAL)) -ne 0 ]; then
+        echo "Error: INTERVAL = $INTERVAL does not divide STEPS = $STEPS." >&2
+        exit 1
+    fi
+}
+
+# Build the solver with the given make options in a copy of the sources in
+# directory $1 (the build in src/ is left alone); stops if the build fails
+buildCopy() {
+    local dir=$1
+    shift
+    mkdir -p "$dir"
+    cp -r "$ROOT/src" "$ROOT/Makefile" "$dir/"
+    make -C "$dir" clean > /dev/null
+    if ! make -C "$dir" "$@" > "$dir/build.log" 2>&1; then
+        echo "Error: make $* failed, see below." >&2
+        cat "$dir/build.log" >&2
+        exit 1
+    fi
+}
+
+# Input from example file $1 with STEPS steps, output every INTERVAL steps
+# and THREADS threads, followed by the extra lines. The example files
+# predate the current reader: boundaries are moved before the fills and
+# theta_0, which they do not record, is supplied.
+exampleInput() {
+    local in=$1
+    shift
+    grep -v "^total_steps\|^timebreak\|^WRITE\|^Fill\|^boundary\|^theta_0" "$in"
+    grep "^boundary" "$in"
+    grep "^Fill" "$in"
+    echo "theta_0 = 0"
+    echo "total_steps = $STEPS"
+    echo "timebreak = $INTERVAL"
+    echo "WRITE_TO_VTK = 1"
+    echo "NUM_THREADS = $THREADS"
+    for line in "$@"; do echo "$line"; done
+}
+
+# Run case $1 in $WORK/$1 on the input printed by the script's makeInput with
+# the other arguments (the terminating semicolons are added); the solver
+# output goes to log.txt. Prints the time-loop seconds and Mcell-updates/s.
+run() {
+    local dir="$WORK/$1"
+    shift
+    mkdir -p "$dir"
+    makeInput "$@" | sed -e 's/[^;]$/&;/' > "$dir/input.in"
+    (cd "$dir" && "$BIN" input.in > log.txt 2>&1)
+    grep "^Time loop" "$dir/log.txt" | awk '{ print $3, $(NF - 1) }'
+}
+
+# Maximum difference of two VTK files, over the values after LOOKUP_TABLE
+vtkdiff() {
+    awk 'FNR == 1 { f++; on = 0 }
+         on { v[f, FNR - start] = $1; n[f] = FNR - start }
+         /^LOOKUP_TABLE/ { on = 1; start = FNR }
+         END {
+             if (n[1] != n[2] || n[1] == 0) { printf "mismatch"; exit }
+             for (i = 1; i <= n[1]; ++i) {
+                 d = v[1, i] - v[2, i]; if (d < 0) d = -d
+                 if (d > m) m = d
+             }
+             printf "%.3e", m
+         }' "$1" "$2"
+}
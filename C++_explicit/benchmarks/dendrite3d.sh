@@ -0,0 +1,57 @@
+#!/bin/bash
+#
+# dendrite3d.sh
+#
+# Throughput of the 3D phase-field solver (cubic anisotropy kernel,
+# phasefield_cubic.cpp) on benchmarks/dendrite3d.in: a seed growing in a
+# 128^3 domain. The time loop is run without output for each thread count
+# and its cell updates per second are compared with the target.
+#
+# Target: 12 Mcell-updates/s per thread for the default build (double,
+# SIMD=sse2). Reference single-core results for this input, 100 steps:
+#   make                      14.5 Mcell-updates/s (MATH_MODE = LIBM)
+#                             15.2 Mcell-updates/s (MATH_MODE = VECTOR)
+#   make SIMD=avx512          29.9 Mcell-updates/s (MATH_MODE = VECTOR)
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/dendrite3d.sh [thread counts...]
+#   benchmarks/dendrite3d.sh 1 2 4 8
+#
+# The step count, grid size and target can be changed through the environment:
+#   STEPS=50 N=256 TARGET=25 benchmarks/dendrite3d.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+IN="$ROOT/benchmarks/dendrite3d.in"
+THREADS=${@:-1}
+STEPS=${STEPS:-100}
+N=${N:-128}
+TARGET=${TARGET:-12}
+
+requireBinary
+
+{
+    echo "3D dendrite: $N^3 interior cells, $STEPS steps, target $TARGET Mcell-updates/s per thread"
+    printf "%8s %12s %14s %14s %10s\n" threads "time [s]" "Mcell-upd/s" "target" result
+} | tee "$REPORT"
+
+for T in $THREADS; do
+    DIR="$WORK/t$T"
+    mkdir -p "$DIR"
+    C=$((N / 2 + 1))
+    # No output inside the time loop
+    sed -e "s/^Num_X.*/Num_X = $((N + 2));/" \
+        -e "s/^Num_Y.*/Num_Y = $((N + 2));/" \
+        -e "s/^Num_Z.*/Num_Z = $((N + 2));/" \
+        -e "s/^Fill_Sphere.*/Fill_Sphere = phi,1.0,8,$C,$C,$C;/" \
+        -e "s/^total_steps.*/total_steps = $STEPS;/" \
+        -e "s/^timebreak.*/timebreak = $((STEPS + 1));/" "$IN" > "$DIR/input.in"
+    echo "NUM_THREADS = $T;" >> "$DIR/input.in"
+    RATE=$(cd "$DIR" && "$BIN" input.in 2> /dev/null | grep "^Time loop")
+    SECS=$(echo "$RATE" | awk '{print $3}')
+    MCPS=$(echo "$RATE" | awk '{print $(NF-1)}')
+    awk -v t="$T" -v s="$SECS" -v m="$MCPS" -v g="$TARGET" \
+        'BEGIN { printf "%8d %12.3f %14.2f %14.2f %10s\n", t, s, m, g * t, (m >= g * t) ? "met" : "BELOW" }' | tee -a "$REPORT"
+done
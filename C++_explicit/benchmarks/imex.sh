@@ -0,0 +1,141 @@
+#!/bin/bash
+#
+# imex.sh
+#
+# Convergence in dt of the IMEX phase-field step (PHI_SOLVER = IMEX,
+# multigrid.cpp) against explicit stepping on the examples/Fig.5(x) setups:
+# a planar solid slab growing into an undercooled melt, NOFLUX faces. Each
+# setup is run with the noise switched off (a = 0, so runs with different dt
+# are comparable) and optionally refined REFINE times per axis. A reference
+# run takes STEPS explicit steps of the example's dt = 1e-5; the other runs
+# reach the same end time with dt that many times larger, explicitly and with
+# PHI_SOLVER = IMEX plus TEMP_SOLVER = MULTIGRID. A run is skipped when its
+# dt exceeds the stability limit of its scheme (stableTimestep in
+# timestep.cpp): min(dx^2/4, 2 tau / (8 D / dx^2 + L)) explicitly, the
+# reaction limit 2 tau / L with IMEX. Reported per run: steps, time-loop
+# seconds, speedup over the reference, the error of the mean front position
+# (sum of phi / Ny times dx) against the reference, absolute and as a share
+# of the front displacement, the largest phi difference, and the phi
+# V-cycles per step.
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/imex.sh [dt multiples...]
+#   benchmarks/imex.sh 5 10 20 40
+#
+# Setups, refinement, reference step count and thread count can be set
+# through the environment (STEPS must be divisible by every multiple):
+#   FIGS="4" REFINE=2 STEPS=2000 THREADS=4 benchmarks/imex.sh 5 10 20
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+MULTIPLES=${@:-5 10 20 40}
+FIGS=${FIGS:-2 4 6}
+REFINE=${REFINE:-1}
+STEPS=${STEPS:-3000}
+THREADS=${THREADS:-1}
+DT=1e-5
+
+requireBinary
+
+# Value of a key in an example input
+key() {
+    awk -F'= *' -v k="$2" '$1 ~ "^" k " *$" { v = $2; sub(/;.*/, "", v); print v }' "$1"
+}
+
+# Input from example file $1 with dt $2, step count $3, followed by extra lines.
+# Boundaries precede the fills, grid counts and Fill_Cube indices are refined.
+makeInput() {
+    local in=$1 dt=$2 steps=$3
+    shift 3
+    grep -v "^dt\|^total_steps\|^timebreak\|^a =\|^WRITE\|^Fill\|^boundary\|^Num_\|^d[xyz] " "$in"
+    awk -v r="$REFINE" -F'= *' '/^Num_/ { v = $2; sub(/;.*/, "", v); printf "%s= %d\n", $1, (v - 2) * r + 2 }
+                               /^d[xyz] / { v = $2; sub(/;.*/, "", v); printf "%s= %.10g\n", $1, v / r }' "$in"
+    grep "^boundary" "$in"
+    awk -v r="$REFINE" -F, '/^Fill_Cube/ {
+                               printf "%s,%s", $1, $2
+                               for (i = 3; i <= NF; ++i) { v = $i; sub(/;.*/, "", v); printf ",%d", v * r }
+                               print ""
+                           }
+                           /^Fill_Constant/' "$in"
+    echo "a = 0"
+    echo "theta_0 = 0"
+    echo "dt = $dt"
+    echo "total_steps = $steps"
+    echo "timebreak = $steps"
+    echo "WRITE_TO_VTK = 1"
+    echo "NUM_THREADS = $THREADS"
+    for line in "$@"; do echo "$line"; done
+}
+
+# Mean front position of a phi VTK file: sum of phi / Ny times dx
+vtkfront() {
+    awk -v ny="$2" -v dx="$3" 'on { s += $1 } /^LOOKUP_TABLE/ { on = 1 } END { printf "%.6f", s / ny * dx }' "$1"
+}
+
+# Phi V-cycles per step of case $1
+vCycles() {
+    local cyc=$(grep "^Multigrid phi" "$WORK/$1/log.txt" | sed -e 's/.*), \([0-9.]*\) V-cycles per step.*/\1/')
+    echo "${cyc:--}"
+}
+
+{
+    echo "IMEX vs explicit phase field: Fig.5(${FIGS// /,}), refined ${REFINE}x, noise off, end time $STEPS steps of $DT, $THREADS thread(s)"
+    printf "%-8s %-20s %7s %10s %8s %12s %9s %13s %9s\n" setup solver steps "time [s]" speedup "front error" "of shift" "phi max diff" "V-cycles"
+} | tee "$REPORT"
+
+for F in $FIGS; do
+    IN="$ROOT/examples/Fig.5($F)/outfile.in"
+    if [ ! -f "$IN" ]; then
+        echo "Warning: $IN not found, skipped." >&2
+        continue
+    fi
+    DX=$(awk -v d="$(key "$IN" dx)" -v r="$REFINE" 'BEGIN { printf "%.10g", d / r }')
+    NY=$(( ($(key "$IN" Num_Y) - 2) * REFINE ))
+    # Stability limits of the 2D setups (phiStiffnessBounds, stableTimestep)
+    read EXLIM IMLIM <<< $(awk -v dx="$DX" -v e="$(key "$IN" epsilon)" -v tau="$(key "$IN" tau)" \
+        -v d="$(key "$IN" delta)" -v j="$(key "$IN" j)" -v al="$(key "$IN" alpha)" 'BEGIN {
+            if (d < 0) d = -d; if (j < 0) j = -j; if (al < 0) al = -al
+            D = e * e * (1 + d) * (1 + d + j * d); L = 0.75 + 0.5 * al
+            p = 2 * tau / (8 * D / (dx * dx) + L); t = dx * dx / 4
+            print (p < t) ? p : t, 2 * tau / L
+        }')
+
+    set -- $(run "ref_$F" "$IN" "$DT" "$STEPS")
+    BASE=${1:-0}
+    REF="$WORK/ref_$F/output"
+    START=$(vtkfront "$REF/phi_0.vtk" "$NY" "$DX")
+    FRONT=$(vtkfront "$REF/phi_$STEPS.vtk" "$NY" "$DX")
+    printf "%-8s %-20s %7d %10.3f %8.2f %12s %9s %13s %9s\n" "Fig.5($F)" "explicit (ref)" "$STEPS" "$BASE" 1 - - - - | tee -a "$REPORT"
+
+    for M in $MULTIPLES; do
+        if [ $((STEPS % M)) -ne 0 ]; then
+            echo "Warning: $STEPS steps are not divisible by $M, skipped." >&2
+            continue
+        fi
+        S=$((STEPS / M))
+        MDT=$(awk -v d="$DT" -v m="$M" 'BEGIN { printf "%.10g", d * m }')
+        for SOLVER in explicit imex; do
+            if [ "$SOLVER" = explicit ]; then
+                LIM=$EXLIM; LABEL="explicit ${M}x dt"; set --
+            else
+                LIM=$IMLIM; LABEL="IMEX ${M}x dt"; set -- "PHI_SOLVER = IMEX" "TEMP_SOLVER = MULTIGRID"
+            fi
+            if awk -v d="$MDT" -v l="$LIM" 'BEGIN { exit !(d > l) }'; then
+                printf "%-8s %-20s %7d %10s   above the stability limit %.3g\n" "Fig.5($F)" "$LABEL" "$S" - "$LIM" | tee -a "$REPORT"
+                continue
+            fi
+            NAME="${SOLVER}_${F}_$M"
+            set -- $(run "$NAME" "$IN" "$MDT" "$S" "$@")
+            SECS=${1:-0}
+            OUT="$WORK/$NAME/output/phi_$S.vtk"
+            DIFF=$(vtkdiff "$REF/phi_$STEPS.vtk" "$OUT")
+            POS=$(vtkfront "$OUT" "$NY" "$DX")
+            awk -v f="Fig.5($F)" -v l="$LABEL" -v s="$S" -v t="$SECS" -v c="$(vCycles "$NAME")" -v b="$BASE" -v d="$DIFF" \
+                -v p="$POS" -v r="$FRONT" -v s0="$START" \
+                'BEGIN { e = p - r; printf "%-8s %-20s %7d %10.3f %8.2f %12.3e %8.2f%% %13s %9s\n",
+                         f, l, s, t, (t > 0) ? b / t : 0, e, (r != s0) ? 100 * e / (r - s0) : 0, d, c }' | tee -a "$REPORT"
+        done
+    done
+done
@@ -0,0 +1,91 @@
+#!/bin/bash
+#
+# lts.sh
+#
+# Cell updates saved by local time stepping (LTS = 1, local_timestep.cpp)
+# on one of the examples (default examples/Fig.6(6), a solid slab growing
+# into an undercooled melt, where the melt far from the front and the
+# solid behind it change slowly), against the same example stepped by dt
+# everywhere. Both runs take STEPS steps with output every INTERVAL steps.
+# Reported per interval: the share of the cell updates saved, the share of
+# the tiles at each level, seconds, and the speedup over the mean
+# throughput of the plain run; then the whole run, the largest phi and temp
+# differences of the final fields, and the total enthalpy sum(temp - K phi)
+# of both runs at the start and the end, which the flux registers keep
+# constant across the tiles of different levels (up to the rounding of
+# the output values).
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/lts.sh [example]
+#   benchmarks/lts.sh "Fig.7(4)"
+#
+# Step count, output interval, levels, tolerance, tile size and thread
+# count can be set through the environment (INTERVAL must divide STEPS):
+#   STEPS=40000 INTERVAL=10000 LTS_LEVELS=5 LTS_TOL=1e-4 TILE_SIZE=16 THREADS=4 benchmarks/lts.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+EXAMPLE=${1:-Fig.6(6)}
+STEPS=${STEPS:-20000}
+INTERVAL=${INTERVAL:-5000}
+LTS_LEVELS=${LTS_LEVELS:-4}
+LTS_TOL=${LTS_TOL:-1e-4}
+TILE_SIZE=${TILE_SIZE:-16}
+THREADS=${THREADS:-1}
+IN="$ROOT/examples/$EXAMPLE/outfile.in"
+
+requireBinary
+requireFile "$IN"
+requireDivides
+K=$(sed -n -e 's/^K *= *\([-0-9.eE+]*\).*/\1/p' "$IN")
+
+# Input from the example with the step counts, followed by extra lines
+makeInput() {
+    exampleInput "$IN" "$@"
+}
+
+# Total enthalpy sum(temp - K phi) of a phi and a temp VTK file
+enthalpy() {
+    awk -v k="$K" 'FNR == 1 { f++; on = 0 }
+         on { if (f == 1) h -= k * $1; else h += $1 }
+         /^LOOKUP_TABLE/ { on = 1 }
+         END { printf "%.8f", h }' "$1" "$2"
+}
+
+{
+    echo "Local time stepping vs dt everywhere: $EXAMPLE, $STEPS steps, output every $INTERVAL, LTS_LEVELS = $LTS_LEVELS, LTS_TOL = $LTS_TOL, TILE_SIZE = $TILE_SIZE, $THREADS thread(s)"
+    printf "%-14s %8s %10s %9s  %s\n" steps saved "time [s]" speedup "tiles per step of 1, 2, 4, ... dt"
+} | tee "$REPORT"
+
+set -- $(run plain)
+PLAIN_SECS=${1:-0}
+PLAIN_RATE=${2:-0}
+set -- $(run lts "LTS = 1" "LTS_LEVELS = $LTS_LEVELS" "LTS_TOL = $LTS_TOL" "TILE_SIZE = $TILE_SIZE")
+LTS_SECS=${1:-0}
+
+# Local time stepping, steps a-b: x% of the cell updates saved, s s, r Mcell-updates/s
+#   tiles stepping by 1 dt: p%, 2 dt: q%, ...
+grep -A1 "^Local time stepping, steps" "$WORK/lts/log.txt" |
+    awk -v f="$PLAIN_RATE" '
+        /^Local time stepping, steps/ {
+            s = $5; sub(/:$/, "", s); saved = $6; sub(/%$/, "", saved)
+            secs = $(NF - 3); rate = $(NF - 1)
+            next
+        }
+        /tiles stepping by/ {
+            line = $0; sub(/^ *tiles stepping by /, "", line); gsub(/ *[0-9]+ dt: /, " ", line)
+            printf "%-14s %7.2f%% %10.3f %9.2f %s\n", s, saved, secs, (f > 0) ? rate / f : 0, line
+        }' | tee -a "$REPORT"
+
+SAVED=$(sed -n -e 's/^Local time stepping: \([0-9.]*\)% of the cell updates saved over.*/\1/p' "$WORK/lts/log.txt")
+p="$WORK/plain/output"
+l="$WORK/lts/output"
+{
+    awk -v s="1-$STEPS" -v q="${SAVED:-0}" -v t="$LTS_SECS" -v b="$PLAIN_SECS" \
+        'BEGIN { printf "%-14s %7.2f%% %10.3f %9.2f\n", s, q, t, (t > 0) ? b / t : 0 }'
+    echo "dt everywhere: $PLAIN_SECS s"
+    echo "Largest difference at step $STEPS: phi $(vtkdiff "$l/phi_$STEPS.vtk" "$p/phi_$STEPS.vtk"), temp $(vtkdiff "$l/temp_$STEPS.vtk" "$p/temp_$STEPS.vtk")"
+    echo "sum(temp - K phi), step 0 -> $STEPS: dt everywhere $(enthalpy "$p/phi_0.vtk" "$p/temp_0.vtk") -> $(enthalpy "$p/phi_$STEPS.vtk" "$p/temp_$STEPS.vtk"), LTS $(enthalpy "$l/phi_0.vtk" "$l/temp_0.vtk") -> $(enthalpy "$l/phi_$STEPS.vtk" "$l/temp_$STEPS.vtk")"
+} | tee -a "$REPORT"
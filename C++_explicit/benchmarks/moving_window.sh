@@ -0,0 +1,100 @@
+#!/bin/bash
+#
+# moving_window.sh
+#
+# Directional growth in a moving window (MOVING_WINDOW = 1,
+# moving_window.cpp) against a fixed domain long enough to hold the same
+# growth, on the input file of the repository (input.in: a solid slab at
+# -x growing into the melt along +x). The window has WIDTH x cells, the
+# fixed domain LENGTH; both take STEPS steps with output every INTERVAL
+# steps. Reported per output: the offset of the window, the leading solid
+# column (phi > 1/2) of both runs in global columns, and the largest
+# differences of phi and temp between the window and the same columns of
+# the fixed domain; then the time of both runs.
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/moving_window.sh
+#
+# Window and domain widths, trigger, step count, output interval and
+# thread count can be set through the environment (INTERVAL must divide
+# STEPS):
+#   WIDTH=300 LENGTH=600 TRIGGER=0.4 STEPS=20000 INTERVAL=5000 THREADS=4 benchmarks/moving_window.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+IN="$ROOT/input.in"
+WIDTH=${WIDTH:-300}
+LENGTH=${LENGTH:-600}
+TRIGGER=${TRIGGER:-0.4}
+STEPS=${STEPS:-10000}
+INTERVAL=${INTERVAL:-2000}
+THREADS=${THREADS:-1}
+
+requireBinary
+requireDivides
+
+# Input of the repository with Num_X and the step counts, followed by
+# extra lines
+makeInput() {
+    local nx=$1
+    shift
+    grep -v "^#\|^$\|^Num_X\|^total_steps\|^timebreak\|^WRITE\|^NUM_THREADS" "$IN"
+    echo "Num_X = $nx"
+    echo "total_steps = $STEPS"
+    echo "timebreak = $INTERVAL"
+    echo "WRITE_TO_VTK = 1"
+    echo "NUM_THREADS = $THREADS"
+    for line in "$@"; do echo "$line"; done
+}
+
+# Leading solid column (phi > 1/2) of a VTK file, shifted by an offset
+vtkfront() {
+    awk -v o="$2" '/^DIMENSIONS/ { nx = $2 }
+         on { i = n++ % nx; if ($1 > 0.5 && i > f) f = i }
+         /^LOOKUP_TABLE/ { on = 1; f = -1 }
+         END { print f + 1 + o }' "$1"
+}
+
+# Maximum difference between a window VTK file and the columns
+# offset + 1 .. offset + width of a fixed-domain one
+vtkwindowdiff() {
+    awk -v o="$3" 'FNR == 1 { f++; on = 0; n = 0 }
+         /^DIMENSIONS/ { nx[f] = $2 }
+         on { v[f, n++] = $1; if (f == 1) nw = n }
+         /^LOOKUP_TABLE/ { on = 1 }
+         END {
+             if (nw == 0 || nx[1] == 0) { printf "mismatch"; exit }
+             for (c = 0; c < nw; ++c) {
+                 j = int(c / nx[1]); i = c % nx[1]
+                 d = v[1, c] - v[2, j * nx[2] + i + o]; if (d < 0) d = -d
+                 if (d > m) m = d
+             }
+             printf "%.3e", m
+         }' "$1" "$2"
+}
+
+{
+    echo "Moving window vs fixed domain: input.in, window of $WIDTH and domain of $LENGTH x cells, WINDOW_TRIGGER = $TRIGGER, $STEPS steps, output every $INTERVAL, $THREADS thread(s)"
+    printf "%-8s %8s %14s %14s %12s %12s\n" step offset "front window" "front fixed" "phi diff" "temp diff"
+} | tee "$REPORT"
+
+set -- $(run window "$WIDTH" "MOVING_WINDOW = 1" "WINDOW_TRIGGER = $TRIGGER")
+WINDOW_SECS=$1
+set -- $(run fixed "$LENGTH")
+FIXED_SECS=$1
+
+for ((s = INTERVAL; s <= STEPS; s += INTERVAL)); do
+    o=$(awk -F, -v s="$s" '$1 == s { o = $2 } END { print o + 0 }' "$WORK/window/output/window.csv")
+    w="$WORK/window/output"
+    f="$WORK/fixed/output"
+    printf "%-8d %8d %14d %14d %12s %12s\n" "$s" "$o" \
+        "$(vtkfront "$w/phi_$s.vtk" "$o")" "$(vtkfront "$f/phi_$s.vtk" 0)" \
+        "$(vtkwindowdiff "$w/phi_$s.vtk" "$f/phi_$s.vtk" "$o")" \
+        "$(vtkwindowdiff "$w/temp_$s.vtk" "$f/temp_$s.vtk" "$o")" | tee -a "$REPORT"
+done
+{
+    grep "^Moving window: .* shift" "$WORK/window/log.txt"
+    echo "Window: ${WINDOW_SECS:-0} s; fixed domain: ${FIXED_SECS:-0} s"
+} | tee -a "$REPORT"
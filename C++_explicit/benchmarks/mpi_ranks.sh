@@ -0,0 +1,67 @@
+#!/bin/bash
+#
+# mpi_ranks.sh
+#
+# Domain decomposition across MPI ranks (make MPI=1, decomposition.cpp) on
+# the examples/Fig.7(4) configuration (300 x 300, j = 4). The MPI build is
+# made in a copy of the sources (the build in src/ is left alone), the
+# problem is run under mpirun with each rank count, and the final phi and
+# temp fields are compared byte for byte with the single-rank run, which
+# the decomposition reproduces exactly. Wall time and speedup come from the
+# "Time loop" line of rank 0.
+#
+# Usage (from C++_explicit):
+#   benchmarks/mpi_ranks.sh [steps] [rank counts...]
+#   benchmarks/mpi_ranks.sh 2000 1 2 4
+#
+# Threads per rank and extra mpirun options can be set through the
+# environment (more ranks than cores need --oversubscribe, the default):
+#   THREADS=2 MPIRUN_FLAGS="--oversubscribe --bind-to none" benchmarks/mpi_ranks.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+IN="$ROOT/examples/Fig.7(4)/outfile.in"
+STEPS=${1:-1000}
+shift
+RANKS=${@:-1 2 4}
+THREADS=${THREADS:-1}
+MPIRUN_FLAGS=${MPIRUN_FLAGS:---oversubscribe}
+# One output, at the last step
+INTERVAL=$STEPS
+
+if ! command -v mpirun > /dev/null || ! command -v mpicxx > /dev/null; then
+    echo "Error: mpirun and mpicxx are needed." >&2
+    exit 1
+fi
+# Open MPI refuses to run as root unless told otherwise
+[ "$(id -u)" = 0 ] && MPIRUN_FLAGS="$MPIRUN_FLAGS --allow-run-as-root"
+
+buildCopy "$WORK/mpi" MPI=1
+
+{
+    echo "MPI ranks: examples/Fig.7(4), $STEPS steps, $THREADS thread(s) per rank, $(nproc) core(s) available"
+    printf "%8s %12s %14s %10s %12s\n" ranks "time [s]" "Mcell-upd/s" speedup fields
+} | tee "$REPORT"
+
+BASE=""
+FIRST=""
+for N in $RANKS; do
+    RUN="$WORK/run_$N"
+    mkdir -p "$RUN"
+    exampleInput "$IN" | sed -e 's/[^;]$/&;/' > "$RUN/input.in"
+
+    LINE=$(cd "$RUN" && mpirun $MPIRUN_FLAGS -np "$N" "$WORK/mpi/src/simulation" input.in | grep "^Time loop")
+    SECS=$(echo "$LINE" | awk '{print $3}')
+    RATE=$(echo "$LINE" | awk -F', ' '{print $2}' | awk '{print $1}')
+    [ -z "$BASE" ] && BASE=$SECS
+    [ -z "$FIRST" ] && FIRST=$RUN
+
+    FIELDS=identical
+    for f in phi temp; do
+        cmp -s "$FIRST/output/${f}_$STEPS.vtk" "$RUN/output/${f}_$STEPS.vtk" || FIELDS=DIFFER
+    done
+    awk -v n="$N" -v s="$SECS" -v r="$RATE" -v b="$BASE" -v f="$FIELDS" \
+        'BEGIN { printf "%8d %12.3f %14.2f %10.2f %12s\n", n, s, r, b / s, f }' | tee -a "$REPORT"
+done
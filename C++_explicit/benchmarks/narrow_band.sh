@@ -0,0 +1,69 @@
+#!/bin/bash
+#
+# narrow_band.sh
+#
+# Time to solution of the narrow-band phase-field update (NARROW_BAND = 1,
+# narrow_band.cpp) against the full-grid update on one of the examples
+# (default examples/Fig.7(4), a dendrite growing from a small seed). Both
+# runs take STEPS steps with output every INTERVAL steps. The full-grid run
+# does the same work every step, so the speedup of each output interval is
+# the interval throughput of the band run over the mean throughput of the
+# full run. Reported per interval: the band's share of the cells, the phi
+# work saved (interior cells over band cells), seconds, and the speedup;
+# then the whole run, and the largest differences of the final phi and temp
+# from the full-grid result.
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/narrow_band.sh [example]
+#   benchmarks/narrow_band.sh "Fig.7(4)"
+#
+# Step count, output interval, band tolerance and margin, and thread count
+# can be set through the environment (INTERVAL must divide STEPS):
+#   STEPS=20000 INTERVAL=5000 NB_TOL=1e-6 NB_MARGIN=2 THREADS=4 benchmarks/narrow_band.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+EXAMPLE=${1:-Fig.7(4)}
+STEPS=${STEPS:-6000}
+INTERVAL=${INTERVAL:-2000}
+NB_TOL=${NB_TOL:-1e-6}
+NB_MARGIN=${NB_MARGIN:-2}
+THREADS=${THREADS:-1}
+IN="$ROOT/examples/$EXAMPLE/outfile.in"
+
+requireBinary
+requireFile "$IN"
+requireDivides
+
+# Input from the example with the step counts, followed by extra lines
+makeInput() {
+    exampleInput "$IN" "$@"
+}
+
+{
+    echo "Narrow band vs full grid: $EXAMPLE, $STEPS steps, output every $INTERVAL, NB_TOL = $NB_TOL, NB_MARGIN = $NB_MARGIN, $THREADS thread(s)"
+    printf "%-16s %10s %10s %10s %9s\n" steps "band" "phi work" "time [s]" speedup
+} | tee "$REPORT"
+
+set -- $(run full)
+FULL_SECS=${1:-0}
+FULL_RATE=${2:-0}
+set -- $(run band "NARROW_BAND = 1" "NB_TOL = $NB_TOL" "NB_MARGIN = $NB_MARGIN")
+BAND_SECS=${1:-0}
+
+# Narrow band, steps a-b: x% of cells, phi work 1/y, s s, r Mcell-updates/s
+grep "^Narrow band, steps" "$WORK/band/log.txt" |
+    sed -e 's/^Narrow band, steps \([0-9-]*\): \([0-9.]*\)% of cells, phi work 1\/\([0-9.]*\), \([0-9.]*\) s, \([0-9.]*\) Mcell.*/\1 \2 \3 \4 \5/' |
+    awk -v f="$FULL_RATE" '{ printf "%-16s %9.2f%% %9.1fx %10.3f %9.2f\n", $1, $2, $3, $4, (f > 0) ? $5 / f : 0 }' | tee -a "$REPORT"
+
+MEAN=$(grep "^Narrow band:" "$WORK/band/log.txt" | sed -e 's/^Narrow band: \([0-9.]*\)% .*phi work 1\/\([0-9.]*\)/\1 \2/')
+set -- $MEAN
+awk -v s="1-$STEPS" -v p="$1" -v w="$2" -v t="$BAND_SECS" -v b="$FULL_SECS" \
+    'BEGIN { printf "%-16s %9.2f%% %9.1fx %10.3f %9.2f\n", s, p, w, t, (t > 0) ? b / t : 0 }' | tee -a "$REPORT"
+{
+    echo "Full grid: $FULL_SECS s"
+    echo "Largest difference at step $STEPS: phi $(vtkdiff "$WORK/full/output/phi_$STEPS.vtk" "$WORK/band/output/phi_$STEPS.vtk")," \
+         "temp $(vtkdiff "$WORK/full/output/temp_$STEPS.vtk" "$WORK/band/output/temp_$STEPS.vtk")"
+} | tee -a "$REPORT"
@@ -0,0 +1,81 @@
+#!/bin/bash
+#
+# precision_compare.sh
+#
+# Accuracy and speed of the single- and mixed-precision builds against the
+# double build on the tests/test1-test4 inputs. Each precision is built from
+# a copy of the sources (the build in src/ is left alone), every test is run
+# with every build, and the final phi and temp fields are compared with the
+# double result: maximum and RMS absolute difference over the interior cells.
+# The speedup is the ratio of the time-loop seconds to the double run.
+#
+# Usage (from C++_explicit):
+#   benchmarks/precision_compare.sh [tests...]
+#   benchmarks/precision_compare.sh test1 test3
+#
+# The step count of every test can be shortened through the environment:
+#   STEPS=5000 benchmarks/precision_compare.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+TESTS=${@:-test1 test2 test3 test4}
+PRECISIONS="double mixed single"
+
+# Build every precision in its own copy of the sources
+for P in $PRECISIONS; do
+    buildCopy "$WORK/build_$P" PRECISION=$P
+done
+
+# Maximum and RMS difference of two VTK files, over the values after LOOKUP_TABLE
+vtkstats() {
+    awk 'FNR == 1 { f++; on = 0 }
+         on { v[f, FNR - start] = $1; n[f] = FNR - start }
+         /^LOOKUP_TABLE/ { on = 1; start = FNR }
+         END {
+             if (n[1] != n[2] || n[1] == 0) { printf "%12s %12s", "size", "mismatch"; exit }
+             for (i = 1; i <= n[1]; ++i) {
+                 d = v[1, i] - v[2, i]; if (d < 0) d = -d
+                 if (d > m) m = d
+                 s += d * d
+             }
+             printf "%12.3e %12.3e", m, sqrt(s / n[1])
+         }' "$1" "$2"
+}
+
+{
+    echo "Precision comparison against the double build"
+    [ -n "$STEPS" ] && echo "Steps per test: $STEPS"
+    printf "%-8s %-8s %8s %12s %12s %12s %12s %10s %8s\n" \
+        test build steps "phi max" "phi rms" "temp max" "temp rms" "time [s]" speedup
+} | tee "$REPORT"
+
+for T in $TESTS; do
+    IN=$(ls "$ROOT/tests/$T"/*.in 2> /dev/null | head -n 1)
+    if [ -z "$IN" ]; then
+        echo "Warning: no input file in tests/$T, skipped." >&2
+        continue
+    fi
+    N=${STEPS:-$(sed -n 's/^total_steps *= *\([0-9]*\).*/\1/p' "$IN")}
+
+    BASE=
+    for P in $PRECISIONS; do
+        DIR="$WORK/$T/$P"
+        mkdir -p "$DIR"
+        # One output, at the last step
+        sed -e "s/^total_steps *=.*/total_steps = $N;/" \
+            -e "s/^timebreak *=.*/timebreak = $N;/" "$IN" > "$DIR/input.in"
+        SECS=$(cd "$DIR" && "$WORK/build_$P/src/simulation" input.in | grep "^Time loop" | awk '{print $3}')
+        [ -z "$BASE" ] && BASE=$SECS
+
+        DIFFS=
+        for f in phi temp; do
+            DIFFS="$DIFFS $(vtkstats "$WORK/$T/double/output/${f}_$N.vtk" "$DIR/output/${f}_$N.vtk")"
+        done
+        awk -v t="$T" -v p="$P" -v n="$N" -v d="$DIFFS" -v s="$SECS" -v base="$BASE" \
+            'BEGIN { split(d, x, " ")
+                     printf "%-8s %-8s %8d %12s %12s %12s %12s %10.3f %8.2f\n",
+                            t, p, n, x[1], x[2], x[3], x[4], s, base / s }' | tee -a "$REPORT"
+    done
+done
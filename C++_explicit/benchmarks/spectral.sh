@@ -0,0 +1,115 @@
+#!/bin/bash
+#
+# spectral.sh
+#
+# Time to solution of the semi-implicit Fourier-spectral mode (SPECTRAL = 1,
+# spectral.cpp) against explicit stepping on a periodic test problem: a
+# circular (DIM = 2) or spherical (DIM = 3) seed growing into an undercooled
+# melt in a box of side SIZE, PERIODIC on every face, for each grid spacing
+# given. Both runs use ADAPTIVE_DT up to END_TIME, so each takes the largest
+# step its stability limit allows: the explicit limit shrinks with dx^2,
+# while the spectral one is set by the phi reaction term alone. Reported per
+# spacing and solver: steps, mean dt, time-loop seconds, speedup over the
+# explicit run, the largest differences of the final phi and temp from the
+# explicit result, and the solid volume (sum of phi times the cell volume).
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/spectral.sh [grid spacings...]
+#   benchmarks/spectral.sh 0.02 0.01
+#
+# Dimension, box size, end time and thread count can be set through the
+# environment:
+#   DIM=3 SIZE=0.64 END_TIME=0.02 THREADS=4 benchmarks/spectral.sh 0.02
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+SPACINGS=${@:-0.02 0.01}
+DIM=${DIM:-2}
+SIZE=${SIZE:-1.28}
+END_TIME=${END_TIME:-0.06}
+THREADS=${THREADS:-1}
+
+requireBinary
+
+# Input for grid spacing dx, followed by extra lines
+makeInput() {
+    local dx=$1
+    shift
+    local n=$(awk -v s="$SIZE" -v d="$dx" 'BEGIN { printf "%d", s / d + 0.5 }')
+    local c=$((n / 2)) r=$((n / 10))
+    echo "DIM = $DIM;"
+    echo "Num_X = $((n + 2));"
+    echo "Num_Y = $((n + 2));"
+    echo "dx = $dx;"
+    echo "dy = $dx;"
+    if [ "$DIM" = 3 ]; then
+        echo "Num_Z = $((n + 2));"
+        echo "dz = $dx;"
+        echo "boundary = phi,PERIODIC,PERIODIC,PERIODIC,PERIODIC,PERIODIC,PERIODIC;"
+        echo "boundary = temp,PERIODIC,PERIODIC,PERIODIC,PERIODIC,PERIODIC,PERIODIC;"
+        echo "Fill_Sphere = phi,1.0,$c,$c,$c,$r;"
+    else
+        echo "boundary = phi,PERIODIC,PERIODIC,PERIODIC,PERIODIC;"
+        echo "boundary = temp,PERIODIC,PERIODIC,PERIODIC,PERIODIC;"
+        echo "Fill_Sphere = phi,1.0,$c,$c,0,$r;"
+    fi
+    echo "Fill_Constant = temp,0.0;"
+    echo "dt = 1e-5;"
+    echo "total_steps = 1;"
+    echo "timebreak = 1;"
+    echo "ADAPTIVE_DT = 1;"
+    echo "end_time = $END_TIME;"
+    echo "output_time = $END_TIME;"
+    echo "epsilon = 0.01;"
+    echo "tau = 0.0003;"
+    echo "K = 1.6;"
+    echo "delta = 0.02;"
+    echo "j = 4;"
+    echo "theta_0 = 0.0;"
+    echo "alpha = 0.9;"
+    echo "gamma = 10.0;"
+    echo "a = 0.0;"
+    echo "T_e = 1.0;"
+    echo "WRITE_TO_VTK = 1;"
+    echo "NUM_THREADS = $THREADS;"
+    for line in "$@"; do echo "$line"; done
+}
+
+# Sum of a VTK field times the cell volume
+vtkvolume() {
+    awk -v dv="$2" 'on { s += $1 } /^LOOKUP_TABLE/ { on = 1 } END { printf "%.5g", s * dv }' "$1"
+}
+
+# Steps and mean dt of case $1
+adaptiveSteps() {
+    local steps=$(grep "^Adaptive dt: t =" "$WORK/$1/log.txt" | sed -e 's/.* after \([0-9]*\) steps, mean dt \(.*\)/\1 \2/')
+    echo "${steps:-0 0}"
+}
+
+{
+    echo "Spectral vs explicit: DIM = $DIM, box $SIZE, end time $END_TIME, all faces PERIODIC, $THREADS thread(s)"
+    printf "%-8s %-9s %8s %11s %10s %9s %13s %13s %12s\n" dx solver steps "mean dt" "time [s]" speedup "phi max diff" "temp max diff" "solid vol"
+} | tee "$REPORT"
+
+for DX in $SPACINGS; do
+    DV=$(awk -v d="$DX" -v n="$DIM" 'BEGIN { printf "%.10g", d ^ n }')
+    set -- $(run "explicit_$DX" "$DX")
+    BASE=${1:-0}
+    set -- $(adaptiveSteps "explicit_$DX")
+    ESTEPS=$1
+    EDIR="$WORK/explicit_$DX/output"
+    printf "%-8s %-9s %8d %11.4g %10.3f %9.2f %13s %13s %12s\n" "$DX" explicit "$ESTEPS" "$2" "$BASE" 1 - - \
+        "$(vtkvolume "$EDIR/phi_$ESTEPS.vtk" "$DV")" | tee -a "$REPORT"
+
+    set -- $(run "spectral_$DX" "$DX" "SPECTRAL = 1;")
+    SECS=${1:-0}
+    set -- $(adaptiveSteps "spectral_$DX")
+    SDIR="$WORK/spectral_$DX/output"
+    PDIFF=$(vtkdiff "$EDIR/phi_$ESTEPS.vtk" "$SDIR/phi_$1.vtk")
+    TDIFF=$(vtkdiff "$EDIR/temp_$ESTEPS.vtk" "$SDIR/temp_$1.vtk")
+    VOL=$(vtkvolume "$SDIR/phi_$1.vtk" "$DV")
+    awk -v x="$DX" -v s="$1" -v dt="$2" -v t="$SECS" -v b="$BASE" -v p="$PDIFF" -v q="$TDIFF" -v v="$VOL" \
+        'BEGIN { printf "%-8s %-9s %8d %11.4g %10.3f %9.2f %13s %13s %12s\n", x, "spectral", s, dt, t, (t > 0) ? b / t : 0, p, q, v }' | tee -a "$REPORT"
+done
@@ -0,0 +1,52 @@
+#!/bin/bash
+#
+# strong_scaling.sh
+#
+# Strong-scaling report for the OpenMP time loop on the examples/Fig.7(4)
+# configuration (300 x 300, j = 4). Runs the same problem with an increasing
+# number of threads and tabulates wall time, speedup and parallel efficiency
+# from the "Time loop" line printed by the solver. Only the initial state is
+# written, so the timings cover the stencil kernels alone.
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/strong_scaling.sh [steps] [thread counts...]
+#   benchmarks/strong_scaling.sh 2000 1 2 4 8
+#
+# Extra input keys (e.g. FUSED_KERNEL = 1) can be passed through EXTRA:
+#   EXTRA="FUSED_KERNEL = 1;" benchmarks/strong_scaling.sh 2000 1 2 4
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+IN="$ROOT/examples/Fig.7(4)/outfile.in"
+STEPS=${1:-2000}
+shift
+COUNTS=${@:-1 2 4 8}
+# Only the initial state is written
+INTERVAL=$((STEPS + 1))
+
+requireBinary
+
+# Input from the example with the step counts and THREADS threads
+makeInput() {
+    exampleInput "$IN"
+    [ -n "$EXTRA" ] && echo "$EXTRA"
+}
+
+{
+    echo "Strong scaling: examples/Fig.7(4), $STEPS steps, $(nproc) core(s) available"
+    [ -n "$EXTRA" ] && echo "Extra options: $EXTRA"
+    printf "%8s %12s %14s %10s %12s\n" threads "time [s]" "Mcell-upd/s" speedup efficiency
+} | tee "$REPORT"
+
+BASE=""
+for N in $COUNTS; do
+    THREADS=$N
+    set -- $(run "run_$N")
+    SECS=${1:-0}
+    RATE=${2:-0}
+    [ -z "$BASE" ] && BASE=$SECS
+    awk -v n="$N" -v s="$SECS" -v r="$RATE" -v b="$BASE" \
+        'BEGIN { printf "%8d %12.3f %14.2f %10.2f %11.0f%%\n", n, s, r, b / s, 100 * b / (s * n) }' | tee -a "$REPORT"
+done
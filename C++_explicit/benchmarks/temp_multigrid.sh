@@ -0,0 +1,111 @@
+#!/bin/bash
+#
+# temp_multigrid.sh
+#
+# Time to solution of the multigrid temperature solver (TEMP_SOLVER =
+# MULTIGRID, multigrid.cpp) against the explicit updateTemp on a diffusion
+# problem: a hot block in an N x N (DIM = 2) or N^3 (DIM = 3) domain with
+# NOFLUX faces, phi = 0 everywhere (so phi stays 0 and only the temperature
+# evolves). The explicit run takes STEPS steps at 0.9 times its stability
+# limit; the multigrid runs reach the same end time with dt that many times
+# larger, for backward Euler (theta = 1) and Crank-Nicolson (theta = 0.5).
+# Reported per run: steps, V-cycles per step (mean and most), time-loop
+# seconds, speedup over the explicit run, and the largest difference of the
+# final temperature from the explicit result.
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/temp_multigrid.sh [dt multiples...]
+#   benchmarks/temp_multigrid.sh 1 10 100
+#
+# Dimension, grid size, explicit step count and thread count can be set
+# through the environment (STEPS must be divisible by every multiple):
+#   DIM=3 N=64 STEPS=200 THREADS=4 benchmarks/temp_multigrid.sh 10 50
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+MULTIPLES=${@:-1 10 100}
+DIM=${DIM:-2}
+N=${N:-256}
+STEPS=${STEPS:-400}
+THREADS=${THREADS:-1}
+
+requireBinary
+
+# Explicit step: 0.9 / (2 DIM / dx^2), dx = 0.03
+DT=$(awk -v d="$DIM" 'BEGIN { printf "%.10g", 0.9 * 0.03 * 0.03 / (2 * d) }')
+LO=$((N / 4 + 1))
+HI=$((3 * N / 4))
+
+# Input with the given dt, step count and solver lines
+makeInput() {
+    local dt=$1 steps=$2
+    shift 2
+    echo "DIM = $DIM;"
+    echo "Num_X = $((N + 2));"
+    echo "Num_Y = $((N + 2));"
+    echo "dx = 0.03;"
+    echo "dy = 0.03;"
+    if [ "$DIM" = 3 ]; then
+        echo "Num_Z = $((N + 2));"
+        echo "dz = 0.03;"
+        echo "boundary = phi,NOFLUX,NOFLUX,NOFLUX,NOFLUX,NOFLUX,NOFLUX;"
+        echo "boundary = temp,NOFLUX,NOFLUX,NOFLUX,NOFLUX,NOFLUX,NOFLUX;"
+        echo "Fill_Cube = temp,1.0,$LO,$HI,$LO,$HI,$LO,$HI;"
+    else
+        echo "boundary = phi,NOFLUX,NOFLUX,NOFLUX,NOFLUX;"
+        echo "boundary = temp,NOFLUX,NOFLUX,NOFLUX,NOFLUX;"
+        echo "Fill_Cube = temp,1.0,$LO,$HI,$LO,$HI;"
+    fi
+    echo "dt = $dt;"
+    echo "total_steps = $steps;"
+    echo "timebreak = $steps;"
+    echo "epsilon = 0.01;"
+    echo "tau = 0.0003;"
+    echo "K = 1.4;"
+    echo "delta = 0.0;"
+    echo "j = 4;"
+    echo "theta_0 = 0.0;"
+    echo "alpha = 0.9;"
+    echo "gamma = 10.0;"
+    echo "a = 0.0;"
+    echo "T_e = 1.0;"
+    echo "WRITE_TO_VTK = 1;"
+    echo "NUM_THREADS = $THREADS;"
+    for line in "$@"; do echo "$line"; done
+}
+
+# Mean and most V-cycles per step of case $1
+vCycles() {
+    local cyc=$(grep "^Multigrid" "$WORK/$1/log.txt" | sed -e 's/.*), \([0-9.]*\) V-cycles per step, at most \([0-9]*\)/\1 \2/')
+    echo "${cyc:-- -}"
+}
+
+{
+    echo "Multigrid vs explicit temperature: DIM = $DIM, $N per axis, end time $STEPS explicit steps of $DT, $THREADS thread(s)"
+    printf "%-22s %8s %10s %8s %10s %9s %14s\n" solver steps "V-cycles" "most" "time [s]" speedup "temp max diff"
+} | tee "$REPORT"
+
+set -- $(run explicit "$DT" "$STEPS")
+BASE=${1:-0}
+printf "%-22s %8d %10s %8s %10.3f %9.2f %14s\n" explicit "$STEPS" - - "$BASE" 1 - | tee -a "$REPORT"
+
+for M in $MULTIPLES; do
+    if [ $((STEPS % M)) -ne 0 ]; then
+        echo "Warning: $STEPS steps are not divisible by $M, skipped." >&2
+        continue
+    fi
+    S=$((STEPS / M))
+    MDT=$(awk -v d="$DT" -v m="$M" 'BEGIN { printf "%.10g", d * m }')
+    for TH in 1 0.5; do
+        NAME="mg_${M}_$TH"
+        set -- $(run "$NAME" "$MDT" "$S" "TEMP_SOLVER = MULTIGRID;" "MG_THETA = $TH;")
+        SECS=${1:-0}
+        set -- $(vCycles "$NAME")
+        DIFF=$(vtkdiff "$WORK/explicit/output/temp_$STEPS.vtk" "$WORK/$NAME/output/temp_$S.vtk")
+        LABEL="multigrid $([ "$TH" = 1 ] && echo BE || echo CN) ${M}x dt"
+        awk -v l="$LABEL" -v s="$S" -v t="$SECS" -v c="$1" -v m="$2" -v b="$BASE" -v d="$DIFF" \
+            'BEGIN { printf "%-22s %8d %10s %8s %10.3f %9.2f %14s\n", l, s, c, m, t, (t > 0) ? b / t : 0, d }' | tee -a "$REPORT"
+    done
+done
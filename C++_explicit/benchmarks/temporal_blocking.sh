@@ -0,0 +1,94 @@
+#!/bin/bash
+#
+# temporal_blocking.sh
+#
+# Temporal blocking against the per-step sweep on a large 2D grid (a growing
+# seed in a 2000 x 2000 domain, fused kernel, algebraic anisotropy). For
+# each BLOCK_STEPS value the time loop is timed without output and the
+# tiles the solver chose are listed, and a short run of 2 * BLOCK_STEPS + 1
+# steps, which ends with a partial block, is checked against the per-step
+# sweep: the written fields must be identical.
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/temporal_blocking.sh [steps] [BLOCK_STEPS values...]
+#   benchmarks/temporal_blocking.sh 40 2 4 8 16
+#
+# The grid size and extra input keys can be changed through the environment:
+#   NX=1000 NY=1000 EXTRA="NUM_THREADS = 4;" benchmarks/temporal_blocking.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+STEPS=${1:-40}
+shift
+BLOCKS=${@:-2 4 8 16}
+NX=${NX:-2000}
+NY=${NY:-2000}
+
+requireBinary
+
+# makeInput <steps> <timebreak> [extra lines...]
+makeInput() {
+    local steps=$1 tbreak=$2
+    shift 2
+    {
+        echo "DIM = 2;"
+        echo "Num_X = $((NX + 2));"
+        echo "Num_Y = $((NY + 2));"
+        echo "dx = 0.03;"
+        echo "dy = 0.03;"
+        echo "dt = 1e-5;"
+        echo "total_steps = $steps;"
+        echo "timebreak = $tbreak;"
+        echo "epsilon = 0.01;"
+        echo "tau = 0.0003;"
+        echo "K = 1.4;"
+        echo "delta = 0.05;"
+        echo "j = 4;"
+        echo "theta_0 = 0.0;"
+        echo "alpha = 0.9;"
+        echo "gamma = 10.0;"
+        echo "a = 0.01;"
+        echo "T_e = 1.0;"
+        echo "boundary = phi,NOFLUX,NOFLUX,NOFLUX,NOFLUX;"
+        echo "boundary = temp,NOFLUX,NOFLUX,NOFLUX,NOFLUX;"
+        echo "Fill_Sphere = phi,1.0,$((NX / 20)),$((NX / 2)),$((NY / 2));"
+        echo "Fill_Constant = temp,0.0;"
+        echo "WRITE_TO_VTK = 1;"
+        echo "FUSED_KERNEL = 1;"
+        echo "ANISOTROPY_ENGINE = ALGEBRAIC;"
+        for l in "$@"; do echo "$l"; done
+        [ -n "$EXTRA" ] && echo "$EXTRA"
+    }
+}
+
+{
+    echo "Temporal blocking: $NX x $NY interior cells, $STEPS steps, fused kernel, ALGEBRAIC anisotropy"
+    [ -n "$EXTRA" ] && echo "Extra options: $EXTRA"
+    printf "%12s %12s %14s %10s %10s\n" BLOCK_STEPS "time [s]" "Mcell-upd/s" speedup result
+} | tee "$REPORT"
+
+CELLS=$((NX * NY))
+set -- $(run sweep "$STEPS" $((STEPS + 1)))
+BASE=${1:-0}
+awk -v s="$BASE" -v c="$CELLS" -v n="$STEPS" \
+    'BEGIN { printf "%12s %12.3f %14.2f %10.2f %10s\n", "off", s, c * n / s * 1e-6, 1.0, "-" }' | tee -a "$REPORT"
+
+for B in $BLOCKS; do
+    set -- $(run "block_$B" "$STEPS" $((STEPS + 1)) "BLOCK_STEPS = $B;")
+    SECS=${1:-0}
+
+    # Bitwise check on a short run
+    V=$((2 * B + 1))
+    run "ref_$B" "$V" "$V" > /dev/null
+    run "chk_$B" "$V" "$V" "BLOCK_STEPS = $B;" > /dev/null
+    RESULT=identical
+    for f in phi temp; do
+        cmp -s "$WORK/ref_$B/output/${f}_$V.vtk" "$WORK/chk_$B/output/${f}_$V.vtk" || RESULT=DIFFERS
+    done
+
+    awk -v b="$B" -v s="$SECS" -v c="$CELLS" -v n="$STEPS" -v base="$BASE" -v res="$RESULT" \
+        'BEGIN { printf "%12d %12.3f %14.2f %10.2f %10s\n", b, s, c * n / s * 1e-6, base / s, res }' | tee -a "$REPORT"
+    grep "^Temporal blocking" "$WORK/block_$B/log.txt" | sed -e 's/^/    /' | tee -a "$REPORT"
+done
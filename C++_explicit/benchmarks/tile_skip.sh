@@ -0,0 +1,73 @@
+#!/bin/bash
+#
+# tile_skip.sh
+#
+# Time to solution with the tile activity map (TILE_SKIP = 1,
+# tile_activity.cpp) against updating every tile, on one of the examples
+# (default examples/Fig.7(4), a dendrite growing from a small seed into a
+# melt that stays quiescent far from it). Both runs take STEPS steps with
+# output every INTERVAL steps. The run without skipping does the same work
+# every step, so the speedup of each output interval is the interval
+# throughput with skipping over the mean throughput without. Reported per
+# interval: the share of phi and temp tiles skipped, seconds, and the
+# speedup; then the whole run, and the largest differences of the final
+# phi and temp from the result without skipping (zero with the default
+# TILE_TOL = 0; with TILE_TOL > 0, also the largest change a tile missed).
+#
+# Usage (from C++_explicit, after make):
+#   benchmarks/tile_skip.sh [example]
+#   benchmarks/tile_skip.sh "Fig.6(6)"
+#
+# Step count, output interval, tile size, tolerance and drift budget, and
+# thread count can be set through the environment (INTERVAL must divide
+# STEPS):
+#   STEPS=20000 INTERVAL=5000 TILE_SIZE=16 TILE_TOL=1e-9 TILE_DRIFT=1e-6 THREADS=4 benchmarks/tile_skip.sh
+#
+# The report is printed; REPORT=<file> also writes it to that file.
+
+. "$(dirname "$0")/common.sh"
+
+EXAMPLE=${1:-Fig.7(4)}
+STEPS=${STEPS:-6000}
+INTERVAL=${INTERVAL:-2000}
+TILE_SIZE=${TILE_SIZE:-16}
+TILE_TOL=${TILE_TOL:-0}
+TILE_DRIFT=${TILE_DRIFT:-1e-6}
+THREADS=${THREADS:-1}
+IN="$ROOT/examples/$EXAMPLE/outfile.in"
+
+requireBinary
+requireFile "$IN"
+requireDivides
+
+# Input from the example with the step counts, followed by extra lines
+makeInput() {
+    exampleInput "$IN" "$@"
+}
+
+{
+    echo "Tile skipping vs every tile: $EXAMPLE, $STEPS steps, output every $INTERVAL, TILE_SIZE = $TILE_SIZE, TILE_TOL = $TILE_TOL, TILE_DRIFT = $TILE_DRIFT, $THREADS thread(s)"
+    printf "%-16s %14s %14s %10s %9s\n" steps "phi skipped" "temp skipped" "time [s]" speedup
+} | tee "$REPORT"
+
+set -- $(run full)
+FULL_SECS=${1:-0}
+FULL_RATE=${2:-0}
+set -- $(run tiles "TILE_SKIP = 1" "TILE_SIZE = $TILE_SIZE" "TILE_TOL = $TILE_TOL" "TILE_DRIFT = $TILE_DRIFT")
+TILE_SECS=${1:-0}
+
+# Tile skipping, steps a-b: x% of phi and y% of temp tiles skipped, s s, r Mcell-updates/s
+grep "^Tile skipping, steps" "$WORK/tiles/log.txt" |
+    sed -e 's/^Tile skipping, steps \([0-9-]*\): \([0-9.]*\)% of phi and \([0-9.]*\)% of temp tiles skipped, \([0-9.]*\) s, \([0-9.]*\) Mcell.*/\1 \2 \3 \4 \5/' |
+    awk -v f="$FULL_RATE" '{ printf "%-16s %13.2f%% %13.2f%% %10.3f %9.2f\n", $1, $2, $3, $4, (f > 0) ? $5 / f : 0 }' | tee -a "$REPORT"
+
+MEAN=$(grep "^Tile skipping:" "$WORK/tiles/log.txt" | sed -e 's/^Tile skipping: \([0-9.]*\)% of phi and \([0-9.]*\)% of temp.*/\1 \2/')
+set -- $MEAN
+awk -v s="1-$STEPS" -v p="$1" -v q="$2" -v t="$TILE_SECS" -v b="$FULL_SECS" \
+    'BEGIN { printf "%-16s %13.2f%% %13.2f%% %10.3f %9.2f\n", s, p, q, t, (t > 0) ? b / t : 0 }' | tee -a "$REPORT"
+{
+    echo "Every tile: $FULL_SECS s"
+    echo "Largest difference at step $STEPS: phi $(vtkdiff "$WORK/full/output/phi_$STEPS.vtk" "$WORK/tiles/output/phi_$STEPS.vtk")," \
+         "temp $(vtkdiff "$WORK/full/output/temp_$STEPS.vtk" "$WORK/tiles/output/temp_$STEPS.vtk")"
+    grep "largest change missed" "$WORK/tiles/log.txt" | sed -e 's/^ *l/L/'
+} | tee -a "$REPORT"
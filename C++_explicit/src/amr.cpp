@@ -0,0 +1,739 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include "interval_timer.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * amr.cpp
+ *
+ * Block-structured refinement (AMR = 1) with one fine level at half the
+ * spacing. The grid of the input is the coarse level and is stepped as
+ * usual; it is cut into blocks of AMR_BLOCK cells per edge, and every block
+ * near the interface carries a fine patch of 2 AMR_BLOCK cells per edge plus
+ * one ghost layer. After each coarse step the patches take `substeps` steps
+ * of dt / substeps, as many as the explicit stability limit of the fine
+ * spacing needs (stableTimestep), with the regular kernels run on each
+ * patch by one thread in a per-thread workspace, as the temporal blocking
+ * does with its slabs. Coupling of the levels:
+ *  - ghost cells of a patch come from the neighbouring patch where that
+ *    block is refined, else from the coarse level by the interpolation
+ *    below, linear in time between the two coarse generations; across the
+ *    domain faces they follow the boundary type of the field
+ *  - interpolation from the coarse level: cell value plus minmod-limited
+ *    slopes, so the fine cells of a coarse cell average to it; it also
+ *    fills new patches (conservative prolongation)
+ *  - restriction: each coarse cell under a patch becomes the mean of its
+ *    fine cells
+ *  - refluxing: the coarse update of a cell next to a patch used the coarse
+ *    temperature flux through their common face; the flux the patch saw
+ *    over its substeps replaces it, so temp - K phi is conserved across
+ *    the coarse/fine faces
+ * After every coarse step the blocks where phi (1 - phi) exceeds
+ * AMR_PHI_TOL, or phi jumps by more than AMR_GRAD_TOL between face
+ * neighbours, are marked, and those within one block of a mark are refined.
+ *  - setupAmr: block grid, patch parameters, patch pool and workspaces
+ *  - buildAmr: first refinement, from the initial fields
+ *  - advanceAmr: patches over the coarse step just taken, restriction,
+ *    refluxing and regridding
+ *  - writeAmrFields: phi and temp resampled on the uniform fine grid
+ *  - startAmrInterval / reportAmrInterval / printAmrReport: refined share
+ *    and throughput of each output interval and of the run
+ *  - freeAmr: release the hierarchy
+ */
+
+// Philox key offset between the noise streams of the patches
+static constexpr uint64_t AMR_SEED_STEP = 0x9E3779B97F4A7C15ull;
+
+// Placement of a block on the coarse level
+struct BlockSpan {
+    int b[3];       // block coordinates
+    int first[3];   // first coarse interior cell, from 0
+    int n[3];       // coarse cells; 1 along z in 2D
+};
+
+static BlockSpan blockSpan(const AmrLevel *amr, const SimParams *params, int b) {
+    const int N[3] = { params->Num_X - 2, params->Num_Y - 2, (params->DIM == 3) ? params->Num_Z - 2 : 1 };
+    BlockSpan s;
+    s.b[0] = b / (amr->nby * amr->nbz);
+    s.b[1] = (b / amr->nbz) % amr->nby;
+    s.b[2] = b % amr->nbz;
+    for (int a = 0; a < 3; ++a) {
+        s.first[a] = s.b[a] * amr->block;
+        s.n[a] = (N[a] - s.first[a] < amr->block) ? N[a] - s.first[a] : amr->block;
+    }
+    return s;
+}
+
+// Field of the patch of block b: 0 = phi, 1 = temp; generation 0 or 1
+static inline Real *patchField(const AmrLevel *amr, int b, int field, int gen) {
+    return reinterpret_cast<Real*>(amr->pool.base + ((size_t)b * 4 + field * 2 + gen) * amr->pool.arrayBytes);
+}
+
+// Boundary type of the low (side 0) or high (side 1) face along axis a
+static BoundaryType faceType(const FaceBoundary &bc, int a, int side) {
+    if (a == 0) return side ? bc.right : bc.left;
+    if (a == 1) return side ? bc.top : bc.bottom;
+    return side ? bc.front : bc.back;
+}
+
+static inline double minmod(double a, double b) {
+    if (a * b <= 0.0) return 0.0;
+    return (std::fabs(a) < std::fabs(b)) ? a : b;
+}
+
+/**
+ * @brief Coarse field at offset h[a] (in coarse cells, +-1/4 for a fine
+ * cell) from the centre of coarse cell idx, with minmod-limited slopes.
+ */
+template <int DIM>
+static inline double interpolateCoarse(const Real *c, int idx, const int cs[], const double h[]) {
+    const double v = c[idx];
+    double value = v;
+    for (int a = 0; a < DIM; ++a) {
+        const int st = (a == 2) ? 1 : cs[a];
+        value += h[a] * minmod(c[idx + st] - v, v - c[idx - st]);
+    }
+    return value;
+}
+
+/**
+ * @brief Value of a field at fine cell g (fine interior coordinates from 0,
+ * possibly one cell outside the domain) at the fraction theta of the
+ * coarse step: from the patch holding it, else from the coarse level.
+ *
+ * @param c0, c1  Coarse field at the start and the end of the coarse step
+ */
+template <int DIM>
+static double fineValue(const AmrLevel *amr, const SimParams *params, const int cs[], int field,
+                        const Real *c0, const Real *c1, double theta, int g[3]) {
+    const int N[3] = { params->Num_X - 2, params->Num_Y - 2, params->Num_Z - 2 };
+    const FaceBoundary &bc = field ? amr->tempBC : amr->phiBC;
+    const int B = amr->block;
+    int c[3] = { 0, 0, 0 };
+    bool ghost = false;
+    for (int a = 0; a < DIM; ++a) {
+        const int n = 2 * N[a];
+        c[a] = -1;
+        if (g[a] < 0 || g[a] >= n) {
+            const BoundaryType t = faceType(bc, a, g[a] >= n);
+            if (t == BOUNDARY_PERIODIC) {
+                g[a] = (g[a] + n) % n;
+            } else if (t == BOUNDARY_NOFLUX) {
+                g[a] = (g[a] < 0) ? -1 - g[a] : 2 * n - 1 - g[a];
+            } else {
+                // The coarse ghost keeps its value: take it as it is
+                c[a] = (g[a] < 0) ? 0 : N[a] + 1;
+                ghost = true;
+            }
+        }
+        if (c[a] < 0) c[a] = g[a] / 2 + 1;
+    }
+    const int idx = c[0] * cs[0] + c[1] * cs[1] + ((DIM == 3) ? c[2] : 0);
+    if (ghost) return (1.0 - theta) * c0[idx] + theta * c1[idx];
+
+    const int bz = (DIM == 3) ? g[2] / 2 / B : 0;
+    const int b = ((g[0] / 2 / B) * amr->nby + g[1] / 2 / B) * amr->nbz + bz;
+    if (amr->refined[b]) {
+        const int *fs = amr->strides;
+        const int l = (g[0] - 2 * B * (g[0] / 2 / B) + 1) * fs[0]
+                    + (g[1] - 2 * B * (g[1] / 2 / B) + 1) * fs[1]
+                    + ((DIM == 3) ? g[2] - 2 * B * bz + 1 : 0);
+        return patchField(amr, b, field, amr->gen)[l];
+    }
+    const double h[3] = { (g[0] & 1) ? 0.25 : -0.25, (g[1] & 1) ? 0.25 : -0.25, (g[2] & 1) ? 0.25 : -0.25 };
+    const double v0 = interpolateCoarse<DIM>(c0, idx, cs, h);
+    if (theta == 0.0) return v0;
+    return (1.0 - theta) * v0 + theta * interpolateCoarse<DIM>(c1, idx, cs, h);
+}
+
+/**
+ * @brief Neighbour block of b across face (a, side), or -1 at a domain face
+ * that temp does not wrap around.
+ */
+static int faceNeighbour(const AmrLevel *amr, const BlockSpan &s, int a, int side) {
+    const int nb[3] = { amr->nbx, amr->nby, amr->nbz };
+    int c[3] = { s.b[0], s.b[1], s.b[2] };
+    c[a] += side ? 1 : -1;
+    if (c[a] < 0 || c[a] >= nb[a]) {
+        if (faceType(amr->tempBC, a, side) != BOUNDARY_PERIODIC) return -1;
+        c[a] = (c[a] + nb[a]) % nb[a];
+    }
+    return (c[0] * amr->nby + c[1]) * amr->nbz + c[2];
+}
+
+// A face of a refined block that borders the coarse level
+static inline bool coarseFace(const AmrLevel *amr, const BlockSpan &s, int a, int side) {
+    const int nb = faceNeighbour(amr, s, a, side);
+    return nb >= 0 && !amr->refined[nb];
+}
+
+/**
+ * @brief Fill the ghost cells of both fields of a patch for the substep
+ * starting at the fraction theta of the coarse step, and add the heat it
+ * then sends through its coarse faces to the flux register.
+ *
+ * @param c0, c1  Coarse phi and temp at the start and the end of the coarse step
+ * @param first   First substep: the register starts from zero
+ */
+template <int DIM>
+static void preparePatch(AmrLevel *amr, int b, const SimParams *params, const int cs[],
+                         Real *const c0[2], Real *const c1[2], double theta, bool first) {
+    const BlockSpan s = blockSpan(amr, params, b);
+    const int *fs = amr->strides;
+    const int m[3] = { 2 * s.n[0], 2 * s.n[1], (DIM == 3) ? 2 * s.n[2] : 1 };
+    const int zend = (DIM == 3) ? m[2] + 2 : 1;
+    Real *arr[2] = { patchField(amr, b, 0, amr->gen), patchField(amr, b, 1, amr->gen) };
+
+    for (int l0 = 0; l0 < m[0] + 2; ++l0) {
+        for (int l1 = 0; l1 < m[1] + 2; ++l1) {
+            const bool inside = l0 > 0 && l0 <= m[0] && l1 > 0 && l1 <= m[1];
+            if (inside && DIM == 2) continue;
+            for (int l2 = 0; l2 < zend; ++l2) {
+                if (inside && l2 > 0 && l2 <= m[2]) {
+                    l2 = m[2];  // on to the far z ghost
+                    continue;
+                }
+                const int idx = l0 * fs[0] + l1 * fs[1] + ((DIM == 3) ? l2 : 0);
+                for (int f = 0; f < 2; ++f) {
+                    int g[3] = { 2 * s.first[0] + l0 - 1, 2 * s.first[1] + l1 - 1,
+                                 (DIM == 3) ? 2 * s.first[2] + l2 - 1 : 0 };
+                    arr[f][idx] = fineValue<DIM>(amr, params, cs, f, c0[f], c1[f], theta, g);
+                }
+            }
+        }
+    }
+
+    // Heat through each coarse face, per unit area: the fine face fluxes over
+    // dt / substeps, averaged over the fine faces of each coarse face cell
+    const double h[3] = { amr->fine.dx, amr->fine.dy, amr->fine.dz };
+    const double share = (DIM == 3) ? 0.25 : 0.5;
+    const Real *T = arr[1];
+    for (int a = 0; a < DIM; ++a) {
+        const int o0 = (a == 0) ? 1 : 0;
+        const int o1 = (a == 2) ? 1 : 2;
+        const int st = (a == 2) ? 1 : fs[a];
+        const double coef = amr->fine.dt / h[a] * share;
+        for (int side = 0; side < 2; ++side) {
+            double *reg = amr->flux + ((size_t)b * 2 * DIM + 2 * a + side) * amr->faceCells;
+            if (first) std::memset(reg, 0, amr->faceCells * sizeof(double));
+            if (!coarseFace(amr, s, a, side)) continue;
+            int l[3];
+            l[a] = side ? m[a] : 1;
+            const int out = side ? st : -st;
+            for (int u0 = 1; u0 <= m[o0]; ++u0) {
+                for (int u1 = 1; u1 <= ((DIM == 3) ? m[o1] : 1); ++u1) {
+                    l[o0] = u0;
+                    l[o1] = (DIM == 3) ? u1 : 0;
+                    const int idx = l[0] * fs[0] + l[1] * fs[1] + ((DIM == 3) ? l[2] : 0);
+                    const int u = (DIM == 3) ? ((u0 - 1) / 2) * amr->block + (u1 - 1) / 2 : (u0 - 1) / 2;
+                    reg[u] += coef * (double(T[idx]) - double(T[idx + out]));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief One substep of a patch with the selected kernels, on the calling
+ * thread alone; writes the other generation of the patch.
+ */
+template <int DIM>
+static void advancePatch(AmrLevel *amr, int b, TileWorkspace *ws, const SimParams *params,
+                         const KernelTable *kt, int step) {
+    const BlockSpan s = blockSpan(amr, params, b);
+    SimParams *lp = &ws->params;
+    lp->Num_X = 2 * s.n[0] + 2;
+    lp->Num_Y = 2 * s.n[1] + 2;
+    lp->Num_Z = (DIM == 3) ? 2 * s.n[2] + 2 : 1;
+    lp->noise_seed = params->noise_seed + (uint64_t)(b + 1) * AMR_SEED_STEP;
+    Accum r[MAX_DIM]  = { Accum(1.0 / lp->dx), Accum(1.0 / lp->dy), Accum(1.0 / lp->dz) };
+    Accum r2[MAX_DIM] = { Accum(1.0 / (lp->dx * lp->dx)), Accum(1.0 / (lp->dy * lp->dy)),
+                          Accum(1.0 / (lp->dz * lp->dz)) };
+
+    Real *phi  = patchField(amr, b, 0, amr->gen);
+    Real *temp = patchField(amr, b, 1, amr->gen);
+    FieldBuffers lfb = ws->fb;
+    lfb.phi_new  = patchField(amr, b, 0, amr->gen ^ 1);
+    lfb.temp_new = patchField(amr, b, 1, amr->gen ^ 1);
+    if (lp->FUSED_KERNEL) {
+        kt->updatePhiFused(phi, temp, &lfb, lp, r, amr->strides, step);
+    } else {
+        kt->computedfdphi(phi, lfb.dfdphi, temp, lp, amr->strides);
+        kt->computeGradientPhi(phi, &lfb, lp, r, amr->strides);
+        kt->computeAnisotropy(&lfb, lp, amr->strides);
+        kt->updatePhi(phi, &lfb, lp, r, amr->strides, step);
+    }
+    kt->updateTemp(temp, &lfb, lp, amr->strides, r2);
+}
+
+/**
+ * @brief Coarse cells under a patch become the mean of its fine cells.
+ */
+template <int DIM>
+static void restrictPatch(const AmrLevel *amr, int b, const SimParams *params, const int cs[],
+                          Real *phiC, Real *tempC) {
+    const BlockSpan s = blockSpan(amr, params, b);
+    const int *fs = amr->strides;
+    const int kz = (DIM == 3) ? 2 : 1;
+    const double w = (DIM == 3) ? 0.125 : 0.25;
+    Real *coarse[2] = { phiC, tempC };
+    for (int f = 0; f < 2; ++f) {
+        const Real *p = patchField(amr, b, f, amr->gen);
+        for (int i = 0; i < s.n[0]; ++i) {
+            for (int j = 0; j < s.n[1]; ++j) {
+                for (int k = 0; k < s.n[2]; ++k) {
+                    double sum = 0.0;
+                    for (int di = 0; di < 2; ++di)
+                        for (int dj = 0; dj < 2; ++dj)
+                            for (int dk = 0; dk < kz; ++dk) {
+                                sum += p[(2 * i + 1 + di) * fs[0] + (2 * j + 1 + dj) * fs[1]
+                                         + ((DIM == 3) ? 2 * k + 1 + dk : 0)];
+                            }
+                    const int idx = (s.first[0] + i + 1) * cs[0] + (s.first[1] + j + 1) * cs[1]
+                                  + ((DIM == 3) ? s.first[2] + k + 1 : 0);
+                    coarse[f][idx] = sum * w;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Replace the coarse flux through every coarse face of the patches
+ * by the heat the patches sent through it (flux register); serial.
+ *
+ * @param temp    Coarse temp at the start of the step
+ * @param tempC   Coarse temp at the end of the step, corrected in place
+ */
+template <int DIM>
+static void refluxTemp(const AmrLevel *amr, const SimParams *params, const int cs[],
+                       const Real *temp, Real *tempC) {
+    const int N[3] = { params->Num_X - 2, params->Num_Y - 2, params->Num_Z - 2 };
+    const double h[3] = { params->dx, params->dy, params->dz };
+    for (int n = 0; n < amr->nlist; ++n) {
+        const int b = amr->list[n];
+        const BlockSpan s = blockSpan(amr, params, b);
+        for (int a = 0; a < DIM; ++a) {
+            const int o0 = (a == 0) ? 1 : 0;
+            const int o1 = (a == 2) ? 1 : 2;
+            for (int side = 0; side < 2; ++side) {
+                if (!coarseFace(amr, s, a, side)) continue;
+                const double *reg = amr->flux + ((size_t)b * 2 * DIM + 2 * a + side) * amr->faceCells;
+                for (int u0 = 0; u0 < s.n[o0]; ++u0) {
+                    for (int u1 = 0; u1 < ((DIM == 3) ? s.n[o1] : 1); ++u1) {
+                        int c[3], o[3];
+                        c[a] = side ? s.first[a] + s.n[a] - 1 : s.first[a];
+                        c[o0] = s.first[o0] + u0;
+                        c[o1] = s.first[o1] + u1;
+                        o[0] = c[0]; o[1] = c[1]; o[2] = c[2];
+                        o[a] = (c[a] + (side ? 1 : -1) + N[a]) % N[a];
+                        const int ic = (c[0] + 1) * cs[0] + (c[1] + 1) * cs[1] + ((DIM == 3) ? c[2] + 1 : 0);
+                        const int io = (o[0] + 1) * cs[0] + (o[1] + 1) * cs[1] + ((DIM == 3) ? o[2] + 1 : 0);
+                        const double coarse = params->dt * (double(temp[ic]) - double(temp[io])) / h[a];
+                        tempC[io] += (reg[(DIM == 3) ? u0 * amr->block + u1 : u0] - coarse) / h[a];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Mark, refine and unrefine the blocks from the coarse fields; new
+ * patches are filled from them. Orphaned omp for; call on every thread.
+ */
+template <int DIM>
+static void regrid(AmrLevel *amr, const SimParams *params, const int cs[], const Real *phiC, const Real *tempC) {
+    const double ptol = params->AMR_PHI_TOL;
+    const double gtol = params->AMR_GRAD_TOL;
+
+    #pragma omp for schedule(dynamic)
+    for (int b = 0; b < amr->count; ++b) {
+        const BlockSpan s = blockSpan(amr, params, b);
+        int mark = 0;
+        for (int i = 0; i < s.n[0] && !mark; ++i) {
+            for (int j = 0; j < s.n[1] && !mark; ++j) {
+                for (int k = 0; k < s.n[2] && !mark; ++k) {
+                    const int idx = (s.first[0] + i + 1) * cs[0] + (s.first[1] + j + 1) * cs[1]
+                                  + ((DIM == 3) ? s.first[2] + k + 1 : 0);
+                    const double p = phiC[idx];
+                    if (p * (1.0 - p) > ptol) mark = 1;
+                    for (int a = 0; a < DIM; ++a) {
+                        const int st = (a == 2) ? 1 : cs[a];
+                        if (std::fabs(phiC[idx + st] - p) > gtol || std::fabs(p - phiC[idx - st]) > gtol) mark = 1;
+                    }
+                }
+            }
+        }
+        amr->flag[b] = (unsigned char)mark;
+    }
+
+    #pragma omp single
+    {
+        // Refine the marked blocks and one block around them
+        const int nb[3] = { amr->nbx, amr->nby, amr->nbz };
+        int wrap[3];
+        for (int a = 0; a < 3; ++a) wrap[a] = faceType(amr->phiBC, a, 0) == BOUNDARY_PERIODIC;
+        const int r2 = (DIM == 3) ? 1 : 0;
+        for (int b = 0; b < amr->count; ++b) {
+            const BlockSpan s = blockSpan(amr, params, b);
+            for (int dx = -1; dx <= 1; ++dx) {
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dz = -r2; dz <= r2; ++dz) {
+                        int c[3] = { s.b[0] + dx, s.b[1] + dy, s.b[2] + dz };
+                        bool valid = true;
+                        for (int a = 0; a < 3; ++a) {
+                            if (c[a] >= 0 && c[a] < nb[a]) continue;
+                            if (wrap[a]) c[a] = (c[a] + nb[a]) % nb[a];
+                            else valid = false;
+                        }
+                        if (valid && (amr->flag[(c[0] * amr->nby + c[1]) * amr->nbz + c[2]] & 1)) {
+                            amr->flag[b] |= 2;
+                        }
+                    }
+                }
+            }
+        }
+        amr->nlist = 0;
+        amr->nfresh = 0;
+        amr->fine_cells = 0;
+        for (int b = 0; b < amr->count; ++b) {
+            const int on = (amr->flag[b] & 2) ? 1 : 0;
+            if (on && !amr->refined[b]) amr->fresh[amr->nfresh++] = b;
+            amr->refined[b] = (unsigned char)on;
+            if (on) {
+                const BlockSpan s = blockSpan(amr, params, b);
+                amr->list[amr->nlist++] = b;
+                amr->fine_cells += (long)s.n[0] * s.n[1] * s.n[2] * ((DIM == 3) ? 8 : 4);
+            }
+        }
+    }
+
+    // New patches: interpolated from the coarse cells they cover
+    #pragma omp for schedule(dynamic)
+    for (int n = 0; n < amr->nfresh; ++n) {
+        const int b = amr->fresh[n];
+        const BlockSpan s = blockSpan(amr, params, b);
+        const int *fs = amr->strides;
+        const int m[3] = { 2 * s.n[0], 2 * s.n[1], (DIM == 3) ? 2 * s.n[2] : 1 };
+        const Real *coarse[2] = { phiC, tempC };
+        for (int f = 0; f < 2; ++f) {
+            Real *p = patchField(amr, b, f, amr->gen);
+            for (int l0 = 1; l0 <= m[0]; ++l0) {
+                for (int l1 = 1; l1 <= m[1]; ++l1) {
+                    for (int l2 = 1; l2 <= m[2]; ++l2) {
+                        const int g[3] = { 2 * s.first[0] + l0 - 1, 2 * s.first[1] + l1 - 1,
+                                           (DIM == 3) ? 2 * s.first[2] + l2 - 1 : 0 };
+                        const double h[3] = { (g[0] & 1) ? 0.25 : -0.25, (g[1] & 1) ? 0.25 : -0.25,
+                                              (g[2] & 1) ? 0.25 : -0.25 };
+                        const int idx = (g[0] / 2 + 1) * cs[0] + (g[1] / 2 + 1) * cs[1]
+                                      + ((DIM == 3) ? g[2] / 2 + 1 : 0);
+                        p[l0 * fs[0] + l1 * fs[1] + ((DIM == 3) ? l2 : 0)] =
+                            interpolateCoarse<DIM>(coarse[f], idx, cs, h);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Set up the block grid, the patch parameters and storage, and one
+ * kernel workspace per thread. Leaves the hierarchy empty unless AMR; call
+ * after the thread count has been resolved into params->NUM_THREADS.
+ *
+ * The patches take as many substeps per coarse step as the explicit
+ * stability limit of the fine spacing requires.
+ */
+void setupAmr(const SimParams *params, AmrLevel *amr) {
+    std::memset(amr, 0, sizeof(*amr));
+    if (!params->AMR) return;
+
+    const int B = params->AMR_BLOCK;
+    amr->block = B;
+    amr->nbx = (params->Num_X - 2 + B - 1) / B;
+    amr->nby = (params->Num_Y - 2 + B - 1) / B;
+    amr->nbz = (params->DIM == 3) ? (params->Num_Z - 2 + B - 1) / B : 1;
+    amr->count = amr->nbx * amr->nby * amr->nbz;
+    amr->faceCells = (params->DIM == 3) ? B * B : B;
+
+    SimParams *fine = &amr->fine;
+    *fine = *params;
+    fine->Num_X = 2 * B + 2;
+    fine->Num_Y = 2 * B + 2;
+    fine->Num_Z = (params->DIM == 3) ? 2 * B + 2 : 1;
+    fine->dx = 0.5 * params->dx;
+    fine->dy = 0.5 * params->dy;
+    if (params->DIM == 3) fine->dz = 0.5 * params->dz;
+    amr->substeps = (int)std::ceil(params->dt / stableTimestep(fine) - 1e-9);
+    if (amr->substeps < 1) amr->substeps = 1;
+    fine->dt = params->dt / amr->substeps;
+    fine->AMR = 0;
+    fine->BLOCK_STEPS = 0;
+    fine->global_x = nullptr;
+    fine->band = nullptr;
+    fine->tiles = nullptr;
+    fieldStrides(fine, amr->strides);
+
+    const FaceBoundary none = { BOUNDARY_UNDEFINED, BOUNDARY_UNDEFINED, BOUNDARY_UNDEFINED,
+                                BOUNDARY_UNDEFINED, BOUNDARY_UNDEFINED, BOUNDARY_UNDEFINED };
+    amr->phiBC = amr->tempBC = none;
+    for (int v = 0; v < params->numVariables; ++v) {
+        if (std::strcmp(params->variables[v].varName, "phi") == 0)  amr->phiBC  = params->variables[v].bc;
+        if (std::strcmp(params->variables[v].varName, "temp") == 0) amr->tempBC = params->variables[v].bc;
+    }
+
+    // Both generations of phi and temp for every block; pages of blocks that
+    // are never refined stay untouched
+    createArena(&amr->pool, 4 * amr->count, fieldArrayBytes(fine, amr->strides));
+    amr->refined = (unsigned char*)std::calloc(amr->count, 1);
+    amr->flag    = (unsigned char*)std::calloc(amr->count, 1);
+    amr->list    = (int*)std::malloc(amr->count * sizeof(int));
+    amr->fresh   = (int*)std::malloc(amr->count * sizeof(int));
+    amr->flux    = (double*)std::calloc((size_t)amr->count * 2 * params->DIM * amr->faceCells, sizeof(double));
+    amr->nworkspaces = params->NUM_THREADS;
+    amr->ws = (TileWorkspace*)std::malloc(amr->nworkspaces * sizeof(TileWorkspace));
+    if (!amr->refined || !amr->flag || !amr->list || !amr->fresh || !amr->flux || !amr->ws) {
+        std::fprintf(stderr, "Error: Could not allocate the refinement tables.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    for (int w = 0; w < amr->nworkspaces; ++w) {
+        TileWorkspace *ws = &amr->ws[w];
+        ws->params = *fine;
+        createArena(&ws->arena, fieldBufferCount(fine), fieldArrayBytes(fine, amr->strides));
+        allocateFieldBuffers(fine, &ws->fb, &ws->arena);
+        ws->phi = nullptr;
+        ws->temp = nullptr;
+    }
+
+    std::printf("AMR: %d block(s) of %d^%d coarse cells, fine spacing %g, %d substep(s) of %g per step\n",
+                amr->count, B, params->DIM, fine->dx, amr->substeps, fine->dt);
+}
+
+/**
+ * @brief Refine around the interface of the initial fields and fill the
+ * first patches. Orphaned omp for; call on every thread before the first step.
+ */
+void buildAmr(Real *phi, Real *temp, AmrLevel *amr, const SimParams *params,
+              const KernelTable *kt, int strides[]) {
+    if (!params->AMR) return;
+    Real *fields[2] = { phi, temp };
+    const BoundaryKernel boundaries[2] = { kt->phiBoundary, kt->tempBoundary };
+    applyBoundaryConditions(fields, boundaries, 2, params, strides);
+    if (params->DIM == 3) {
+        regrid<3>(amr, params, strides, phi, temp);
+    } else {
+        regrid<2>(amr, params, strides, phi, temp);
+    }
+}
+
+template <int DIM>
+static void advanceLevel(Real *phi, Real *temp, FieldBuffers *fb, AmrLevel *amr, const SimParams *params,
+                         const KernelTable *kt, int strides[], int step) {
+    Real *fields[2] = { fb->phi_new, fb->temp_new };
+    const BoundaryKernel boundaries[2] = { kt->phiBoundary, kt->tempBoundary };
+    Real *const c0[2] = { phi, temp };
+    Real *const c1[2] = { fb->phi_new, fb->temp_new };
+
+    // Ghosts of the new coarse generation, for the interpolation in time
+    applyBoundaryConditions(fields, boundaries, 2, params, strides);
+
+    for (int sub = 0; sub < amr->substeps; ++sub) {
+        const double theta = (double)sub / amr->substeps;
+        #pragma omp for schedule(dynamic)
+        for (int n = 0; n < amr->nlist; ++n) {
+            const int b = amr->list[n];
+#ifdef _OPENMP
+            TileWorkspace *ws = &amr->ws[omp_get_thread_num()];
+#else
+            TileWorkspace *ws = &amr->ws[0];
+#endif
+            preparePatch<DIM>(amr, b, params, strides, c0, c1, theta, sub == 0);
+            // The kernels' orphaned omp for bind to this one-thread region
+            #pragma omp parallel num_threads(1)
+            advancePatch<DIM>(amr, b, ws, params, kt, step * amr->substeps + sub);
+        }
+        #pragma omp single
+        amr->gen ^= 1;
+    }
+
+    #pragma omp for schedule(dynamic)
+    for (int n = 0; n < amr->nlist; ++n) {
+        restrictPatch<DIM>(amr, amr->list[n], params, strides, fb->phi_new, fb->temp_new);
+    }
+    #pragma omp single
+    {
+        refluxTemp<DIM>(amr, params, strides, temp, fb->temp_new);
+        const double coarse = interiorCells(params);
+        const double updates = coarse + (double)amr->fine_cells * amr->substeps;
+        amr->interval_blocks += amr->nlist;
+        amr->interval_updates += updates;
+        amr->interval_steps++;
+        amr->total_blocks += amr->nlist;
+        amr->total_updates += updates;
+        amr->total_steps++;
+    }
+
+    // Ghosts again after the restriction, for the slopes of new patches
+    applyBoundaryConditions(fields, boundaries, 2, params, strides);
+    regrid<DIM>(amr, params, strides, fb->phi_new, fb->temp_new);
+}
+
+/**
+ * @brief Advance the patches over the coarse step just taken, then restrict
+ * them onto the coarse level, correct the coarse temperature next to them
+ * and regrid. Orphaned omp for; call on every thread after the coarse
+ * update and before the generations are swapped.
+ *
+ * @param phi     Coarse phi at the start of the step
+ * @param temp    Coarse temp at the start of the step
+ * @param fb      Coarse buffers; phi_new and temp_new hold the end of the step
+ * @param amr     Hierarchy from setupAmr
+ * @param params  Simulation parameters
+ * @param kt      Selected kernels, applied to the patches
+ * @param strides Strides of the coarse arrays
+ * @param step    Number of the coarse step (noise counter)
+ */
+void advanceAmr(Real *phi, Real *temp, FieldBuffers *fb, AmrLevel *amr, const SimParams *params,
+                const KernelTable *kt, int strides[], int step) {
+    if (params->DIM == 3) {
+        advanceLevel<3>(phi, temp, fb, amr, params, kt, strides, step);
+    } else {
+        advanceLevel<2>(phi, temp, fb, amr, params, kt, strides, step);
+    }
+}
+
+template <int DIM>
+static void resampleField(const AmrLevel *amr, const SimParams *params, const int cs[], int field,
+                          const Real *coarse, Real *out, const int us[]) {
+    const int *fs = amr->strides;
+    for (int b = 0; b < amr->count; ++b) {
+        const BlockSpan s = blockSpan(amr, params, b);
+        const int m[3] = { 2 * s.n[0], 2 * s.n[1], (DIM == 3) ? 2 * s.n[2] : 1 };
+        const Real *p = amr->refined[b] ? patchField(amr, b, field, amr->gen) : nullptr;
+        for (int l0 = 1; l0 <= m[0]; ++l0) {
+            for (int l1 = 1; l1 <= m[1]; ++l1) {
+                for (int l2 = 1; l2 <= m[2]; ++l2) {
+                    const int g[3] = { 2 * s.first[0] + l0 - 1, 2 * s.first[1] + l1 - 1,
+                                       (DIM == 3) ? 2 * s.first[2] + l2 - 1 : 0 };
+                    const int o = (g[0] + 1) * us[0] + (g[1] + 1) * us[1] + ((DIM == 3) ? g[2] + 1 : 0);
+                    if (p) {
+                        out[o] = p[l0 * fs[0] + l1 * fs[1] + ((DIM == 3) ? l2 : 0)];
+                    } else {
+                        const double h[3] = { (g[0] & 1) ? 0.25 : -0.25, (g[1] & 1) ? 0.25 : -0.25,
+                                              (g[2] & 1) ? 0.25 : -0.25 };
+                        const int idx = (g[0] / 2 + 1) * cs[0] + (g[1] / 2 + 1) * cs[1]
+                                      + ((DIM == 3) ? g[2] / 2 + 1 : 0);
+                        out[o] = interpolateCoarse<DIM>(coarse, idx, cs, h);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Write phi and temp on the uniform grid of the fine spacing, as
+ * output/phi_fine_<step> and output/temp_fine_<step> (VTK or CSV like the
+ * coarse output): the patches where there are, elsewhere the interpolation
+ * of the coarse level. Called serially (omp single) with the current
+ * generation of the coarse fields.
+ */
+void writeAmrFields(const AmrLevel *amr, Real *phi, Real *temp, const SimParams *params,
+                    int strides[], int step) {
+    if (!params->AMR) return;
+    SimParams u = amr->fine;
+    u.Num_X = 2 * (params->Num_X - 2) + 2;
+    u.Num_Y = 2 * (params->Num_Y - 2) + 2;
+    u.Num_Z = (params->DIM == 3) ? 2 * (params->Num_Z - 2) + 2 : 1;
+    int us[MAX_DIM];
+    fieldStrides(&u, us);
+    Real *out = (Real*)std::calloc((size_t)u.Num_X * us[0], sizeof(Real));
+    if (!out) {
+        std::fprintf(stderr, "Warning: Could not allocate the resampled fine grid; skipping it.\n");
+        return;
+    }
+
+    const char *names[2] = { "phi", "temp" };
+    const Real *coarse[2] = { phi, temp };
+    for (int f = 0; f < 2; ++f) {
+        if (params->DIM == 3) {
+            resampleField<3>(amr, params, strides, f, coarse[f], out, us);
+        } else {
+            resampleField<2>(amr, params, strides, f, coarse[f], out, us);
+        }
+        char filename[256];
+        std::snprintf(filename, sizeof(filename), "output/%s_fine_%d.%s", names[f], step,
+                      params->WRITE_TO_VTK ? "vtk" : "csv");
+        if (params->WRITE_TO_VTK) {
+            write_output_vtk(filename, out, &u, us);
+        } else if (params->WRITE_TO_CSV) {
+            write_output_csv(filename, out, &u, us);
+        }
+    }
+    std::free(out);
+}
+
+/**
+ * @brief Start timing an output interval; called serially (omp single).
+ */
+void startAmrInterval(AmrLevel *amr) {
+    amr->interval_start = wallSeconds();
+}
+
+/**
+ * @brief Refined share and throughput of the output interval ending at
+ * step; called serially (omp single), before the output is written.
+ *
+ * The share of updates and the throughput are those of the uniform grid of
+ * the fine spacing, stepped at dt / substeps, so the throughput compares
+ * directly with a run on that grid.
+ */
+void reportAmrInterval(AmrLevel *amr, const SimParams *params, int step) {
+    const double fine = interiorCells(params) * ((params->DIM == 3) ? 8.0 : 4.0) * amr->substeps;
+    const double seconds = wallSeconds() - amr->interval_start;
+    const int steps = amr->interval_steps;
+    std::printf("AMR, steps %d-%d: %.2f%% of the blocks refined, %.2f%% of the fine-grid cell updates, %.3f s, %.2f Mcell-updates/s\n",
+                step - steps + 1, step,
+                (steps > 0) ? 100.0 * amr->interval_blocks / ((double)steps * amr->count) : 0.0,
+                (steps > 0) ? 100.0 * amr->interval_updates / (fine * steps) : 0.0, seconds,
+                cellRate(fine, steps, seconds));
+    amr->interval_blocks = 0.0;
+    amr->interval_updates = 0.0;
+    amr->interval_steps = 0;
+}
+
+/**
+ * @brief Refined share over the run; prints nothing unless AMR.
+ */
+void printAmrReport(const AmrLevel *amr, const SimParams *params) {
+    if (!params->AMR || amr->total_steps == 0) return;
+    const double fine = interiorCells(params) * ((params->DIM == 3) ? 8.0 : 4.0) * amr->substeps;
+    std::printf("AMR: %.2f%% of the blocks refined and %.2f%% of the fine-grid cell updates over %ld steps, %d blocks of %d^%d cells\n",
+                100.0 * amr->total_blocks / ((double)amr->total_steps * amr->count),
+                100.0 * amr->total_updates / (fine * amr->total_steps),
+                amr->total_steps, amr->count, amr->block, params->DIM);
+}
+
+/**
+ * @brief Release the patches, the tables and the workspaces.
+ */
+void freeAmr(AmrLevel *amr) {
+    for (int w = 0; w < amr->nworkspaces; ++w) {
+        releaseArena(&amr->ws[w].arena);
+    }
+    std::free(amr->ws);
+    releaseArena(&amr->pool);
+    std::free(amr->refined);
+    std::free(amr->flag);
+    std::free(amr->list);
+    std::free(amr->fresh);
+    std::free(amr->flux);
+    std::memset(amr, 0, sizeof(*amr));
+}
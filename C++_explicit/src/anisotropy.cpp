@@ -1,8 +1,19 @@
 #include "header.hpp"
+#include "kernels.hpp"
+#include "vecmath.hpp"
 #include <cmath>
 
 // Macro to compute flattened array index for 3D data
-#define IDX(i, j, k) ((i) * strides[0] + (j) * strides[1] + (k) * strides[2])
+#define IDX(i, j, k) ((i) * sx + (j) * sy + (k))
+
+// anisotropyAt for one face direction, rounded to the storage type
+template <int J>
+static inline void anisotropyStore(Accum gx, Accum gy, const AnisotropyCoeffs &c, Real *ac, Real *ac_p) {
+    Accum a, a_p;
+    anisotropyAt<J>(gx, gy, c, &a, &a_p);
+    *ac   = a;
+    *ac_p = a_p;
+}
 
 /**
  * @brief Compute anisotropy functions and their derivatives for the phase-field.
@@ -12,56 +23,101 @@
  *   a_c = epsilon* [1 + delta cos(j (theta - theta0))]
  *   a_p = -epsilon * delta * j * sin(j (theta - theta0))
  * Then computes the same for neighboring derivative directions.
+ * With ANISOTROPY_ENGINE = ALGEBRAIC the trig calls are replaced by
+ * multiple-angle identities (see anisotropyAt in kernels.hpp). With
+ * NARROW_BAND only the band cells are visited, with TILE_SKIP only the
+ * active tiles.
  *
+ * @tparam DIM    Spatial dimension (2 or 3)
+ * @tparam J      Anisotropy symmetry for the algebraic engine (4, 6) or 0 for trig
  * @param fb      FieldBuffers containing gradient arrays and outputs for anisotropy
  * @param params  Simulation parameters including epsilon, delta, j, theta0, grid dims
  * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1]
  */
-void computeAnisotropy(FieldBuffers *fb, const SimParams *params, int strides[]) {
-    int NX = params->Num_X;
-    int NY = params->Num_Y;
-    int NZ = params->Num_Z;
-    int dim = params->DIM;
-    const double eps   = params->epsilon;
-    const double delta = params->delta;
-    const int    jmult = params->j;
-    const double theta0= params->theta_0;
+template <int DIM, int J>
+void computeAnisotropyKernel(FieldBuffers *fb, const SimParams *params, int strides[]) {
+    const Interior<DIM> g(params, strides);
+    const int sx = g.sx;
+    const int sy = g.sy;
+    const AnisotropyCoeffs coeffs = makeAnisotropyCoeffs(params);
 
     // Loop over interior grid (assuming k=0 for 2D or first layer for 3D)
-    for (int i = 1; i < NX - 1; ++i) {
-        for (int j = 1; j < NY - 1; ++j) {
-            int idx = IDX(i, j, (dim==3)?1:0);
-
-            // Compute interface normal angle
-            double theta = std::atan2(fb->DERY_c[idx], fb->DERX_c[idx]);
-            // Anisotropy and its derivative
-            fb->ac[idx]   = eps * (1.0 + delta * std::cos(jmult * (theta - theta0)));
-            fb->ac_p[idx] = -eps * (delta * jmult * std::sin(jmult * (theta - theta0)));
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        int jlo, jhi;
+        for (int jpos = 0; g.nextJSegment(i, &jpos, &jlo, &jhi); ) {
+            for (int j = jlo; j < jhi; ++j) {
+                int idx = IDX(i, j, g.kstart);
 
-            // Neighbors' interface angles
-            double theta_r = std::atan2(fb->DERY_right[idx],  fb->DERX_right[idx]);
-            double theta_l = std::atan2(fb->DERY_left[idx],   fb->DERX_left[idx]);
-            double theta_t = std::atan2(fb->DERY_top[idx],    fb->DERX_top[idx]);
-            double theta_b = std::atan2(fb->DERY_bottom[idx], fb->DERX_bottom[idx]);
+                // Anisotropy and its derivative from the interface normal angle
+                anisotropyStore<J>(fb->DERX_c[idx], fb->DERY_c[idx], coeffs, &fb->ac[idx], &fb->ac_p[idx]);
 
-            // Anisotropy at neighbors
-            fb->ac_right[idx]  = eps * (1.0 + delta * std::cos(jmult * (theta_r - theta0)));
-            fb->ac_left[idx]   = eps * (1.0 + delta * std::cos(jmult * (theta_l - theta0)));
-            fb->ac_top[idx]    = eps * (1.0 + delta * std::cos(jmult * (theta_t - theta0)));
-            fb->ac_bottom[idx] = eps * (1.0 + delta * std::cos(jmult * (theta_b - theta0)));
-
-            // Derivative of anisotropy at neighbors
-            fb->ac_p_right[idx]  = -eps * (delta * jmult * std::sin(jmult * (theta_r - theta0)));
-            fb->ac_p_left[idx]   = -eps * (delta * jmult * std::sin(jmult * (theta_l - theta0)));
-            fb->ac_p_top[idx]    = -eps * (delta * jmult * std::sin(jmult * (theta_t - theta0)));
-            fb->ac_p_bottom[idx] = -eps * (delta * jmult * std::sin(jmult * (theta_b - theta0)));
+                // Anisotropy and its derivative at neighbors
+                anisotropyStore<J>(fb->DERX_right[idx],  fb->DERY_right[idx],  coeffs, &fb->ac_right[idx],   &fb->ac_p_right[idx]);
+                anisotropyStore<J>(fb->DERX_left[idx],   fb->DERY_left[idx],   coeffs, &fb->ac_left[idx],    &fb->ac_p_left[idx]);
+                anisotropyStore<J>(fb->DERX_top[idx],    fb->DERY_top[idx],    coeffs, &fb->ac_top[idx],     &fb->ac_p_top[idx]);
+                anisotropyStore<J>(fb->DERX_bottom[idx], fb->DERY_bottom[idx], coeffs, &fb->ac_bottom[idx],  &fb->ac_p_bottom[idx]);
+            }
         }
     }
 }
 
-#undef IDX
-
+/**
+ * @brief computeAnisotropy with the SIMD atan2/sincos from vecmath.hpp (MATH_MODE = VECTOR).
+ *
+ * Evaluates the trig form of the anisotropy for VM_LANES cells along j at a
+ * time; the last partial register of a row is zero-padded. Covers the same
+ * cells as computeAnisotropyKernel.
+ *
+ * @tparam DIM    Spatial dimension (2 or 3)
+ * @param fb      FieldBuffers containing gradient arrays and outputs for anisotropy
+ * @param params  Simulation parameters including epsilon, delta, j, theta0, grid dims
+ * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1]
+ */
+template <int DIM>
+void computeAnisotropyVectorKernel(FieldBuffers *fb, const SimParams *params, int strides[]) {
+    const Interior<DIM> g(params, strides);
+    const int sx = g.sx;
+    const int sy = g.sy;
+    const double eps    = params->epsilon;
+    const double delta  = params->delta;
+    const double jmult  = params->j;
+    const double theta0 = params->theta_0;
 
+    // Gradient inputs and anisotropy outputs: centre, right, left, top, bottom
+    const Real *gxs[5]  = {fb->DERX_c, fb->DERX_right, fb->DERX_left, fb->DERX_top, fb->DERX_bottom};
+    const Real *gys[5]  = {fb->DERY_c, fb->DERY_right, fb->DERY_left, fb->DERY_top, fb->DERY_bottom};
+    Real       *acs[5]  = {fb->ac,   fb->ac_right,   fb->ac_left,   fb->ac_top,   fb->ac_bottom};
+    Real       *acps[5] = {fb->ac_p, fb->ac_p_right, fb->ac_p_left, fb->ac_p_top, fb->ac_p_bottom};
 
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        int jlo, jhi;
+        for (int jpos = 0; g.nextJSegment(i, &jpos, &jlo, &jhi); ) {
+            for (int j = jlo; j < jhi; j += VM_LANES) {
+                const int lanes = (jhi - j < VM_LANES) ? jhi - j : VM_LANES;
+                const int idx = IDX(i, j, g.kstart);
+                for (int f = 0; f < 5; ++f) {
+                    vm_double gx = vm_load_strided(gxs[f] + idx, sy, lanes);
+                    vm_double gy = vm_load_strided(gys[f] + idx, sy, lanes);
+                    vm_double theta = vm_atan2(gy, gx);
+                    vm_double s, c;
+                    vm_sincos(jmult * (theta - theta0), &s, &c);
+                    vm_store_strided(acs[f]  + idx, sy, eps * (1.0 + delta * c), lanes);
+                    vm_store_strided(acps[f] + idx, sy, -eps * (delta * jmult * s), lanes);
+                }
+            }
+        }
+    }
+}
 
+template void computeAnisotropyKernel<2, 0>(FieldBuffers*, const SimParams*, int[]);
+template void computeAnisotropyKernel<2, 4>(FieldBuffers*, const SimParams*, int[]);
+template void computeAnisotropyKernel<2, 6>(FieldBuffers*, const SimParams*, int[]);
+template void computeAnisotropyKernel<3, 0>(FieldBuffers*, const SimParams*, int[]);
+template void computeAnisotropyKernel<3, 4>(FieldBuffers*, const SimParams*, int[]);
+template void computeAnisotropyKernel<3, 6>(FieldBuffers*, const SimParams*, int[]);
+template void computeAnisotropyVectorKernel<2>(FieldBuffers*, const SimParams*, int[]);
+template void computeAnisotropyVectorKernel<3>(FieldBuffers*, const SimParams*, int[]);
 
+#undef IDX
@@ -1,97 +1,182 @@
 #include "header.hpp"
+#include "kernels.hpp"
 
-/**
- * @brief Apply boundary conditions to a 3D (or 2D) array slice.
- *
- * For each face (left/right, bottom/top, back/front), applies either
- * periodic or no-flux (Neumann) boundary conditions by copying from
- * the appropriate interior reference cell.
+/*
+ * boundary.cpp
  *
- * @param arr     Pointer to the data array (flattened 3D)
- * @param params  Simulation parameters containing grid dimensions
- * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1]
- * @param bc      FaceBoundary specifying conditions per direction
+ * Ghost-cell boundary conditions. Each pair of opposite faces is handled by
+ * a kernel specialized at compile time on the dimension and on the boundary
+ * type of both faces, so the loops carry no per-cell branches:
+ *  - BoundaryX/Y/Z: face-pair kernels (left/right, bottom/top, back/front)
+ *    over a range of rows of the face
+ *  - selectBoundaryKernel: pick the instantiations for a FaceBoundary once
+ *  - applyBoundaryConditions: refill all faces of several fields in one pass
  */
-void applyBoundaryConditions(double *arr, const SimParams *params, int strides[], FaceBoundary bc) {
-    int NX = params->Num_X;
-    int NY = params->Num_Y;
-    int NZ = params->Num_Z;
-    int dim = params->DIM;
 
-    // Macro to index flattened array
-    #define IDX(i, j, k) ((i) * strides[0] + (j) * strides[1] + (k) * strides[2])
+// Face rows per work item of applyBoundaryConditions
+#define BOUNDARY_CHUNK 32
 
-    // X-direction boundaries
-    for (int j = 1; j < NY - 1; ++j) {
-        int kstart = (dim == 3) ? 1 : 0;
-        int kend   = (dim == 3) ? NZ - 1 : 1;
-        for (int k = kstart; k < kend; ++k) {
-            int left_idx  = (dim == 2) ? (0 * strides[0] + j * strides[1]) : IDX(0, j, k);
-            int right_idx = (dim == 2) ? ((NX - 1) * strides[0] + j * strides[1]) : IDX(NX - 1, j, k);
-            int lref_idx  = (dim == 2) ? (1 * strides[0] + j * strides[1]) : IDX(1, j, k);
-            int rref_idx  = (dim == 2) ? ((NX - 2) * strides[0] + j * strides[1]) : IDX(NX - 2, j, k);
+/**
+ * @brief Fill one ghost cell from the interior according to the boundary type.
+ *
+ * @param arr      Data array.
+ * @param ghost    Index of the ghost cell.
+ * @param near_ref Adjacent interior cell (no-flux reference).
+ * @param far_ref  Interior cell on the opposite side (periodic reference).
+ */
+template <BoundaryType BC>
+static inline void fillGhost(Real *arr, int ghost, int near_ref, int far_ref) {
+    if (BC == BOUNDARY_PERIODIC)
+        arr[ghost] = arr[far_ref];
+    else if (BC == BOUNDARY_NOFLUX)
+        arr[ghost] = arr[near_ref];
+}
 
-            // Left face
-            if (bc.left == BOUNDARY_PERIODIC)
-                arr[left_idx] = arr[rref_idx];
-            else if (bc.left == BOUNDARY_NOFLUX)
-                arr[left_idx] = arr[lref_idx];
+/**
+ * @brief Left (i = 0) and right (i = NX-1) faces, rows j in [begin, end).
+ */
+template <int DIM, BoundaryType LEFT, BoundaryType RIGHT>
+struct BoundaryX {
+    static void apply(Real *arr, const SimParams *params, int strides[], int begin, int end) {
+        const Interior<DIM> g(params, strides);
+        const int last = (g.NX - 1) * g.sx;
+        const int lref = g.sx;
+        const int rref = (g.NX - 2) * g.sx;
 
-            // Right face
-            if (bc.right == BOUNDARY_PERIODIC)
-                arr[right_idx] = arr[lref_idx];
-            else if (bc.right == BOUNDARY_NOFLUX)
-                arr[right_idx] = arr[rref_idx];
+        for (int j = begin; j < end; ++j) {
+            for (int k = g.kstart; k < g.kend; ++k) {
+                int off = j * g.sy + k;
+                fillGhost<LEFT>(arr, off, lref + off, rref + off);
+                fillGhost<RIGHT>(arr, last + off, rref + off, lref + off);
+            }
         }
     }
+};
 
-    // Y-direction boundaries
-    for (int i = 1; i < NX - 1; ++i) {
-        int kstart = (dim == 3) ? 1 : 0;
-        int kend   = (dim == 3) ? NZ - 1 : 1;
-        for (int k = kstart; k < kend; ++k) {
-            int bot_idx = (dim == 2) ? (i * strides[0] + 0 * strides[1]) : IDX(i, 0, k);
-            int top_idx = (dim == 2) ? (i * strides[0] + (NY - 1) * strides[1]) : IDX(i, NY - 1, k);
-            int bref_idx= (dim == 2) ? (i * strides[0] + 1 * strides[1]) : IDX(i, 1, k);
-            int tref_idx= (dim == 2) ? (i * strides[0] + (NY - 2) * strides[1]) : IDX(i, NY - 2, k);
-
-            // Bottom face
-            if (bc.bottom == BOUNDARY_PERIODIC)
-                arr[bot_idx] = arr[tref_idx];
-            else if (bc.bottom == BOUNDARY_NOFLUX)
-                arr[bot_idx] = arr[bref_idx];
+/**
+ * @brief Bottom (j = 0) and top (j = NY-1) faces, rows i in [begin, end).
+ */
+template <int DIM, BoundaryType BOTTOM, BoundaryType TOP>
+struct BoundaryY {
+    static void apply(Real *arr, const SimParams *params, int strides[], int begin, int end) {
+        const Interior<DIM> g(params, strides);
+        const int last = (g.NY - 1) * g.sy;
+        const int bref = g.sy;
+        const int tref = (g.NY - 2) * g.sy;
 
-            // Top face
-            if (bc.top == BOUNDARY_PERIODIC)
-                arr[top_idx] = arr[bref_idx];
-            else if (bc.top == BOUNDARY_NOFLUX)
-                arr[top_idx] = arr[tref_idx];
+        for (int i = begin; i < end; ++i) {
+            for (int k = g.kstart; k < g.kend; ++k) {
+                int off = i * g.sx + k;
+                fillGhost<BOTTOM>(arr, off, bref + off, tref + off);
+                fillGhost<TOP>(arr, last + off, tref + off, bref + off);
+            }
         }
     }
+};
 
-    // Z-direction boundaries (3D only)
-    if (dim == 3) {
-        for (int i = 1; i < NX - 1; ++i) {
-            for (int j = 1; j < NY - 1; ++j) {
-                int back_idx  = IDX(i, j, 0);
-                int front_idx = IDX(i, j, NZ - 1);
-                int bref_idx  = IDX(i, j, 1);
-                int fref_idx  = IDX(i, j, NZ - 2);
-
-                // Back face
-                if (bc.back == BOUNDARY_PERIODIC)
-                    arr[back_idx] = arr[fref_idx];
-                else if (bc.back == BOUNDARY_NOFLUX)
-                    arr[back_idx] = arr[bref_idx];
+/**
+ * @brief Back (k = 0) and front (k = NZ-1) faces, rows i in [begin, end), 3D only.
+ */
+template <int DIM, BoundaryType BACK, BoundaryType FRONT>
+struct BoundaryZ {
+    static void apply(Real *arr, const SimParams *params, int strides[], int begin, int end) {
+        const Interior<DIM> g(params, strides);
+        const int last = params->Num_Z - 1;
+        const int fref = params->Num_Z - 2;
 
-                // Front face
-                if (bc.front == BOUNDARY_PERIODIC)
-                    arr[front_idx] = arr[bref_idx];
-                else if (bc.front == BOUNDARY_NOFLUX)
-                    arr[front_idx] = arr[fref_idx];
+        for (int i = begin; i < end; ++i) {
+            for (int j = 1; j < g.NY - 1; ++j) {
+                int off = i * g.sx + j * g.sy;
+                fillGhost<BACK>(arr, off, 1 + off, fref + off);
+                fillGhost<FRONT>(arr, last + off, fref + off, 1 + off);
             }
         }
     }
+};
 
-    #undef IDX
+// Resolve the runtime boundary type of the second face.
+template <template <int, BoundaryType, BoundaryType> class Face, int DIM, BoundaryType LO>
+static BoundaryFaceFn selectFaceHi(BoundaryType hi) {
+    switch (hi) {
+        case BOUNDARY_NOFLUX:   return Face<DIM, LO, BOUNDARY_NOFLUX>::apply;
+        case BOUNDARY_PERIODIC: return Face<DIM, LO, BOUNDARY_PERIODIC>::apply;
+        default:                return Face<DIM, LO, BOUNDARY_UNDEFINED>::apply;
+    }
 }
+
+// Resolve the runtime boundary types of a face pair.
+template <template <int, BoundaryType, BoundaryType> class Face, int DIM>
+static BoundaryFaceFn selectFace(BoundaryType lo, BoundaryType hi) {
+    switch (lo) {
+        case BOUNDARY_NOFLUX:   return selectFaceHi<Face, DIM, BOUNDARY_NOFLUX>(hi);
+        case BOUNDARY_PERIODIC: return selectFaceHi<Face, DIM, BOUNDARY_PERIODIC>(hi);
+        default:                return selectFaceHi<Face, DIM, BOUNDARY_UNDEFINED>(hi);
+    }
+}
+
+/**
+ * @brief Select the specialized face-pair kernels for a set of boundary conditions.
+ *
+ * @param params  Simulation parameters (DIM)
+ * @param bc      FaceBoundary specifying conditions per direction
+ * @return BoundaryKernel with X, Y and (in 3D) Z face-pair kernels
+ */
+BoundaryKernel selectBoundaryKernel(const SimParams *params, FaceBoundary bc) {
+    BoundaryKernel bk;
+    if (params->DIM == 3) {
+        bk.faceX = selectFace<BoundaryX, 3>(bc.left, bc.right);
+        bk.faceY = selectFace<BoundaryY, 3>(bc.bottom, bc.top);
+        bk.faceZ = selectFace<BoundaryZ, 3>(bc.back, bc.front);
+    } else {
+        bk.faceX = selectFace<BoundaryX, 2>(bc.left, bc.right);
+        bk.faceY = selectFace<BoundaryY, 2>(bc.bottom, bc.top);
+        bk.faceZ = nullptr;
+    }
+    return bk;
+}
+
+/**
+ * @brief Apply boundary conditions to several fields in one pass.
+ *
+ * For each face (left/right, bottom/top, back/front), applies either
+ * periodic or no-flux (Neumann) boundary conditions by copying from
+ * the appropriate interior reference cell. The rows of all faces are cut
+ * into chunks of BOUNDARY_CHUNK and shared out by a single orphaned omp
+ * for, so the whole ghost update costs one barrier; each chunk is applied
+ * to every field in turn while its rows are in cache. Faces only read
+ * interior cells, so the chunks are independent.
+ *
+ * @param arrs    Data arrays (flattened 3D), one per field
+ * @param bks     Face-pair kernels from selectBoundaryKernel, one per field
+ * @param nfields Number of fields
+ * @param params  Simulation parameters containing grid dimensions
+ * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1]
+ */
+void applyBoundaryConditions(Real *const arrs[], const BoundaryKernel bks[], int nfields,
+                             const SimParams *params, int strides[]) {
+    const int xrows = params->Num_Y - 2;   // X faces run over j
+    const int irows = params->Num_X - 2;   // Y and Z faces run over i
+    const int xitems = (xrows + BOUNDARY_CHUNK - 1) / BOUNDARY_CHUNK;
+    const int iitems = (irows + BOUNDARY_CHUNK - 1) / BOUNDARY_CHUNK;
+    const int nitems = xitems + ((params->DIM == 3) ? 2 : 1) * iitems;
+
+    #pragma omp for schedule(static)
+    for (int item = 0; item < nitems; ++item) {
+        int face, chunk, rows;
+        if (item < xitems) {
+            face = 0; chunk = item; rows = xrows;
+        } else {
+            face = 1 + (item - xitems) / iitems;
+            chunk = (item - xitems) % iitems;
+            rows = irows;
+        }
+        const int begin = 1 + chunk * BOUNDARY_CHUNK;
+        const int end = (chunk + 1) * BOUNDARY_CHUNK < rows ? begin + BOUNDARY_CHUNK : rows + 1;
+        for (int f = 0; f < nfields; ++f) {
+            BoundaryFaceFn fn = (face == 0) ? bks[f].faceX : (face == 1) ? bks[f].faceY : bks[f].faceZ;
+            fn(arrs[f], params, strides, begin, end);
+        }
+    }
+}
+
+#undef BOUNDARY_CHUNK
@@ -0,0 +1,491 @@
+#include "header.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+/*
+ * decomposition.cpp
+ *
+ * Distributed-memory domain decomposition (make MPI=1). The interior
+ * x-columns 1..NX-2 of the global grid are split into one contiguous slab
+ * per rank; each rank holds its slab and one halo column on either side as
+ * a rank-local grid (Num_X = owned columns + 2) and runs the regular
+ * kernels on it. The strides do not depend on Num_X, so a column has the
+ * same layout on every rank and in the global grid.
+ *  - initDecomposition: start MPI, rank and rank count
+ *  - decomposeDomain: slab bounds, neighbours, local grid and face kernels
+ *  - advanceDecomposed: one step of phi and temp with the halo exchange
+ *    overlapped with the interior columns
+ *  - writeGlobalField / readGlobalField: output and respawn through rank 0
+ *  - maxOverRanks: maximum of a value over the ranks
+ *  - shareFromRank0: a value of rank 0 on every rank
+ *  - finalizeDecomposition: release the decomposition and stop MPI
+ *
+ * Boundaries: the y and z faces lie inside every slab and use the selected
+ * boundary kernels unchanged. A halo column between two ranks is a copy of
+ * the neighbour's outermost owned column, y/z ghosts included, exactly as
+ * the global grid holds it after applyBoundaryConditions. The x faces of
+ * the global grid are filled by the first and last rank: NOFLUX and
+ * UNDEFINED with the face kernel, PERIODIC by a message from the rank at
+ * the other end whose interior cells only are copied into the ghost column,
+ * as the periodic face kernel does. Noise cell ids and fills use global
+ * column indices, so the result is bitwise identical to a single process
+ * for any rank count and thread count.
+ *
+ * Without MPI (or on one rank) the slab is the whole grid and the
+ * single-process path is used.
+ */
+
+// Halo fields, in the order of the fields passed to the exchange
+enum { HALO_PHI, HALO_TEMP };
+
+#ifdef USE_MPI
+// Requests of the exchange in flight: a receive and a send per side and field
+static MPI_Request haloRequests[4 * HALO_FIELDS];
+
+static MPI_Datatype realType() {
+    return (sizeof(Real) == sizeof(double)) ? MPI_DOUBLE : MPI_FLOAT;
+}
+
+static int peer(int rank) {
+    return (rank < 0) ? MPI_PROC_NULL : rank;
+}
+#endif
+
+/**
+ * @brief Start MPI and record the rank and the number of ranks.
+ *
+ * The MPI calls are made from `omp single` blocks inside the parallel
+ * region, one thread at a time, which needs MPI_THREAD_SERIALIZED.
+ */
+void initDecomposition(int *argc, char ***argv, Decomposition *dec) {
+    std::memset(dec, 0, sizeof(*dec));
+    dec->nranks = 1;
+#ifdef USE_MPI
+    int provided;
+    MPI_Init_thread(argc, argv, MPI_THREAD_SERIALIZED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &dec->rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &dec->nranks);
+    if (provided < MPI_THREAD_SERIALIZED) {
+        if (dec->rank == 0) {
+            std::fprintf(stderr, "Error: the MPI library does not support MPI_THREAD_SERIALIZED.\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+#else
+    (void)argc;
+    (void)argv;
+#endif
+}
+
+/**
+ * @brief Boundary settings of a variable, or UNDEFINED on every face if it has none.
+ */
+static FaceBoundary variableBoundary(const SimParams *params, const char *name) {
+    FaceBoundary bc;
+    bc.top = bc.bottom = bc.left = bc.right = bc.front = bc.back = BOUNDARY_UNDEFINED;
+    for (int v = 0; v < params->numVariables; ++v) {
+        if (std::strcmp(params->variables[v].varName, name) == 0) bc = params->variables[v].bc;
+    }
+    return bc;
+}
+
+/**
+ * @brief Split the global grid into x-slabs and turn params into the local grid.
+ *
+ * On return params->Num_X is the rank-local column count and
+ * params->global_x maps local to global columns; dec->global keeps the
+ * global parameters. Temporal blocking is turned off across ranks.
+ *
+ * @param params  Global parameters on entry, rank-local on return
+ * @param dec     Decomposition from initDecomposition
+ * @return 0 on success, 1 if there are more ranks than interior columns or
+ *         an implicit temperature solver is selected (it couples all ranks)
+ */
+int decomposeDomain(SimParams *params, Decomposition *dec) {
+    dec->global = *params;
+    dec->x_first = 1;
+    if (dec->nranks == 1) return 0;
+
+    const int interior = params->Num_X - 2;
+    const int n = dec->nranks;
+    const int rank = dec->rank;
+    if (n > interior) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: %d ranks for %d interior x columns.\n", n, interior);
+        }
+        return 1;
+    }
+    if (params->SPECTRAL) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: SPECTRAL = 1 is not supported across ranks.\n");
+        }
+        return 1;
+    }
+    if (params->PHI_SOLVER != PHI_EXPLICIT) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: PHI_SOLVER = IMEX is not supported across ranks.\n");
+        }
+        return 1;
+    }
+    if (params->NARROW_BAND) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: NARROW_BAND = 1 is not supported across ranks.\n");
+        }
+        return 1;
+    }
+    if (params->TILE_SKIP) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: TILE_SKIP = 1 is not supported across ranks.\n");
+        }
+        return 1;
+    }
+    if (params->AMR) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: AMR = 1 is not supported across ranks.\n");
+        }
+        return 1;
+    }
+    if (params->MOVING_WINDOW) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: MOVING_WINDOW = 1 is not supported across ranks.\n");
+        }
+        return 1;
+    }
+    if (params->LTS) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: LTS = 1 is not supported across ranks.\n");
+        }
+        return 1;
+    }
+    if (params->TEMP_SOLVER != TEMP_EXPLICIT) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Error: TEMP_SOLVER = %s is not supported across ranks.\n",
+                         (params->TEMP_SOLVER == TEMP_ADI) ? "ADI" : "MULTIGRID");
+        }
+        return 1;
+    }
+    if (params->BLOCK_STEPS > 1) {
+        if (rank == 0) {
+            std::fprintf(stderr, "Note: BLOCK_STEPS is not supported across ranks; stepping without temporal blocking.\n");
+        }
+        params->BLOCK_STEPS = 0;
+    }
+
+    // Owned columns: as even as possible, the first ranks take the remainder
+    dec->x_start = (int*)std::malloc((n + 1) * sizeof(int));
+    dec->x_start[0] = 1;
+    for (int q = 0; q < n; ++q) {
+        dec->x_start[q + 1] = dec->x_start[q] + interior / n + (q < interior % n ? 1 : 0);
+    }
+    dec->x_first = dec->x_start[rank];
+    const int owned = dec->x_start[rank + 1] - dec->x_first;
+
+    params->Num_X = owned + 2;
+    dec->global_x = (int*)std::malloc(params->Num_X * sizeof(int));
+    for (int c = 0; c < params->Num_X; ++c) dec->global_x[c] = dec->x_first - 1 + c;
+    params->global_x = dec->global_x;
+
+    const char *names[HALO_FIELDS] = { "phi", "temp" };
+    for (int f = 0; f < HALO_FIELDS; ++f) {
+        const FaceBoundary bc = variableBoundary(params, names[f]);
+        const bool lperiodic = (bc.left == BOUNDARY_PERIODIC);
+        const bool rperiodic = (bc.right == BOUNDARY_PERIODIC);
+        const bool first = (rank == 0), last = (rank == n - 1);
+
+        // Halo sources, and the ranks whose halo our outermost columns fill
+        dec->recv_from[f][0] = !first ? rank - 1 : lperiodic ? n - 1 : -1;
+        dec->recv_from[f][1] = !last  ? rank + 1 : rperiodic ? 0 : -1;
+        dec->send_to[f][0]   = !first ? rank - 1 : rperiodic ? n - 1 : -1;
+        dec->send_to[f][1]   = !last  ? rank + 1 : lperiodic ? 0 : -1;
+        dec->wraps[f][0] = first && lperiodic;
+        dec->wraps[f][1] = last && rperiodic;
+
+        // The x face kernel fills only the non-periodic faces of the global grid
+        FaceBoundary local = bc;
+        local.left  = (first && !lperiodic) ? bc.left  : BOUNDARY_UNDEFINED;
+        local.right = (last  && !rperiodic) ? bc.right : BOUNDARY_UNDEFINED;
+        dec->boundaries[f] = selectBoundaryKernel(params, local);
+    }
+    return 0;
+}
+
+/**
+ * @brief Allocate the staging columns and, on rank 0, the global field.
+ *
+ * Called once the local strides are known.
+ */
+void setupDecompositionBuffers(Decomposition *dec, int strides[]) {
+    if (dec->nranks == 1) return;
+    dec->stage = (Real*)std::malloc(2 * HALO_FIELDS * (size_t)strides[0] * sizeof(Real));
+    if (dec->rank == 0) {
+        createArena(&dec->gather, 1, fieldArrayBytes(&dec->global, strides));
+    }
+}
+
+/**
+ * @brief Post the halo receives and sends of every field.
+ *
+ * Called by one thread after the y/z ghosts of the outermost owned columns
+ * have been refilled.
+ */
+static void startHaloExchange(Decomposition *dec, Real *const fields[], const SimParams *params,
+                              int strides[]) {
+#ifdef USE_MPI
+    const int sx = strides[0];
+    const int owned = params->Num_X - 2;
+    MPI_Request *req = haloRequests;
+    for (int f = 0; f < HALO_FIELDS; ++f) {
+        Real *lo = dec->wraps[f][0] ? dec->stage + (size_t)(2 * f) * sx : fields[f];
+        Real *hi = dec->wraps[f][1] ? dec->stage + (size_t)(2 * f + 1) * sx
+                                    : fields[f] + (size_t)(owned + 1) * sx;
+        // Tag 2f: column travelling to the left neighbour, 2f+1: to the right
+        MPI_Irecv(lo, sx, realType(), peer(dec->recv_from[f][0]), 2 * f + 1, MPI_COMM_WORLD, req++);
+        MPI_Irecv(hi, sx, realType(), peer(dec->recv_from[f][1]), 2 * f, MPI_COMM_WORLD, req++);
+        MPI_Isend(fields[f] + sx, sx, realType(), peer(dec->send_to[f][0]), 2 * f,
+                  MPI_COMM_WORLD, req++);
+        MPI_Isend(fields[f] + (size_t)owned * sx, sx, realType(), peer(dec->send_to[f][1]), 2 * f + 1,
+                  MPI_COMM_WORLD, req++);
+    }
+#else
+    (void)dec; (void)fields; (void)params; (void)strides;
+#endif
+}
+
+#ifdef USE_MPI
+/**
+ * @brief Copy the interior cells of a staged column into a ghost column.
+ */
+static void copyInteriorCells(Real *dst, const Real *src, const SimParams *params, int strides[]) {
+    const int kstart = (params->DIM == 3) ? 1 : 0;
+    const int kend   = (params->DIM == 3) ? params->Num_Z - 1 : 1;
+    const size_t run = (size_t)(kend - kstart) * sizeof(Real);
+    for (int j = 1; j < params->Num_Y - 1; ++j) {
+        const int off = j * strides[1] + kstart;
+        std::memcpy(dst + off, src + off, run);
+    }
+}
+#endif
+
+/**
+ * @brief Wait for the halo exchange and unpack the columns wrapped around periodic faces.
+ */
+static void finishHaloExchange(Decomposition *dec, Real *const fields[], const SimParams *params,
+                               int strides[]) {
+#ifdef USE_MPI
+    MPI_Waitall(4 * HALO_FIELDS, haloRequests, MPI_STATUSES_IGNORE);
+    const size_t sx = strides[0];
+    const int owned = params->Num_X - 2;
+    for (int f = 0; f < HALO_FIELDS; ++f) {
+        if (dec->wraps[f][0]) {
+            copyInteriorCells(fields[f], dec->stage + 2 * f * sx, params, strides);
+        }
+        if (dec->wraps[f][1]) {
+            copyInteriorCells(fields[f] + (owned + 1) * sx, dec->stage + (2 * f + 1) * sx, params, strides);
+        }
+    }
+#else
+    (void)dec; (void)fields; (void)params; (void)strides;
+#endif
+}
+
+/**
+ * @brief Update phi, then temp, on the local columns [first, first + count).
+ *
+ * The kernels run on a window of the local grid: the arrays are shifted to
+ * column first - 1 and Num_X covers the window and one column either side.
+ */
+static void updateColumns(int first, int count, Real *phi, Real *temp, const FieldBuffers *fb,
+                          const SimParams *params, const KernelTable *kt,
+                          Accum r[], Accum r2[], int strides[], int step) {
+    if (count <= 0) return;
+    const size_t shift = (size_t)(first - 1) * strides[0];
+    SimParams lp = *params;
+    lp.Num_X = count + 2;
+    lp.global_x = params->global_x + first - 1;
+    FieldBuffers wfb = shiftFieldBuffers(*fb, shift);
+    Real *wphi = phi + shift;
+    Real *wtemp = temp + shift;
+
+    if (lp.FUSED_KERNEL) {
+        kt->updatePhiFused(wphi, wtemp, &wfb, &lp, r, strides, step);
+    } else {
+        kt->computedfdphi(wphi, wfb.dfdphi, wtemp, &lp, strides);
+        kt->computeGradientPhi(wphi, &wfb, &lp, r, strides);
+        kt->computeAnisotropy(&wfb, &lp, strides);
+        kt->updatePhi(wphi, &wfb, &lp, r, strides, step);
+    }
+    kt->updateTemp(wtemp, &wfb, &lp, strides, r2);
+}
+
+/**
+ * @brief Advance phi and temp on the rank-local grid by one step.
+ *
+ * Called by every thread of the team. The y/z ghosts and the global x
+ * faces are refilled first; the halo columns are then posted and the
+ * columns that do not touch them (2 .. owned-1) are updated while the
+ * messages are in flight. The outermost owned columns follow once the
+ * exchange has completed. fb->phi_new and fb->temp_new receive the result.
+ *
+ * @param phi     Phase-field array (local grid)
+ * @param temp    Temperature array (local grid)
+ * @param fb      Local buffers and next generation of the fields
+ * @param dec     Decomposition from decomposeDomain
+ * @param params  Rank-local parameters
+ * @param kt      Kernel table
+ * @param r       Inverse grid spacings
+ * @param r2      Squared inverse grid spacings
+ * @param strides Strides of the field arrays
+ * @param step    Timestep number, part of the noise counter
+ */
+void advanceDecomposed(Real *phi, Real *temp, FieldBuffers *fb, Decomposition *dec,
+                       const SimParams *params, const KernelTable *kt,
+                       Accum r[], Accum r2[], int strides[], int step) {
+    Real *fields[HALO_FIELDS];
+    fields[HALO_PHI] = phi;
+    fields[HALO_TEMP] = temp;
+    const int owned = params->Num_X - 2;
+
+    applyBoundaryConditions(fields, dec->boundaries, HALO_FIELDS, params, strides);
+    #pragma omp single
+    startHaloExchange(dec, fields, params, strides);
+
+    // Columns whose stencils stay inside the owned columns
+    updateColumns(2, owned - 2, phi, temp, fb, params, kt, r, r2, strides, step);
+
+    #pragma omp single
+    finishHaloExchange(dec, fields, params, strides);
+
+    // Outermost owned columns, which read the halos
+    updateColumns(1, 1, phi, temp, fb, params, kt, r, r2, strides, step);
+    if (owned > 1) {
+        updateColumns(owned, 1, phi, temp, fb, params, kt, r, r2, strides, step);
+    }
+}
+
+#ifdef USE_MPI
+/**
+ * @brief Element counts and offsets of the owned columns of every rank in the global field.
+ */
+static void slabCounts(const Decomposition *dec, int sx, int **counts, int **displs) {
+    *counts = (int*)std::malloc(dec->nranks * sizeof(int));
+    *displs = (int*)std::malloc(dec->nranks * sizeof(int));
+    for (int q = 0; q < dec->nranks; ++q) {
+        (*counts)[q] = (dec->x_start[q + 1] - dec->x_start[q]) * sx;
+        (*displs)[q] = dec->x_start[q] * sx;
+    }
+}
+#endif
+
+/**
+ * @brief Write a field of the global grid.
+ *
+ * Across ranks the owned columns are gathered on rank 0, which writes them;
+ * the other ranks only send. Called by one thread of every rank.
+ *
+ * @param dec      Decomposition
+ * @param write    write_output_vtk or write_output_csv
+ * @param filename Output file
+ * @param arr      Field on the local grid
+ * @param strides  Strides of the field arrays
+ */
+void writeGlobalField(Decomposition *dec, FieldIO write, const char *filename, Real *arr, int strides[]) {
+    if (dec->nranks == 1) {
+        write(filename, arr, &dec->global, strides);
+        return;
+    }
+#ifdef USE_MPI
+    const int sx = strides[0];
+    const int owned = dec->x_start[dec->rank + 1] - dec->x_first;
+    int *counts = nullptr, *displs = nullptr;
+    Real *global = nullptr;
+    if (dec->rank == 0) {
+        slabCounts(dec, sx, &counts, &displs);
+        global = (Real*)dec->gather.base;
+    }
+    MPI_Gatherv(arr + sx, owned * sx, realType(), global, counts, displs, realType(), 0, MPI_COMM_WORLD);
+    if (dec->rank == 0) {
+        write(filename, global, &dec->global, strides);
+        std::free(counts);
+        std::free(displs);
+    }
+#endif
+}
+
+/**
+ * @brief Read a field of the global grid (respawn).
+ *
+ * Across ranks rank 0 reads the file and scatters the owned columns.
+ * Called by one thread of every rank.
+ *
+ * @param dec      Decomposition
+ * @param read     read_input_vtk or read_input_csv
+ * @param filename Input file
+ * @param arr      Field on the local grid
+ * @param strides  Strides of the field arrays
+ */
+void readGlobalField(Decomposition *dec, FieldIO read, const char *filename, Real *arr, int strides[]) {
+    if (dec->nranks == 1) {
+        read(filename, arr, &dec->global, strides);
+        return;
+    }
+#ifdef USE_MPI
+    const int sx = strides[0];
+    const int owned = dec->x_start[dec->rank + 1] - dec->x_first;
+    int *counts = nullptr, *displs = nullptr;
+    Real *global = nullptr;
+    if (dec->rank == 0) {
+        slabCounts(dec, sx, &counts, &displs);
+        global = (Real*)dec->gather.base;
+        read(filename, global, &dec->global, strides);
+    }
+    MPI_Scatterv(global, counts, displs, realType(), arr + sx, owned * sx, realType(), 0, MPI_COMM_WORLD);
+    std::free(counts);
+    std::free(displs);
+#endif
+}
+
+/**
+ * @brief Maximum of a value over all ranks. Called by one thread of every rank.
+ */
+double maxOverRanks(const Decomposition *dec, double value) {
+#ifdef USE_MPI
+    if (dec->nranks > 1) {
+        MPI_Allreduce(MPI_IN_PLACE, &value, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    }
+#else
+    (void)dec;
+#endif
+    return value;
+}
+
+/**
+ * @brief Value of rank 0 on every rank, for decisions only rank 0 can make.
+ * Called by one thread of every rank.
+ */
+int shareFromRank0(const Decomposition *dec, int value) {
+#ifdef USE_MPI
+    if (dec->nranks > 1) {
+        MPI_Bcast(&value, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+#else
+    (void)dec;
+#endif
+    return value;
+}
+
+/**
+ * @brief Release the decomposition and stop MPI.
+ */
+void finalizeDecomposition(Decomposition *dec) {
+    std::free(dec->x_start);
+    std::free(dec->global_x);
+    std::free(dec->stage);
+    releaseArena(&dec->gather);
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif
+}
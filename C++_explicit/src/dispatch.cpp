@@ -0,0 +1,86 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include <cstring>
+
+/*
+ * dispatch.cpp
+ *
+ * Chooses the stencil kernel instantiations for a run. Called once after
+ * readParameters so that the time loop calls kernels whose dimension,
+ * anisotropy symmetry and boundary types are compile-time constants.
+ */
+
+// Pick the DIM/J instantiation of a kernel templated on both.
+#define SELECT_DIM_J(kernel, dim, J)                                        \
+    ((dim) == 3 ? ((J) == 4 ? kernel<3, 4> : (J) == 6 ? kernel<3, 6> : kernel<3, 0>) \
+                : ((J) == 4 ? kernel<2, 4> : (J) == 6 ? kernel<2, 6> : kernel<2, 0>))
+
+/**
+ * @brief Fill the kernel table for the given parameters.
+ *
+ * @param params  Simulation parameters (DIM, j, ANISOTROPY_ENGINE, MATH_MODE, TEMP_SOLVER, PHI_SOLVER, SPECTRAL, boundaries)
+ * @param kt      KernelTable to populate
+ */
+void selectKernels(const SimParams *params, KernelTable *kt) {
+    const int dim = params->DIM;
+    const int J   = anisotropySymmetry(params);
+
+    if (dim == 3) {
+        kt->computedfdphi      = computedfdphiKernel<3>;
+        kt->computeGradientPhi = computeGradientPhiKernel<3>;
+        kt->updatePhi          = updatePhiKernel<3>;
+        kt->updateTemp         = updateTempKernel<3>;
+    } else {
+        kt->computedfdphi      = computedfdphiKernel<2>;
+        kt->computeGradientPhi = computeGradientPhiKernel<2>;
+        kt->updatePhi          = updatePhiKernel<2>;
+        kt->updateTemp         = updateTempKernel<2>;
+    }
+    if (params->TEMP_SOLVER == TEMP_ADI) {
+        kt->updateTemp = (dim == 3) ? updateTempADIKernel<3> : updateTempADIKernel<2>;
+    } else if (params->TEMP_SOLVER == TEMP_MULTIGRID) {
+        kt->updateTemp = (dim == 3) ? updateTempMultigridKernel<3> : updateTempMultigridKernel<2>;
+    }
+    // The IMEX step replaces the explicit phi step after the phi kernel
+    kt->stabilizePhi = nullptr;
+    if (params->PHI_SOLVER == PHI_IMEX) {
+        kt->stabilizePhi = (dim == 3) ? updatePhiIMEXKernel<3> : updatePhiIMEXKernel<2>;
+    }
+    // The spectral step advances both fields after the explicit phi kernel
+    if (params->SPECTRAL) {
+        kt->updateTemp = (dim == 3) ? updateSpectralKernel<3> : updateSpectralKernel<2>;
+    }
+    kt->computeAnisotropy = SELECT_DIM_J(computeAnisotropyKernel, dim, J);
+    // DIM = 3 always runs the single-pass kernel with cubic anisotropy
+    if (dim == 3) {
+        kt->updatePhiFused = (params->MATH_MODE == MATH_VECTOR) ? updatePhiCubicKernel<true>
+                                                                 : updatePhiCubicKernel<false>;
+    } else {
+        kt->updatePhiFused = (J == 4) ? updatePhiFusedKernel<2, 4>
+                           : (J == 6) ? updatePhiFusedKernel<2, 6> : updatePhiFusedKernel<2, 0>;
+    }
+
+    // SIMD transcendental functions; the algebraic engine needs none for the anisotropy
+    if (params->MATH_MODE == MATH_VECTOR) {
+        kt->computedfdphi = (dim == 3) ? computedfdphiVectorKernel<3> : computedfdphiVectorKernel<2>;
+        if (J == 0) {
+            kt->computeAnisotropy = (dim == 3) ? computeAnisotropyVectorKernel<3> : computeAnisotropyVectorKernel<2>;
+        }
+    }
+
+    // Boundary kernels per variable; a variable without a boundary entry keeps its ghosts
+    FaceBoundary none;
+    none.top = none.bottom = none.left = none.right = none.front = none.back = BOUNDARY_UNDEFINED;
+    kt->phiBoundary  = selectBoundaryKernel(params, none);
+    kt->tempBoundary = selectBoundaryKernel(params, none);
+    for (int i = 0; i < params->numVariables; ++i) {
+        const VariableBoundary *vb = &params->variables[i];
+        if (std::strcmp(vb->varName, "phi") == 0) {
+            kt->phiBoundary = selectBoundaryKernel(params, vb->bc);
+        } else if (std::strcmp(vb->varName, "temp") == 0) {
+            kt->tempBoundary = selectBoundaryKernel(params, vb->bc);
+        }
+    }
+}
+
+#undef SELECT_DIM_J
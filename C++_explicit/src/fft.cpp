@@ -0,0 +1,157 @@
+#include "fft.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * fft.cpp
+ *
+ * Mixed-radix complex FFT used by the spectral mode (see fft.hpp).
+ *  - fftPlan: factor n (4s first, then 2, then odd primes) and tabulate twiddles
+ *  - fftLine: one transform, recursing over the factors (decimation in time)
+ *  - fftFree: release the twiddle table
+ */
+
+static inline FFTComplex cmul(FFTComplex a, FFTComplex b) {
+    FFTComplex c = { a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re };
+    return c;
+}
+
+// Twiddle k of the plan; the inverse transform uses the conjugates
+template <bool INV>
+static inline FFTComplex twiddle(const FFTPlan *p, size_t k) {
+    FFTComplex w = p->twiddle[k];
+    if (INV) w.im = -w.im;
+    return w;
+}
+
+/**
+ * @brief Combine `radix` transforms of length m, stored one after another in out.
+ */
+template <bool INV>
+static void butterfly(FFTComplex *out, size_t fstride, const FFTPlan *p, int m, int radix,
+                      FFTComplex *scratch) {
+    if (radix == 2) {
+        for (int u = 0; u < m; ++u) {
+            const FFTComplex t = cmul(out[u + m], twiddle<INV>(p, u * fstride));
+            out[u + m].re = out[u].re - t.re;
+            out[u + m].im = out[u].im - t.im;
+            out[u].re += t.re;
+            out[u].im += t.im;
+        }
+    } else if (radix == 4) {
+        for (int u = 0; u < m; ++u) {
+            const FFTComplex s0 = out[u];
+            const FFTComplex s1 = cmul(out[u + m],     twiddle<INV>(p, u * fstride));
+            const FFTComplex s2 = cmul(out[u + 2 * m], twiddle<INV>(p, 2 * u * fstride));
+            const FFTComplex s3 = cmul(out[u + 3 * m], twiddle<INV>(p, 3 * u * fstride));
+            const FFTComplex a = { s0.re + s2.re, s0.im + s2.im };
+            const FFTComplex b = { s0.re - s2.re, s0.im - s2.im };
+            const FFTComplex c = { s1.re + s3.re, s1.im + s3.im };
+            const FFTComplex d = { s1.re - s3.re, s1.im - s3.im };
+            out[u].re         = a.re + c.re;  out[u].im         = a.im + c.im;
+            out[u + 2 * m].re = a.re - c.re;  out[u + 2 * m].im = a.im - c.im;
+            // b -/+ i d: the quarter turn of the forward/inverse transform
+            if (INV) {
+                out[u + m].re     = b.re - d.im;  out[u + m].im     = b.im + d.re;
+                out[u + 3 * m].re = b.re + d.im;  out[u + 3 * m].im = b.im - d.re;
+            } else {
+                out[u + m].re     = b.re + d.im;  out[u + m].im     = b.im - d.re;
+                out[u + 3 * m].re = b.re - d.im;  out[u + 3 * m].im = b.im + d.re;
+            }
+        }
+    } else {
+        // Generic radix: a direct DFT of length radix per output group
+        const size_t rstride = fstride * m;   // twiddle step of exp(-2 pi i / radix)
+        for (int u = 0; u < m; ++u) {
+            scratch[0] = out[u];
+            for (int q = 1; q < radix; ++q) {
+                scratch[q] = cmul(out[u + q * m], twiddle<INV>(p, (size_t)u * q * fstride));
+            }
+            for (int q2 = 0; q2 < radix; ++q2) {
+                FFTComplex acc = scratch[0];
+                for (int q = 1; q < radix; ++q) {
+                    const FFTComplex t = cmul(scratch[q], twiddle<INV>(p, (size_t)((q * q2) % radix) * rstride));
+                    acc.re += t.re;
+                    acc.im += t.im;
+                }
+                out[u + q2 * m] = acc;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Transform of the sub-sequence in[0], in[fstride*istride], ... into out.
+ */
+template <bool INV>
+static void work(FFTComplex *out, const FFTComplex *in, size_t fstride, int istride,
+                 const int *factors, const FFTPlan *p, FFTComplex *scratch) {
+    const int radix = factors[0];
+    const int m = factors[1];
+    const size_t step = fstride * istride;
+    if (m == 1) {
+        for (int q = 0; q < radix; ++q) out[q] = in[q * step];
+    } else {
+        for (int q = 0; q < radix; ++q) {
+            work<INV>(out + q * m, in + q * step, fstride * radix, istride, factors + 2, p, scratch);
+        }
+    }
+    butterfly<INV>(out, fstride, p, m, radix, scratch);
+}
+
+/**
+ * @brief Factor n and tabulate its twiddles.
+ */
+void fftPlan(FFTPlan *plan, int n) {
+    std::memset(plan, 0, sizeof(*plan));
+    plan->n = n;
+    plan->maxRadix = 1;
+    int rest = n, f = 0, p = 4;
+    while (rest > 1 && f < FFT_MAX_FACTORS) {
+        while (rest % p) {
+            p = (p == 4) ? 2 : (p == 2) ? 3 : p + 2;
+            if ((size_t)p * p > (size_t)rest) p = rest;
+        }
+        rest /= p;
+        plan->factors[2 * f] = p;
+        plan->factors[2 * f + 1] = rest;
+        if (p > plan->maxRadix) plan->maxRadix = p;
+        f++;
+    }
+    plan->twiddle = (FFTComplex*)std::malloc((size_t)n * sizeof(FFTComplex));
+    for (int k = 0; k < n; ++k) {
+        const double a = -2.0 * M_PI * k / n;
+        plan->twiddle[k].re = Accum(std::cos(a));
+        plan->twiddle[k].im = Accum(std::sin(a));
+    }
+}
+
+/**
+ * @brief Release the twiddles of a plan.
+ */
+void fftFree(FFTPlan *plan) {
+    std::free(plan->twiddle);
+    std::memset(plan, 0, sizeof(*plan));
+}
+
+/**
+ * @brief Unnormalized transform of one line: out[k] = sum_m in[m * istride] exp(-/+ 2 pi i k m / n).
+ *
+ * @param plan    Plan of the line length
+ * @param in      First element of the line; not modified, must not overlap out
+ * @param istride Distance between consecutive elements of the line
+ * @param out     n contiguous results
+ * @param inverse 1: exp(+2 pi i k m / n)
+ * @param scratch plan->maxRadix elements
+ */
+void fftLine(const FFTPlan *plan, const FFTComplex *in, int istride, FFTComplex *out,
+             int inverse, FFTComplex *scratch) {
+    if (plan->n == 1) {
+        out[0] = in[0];
+    } else if (inverse) {
+        work<true>(out, in, 1, istride, plan->factors, plan, scratch);
+    } else {
+        work<false>(out, in, 1, istride, plan->factors, plan, scratch);
+    }
+}
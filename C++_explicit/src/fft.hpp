@@ -0,0 +1,39 @@
+#ifndef FFT_HPP
+#define FFT_HPP
+
+/*
+ * fft.hpp
+ *
+ * Self-contained complex FFT of any length for the spectral mode
+ * (spectral.cpp): recursive mixed-radix Cooley-Tukey, out of place, with
+ * radix-4 and radix-2 butterflies and a generic butterfly for the other
+ * prime factors (O(n p) for a prime factor p, so lengths with small
+ * factors are fast). The input may be strided, so lines of a
+ * multidimensional array are transformed without gathering them first.
+ * Transforms are unnormalized: inverse(forward(x)) = n x.
+ *
+ *  - fftPlan / fftFree: factors and twiddles of a length
+ *  - fftLine: forward or inverse transform of one line
+ */
+
+#include "header.hpp"
+
+#define FFT_MAX_FACTORS 32
+
+struct FFTComplex {
+    Accum re, im;
+};
+
+struct FFTPlan {
+    int n;
+    int factors[2 * FFT_MAX_FACTORS];   // (radix, length / radix) per stage, outermost first
+    int maxRadix;                       // scratch elements needed by the generic butterfly
+    FFTComplex *twiddle;                // exp(-2 pi i k / n), k < n
+};
+
+void fftPlan(FFTPlan *plan, int n);
+void fftFree(FFTPlan *plan);
+void fftLine(const FFTPlan *plan, const FFTComplex *in, int istride, FFTComplex *out,
+             int inverse, FFTComplex *scratch);
+
+#endif // FFT_HPP
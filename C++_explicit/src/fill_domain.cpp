@@ -8,14 +8,15 @@
  *
  * For each interior grid point, assigns vb->fillValue if the point lies
  * within the cube defined by vb->fill.c; otherwise sets it to
- * (1 - vb->fillValue).
+ * (1 - vb->fillValue). Positions are global: on a rank-local grid the
+ * columns are mapped through params->global_x.
  *
  * @param arr     Pointer to the data array to fill.
  * @param vb      Boundary and fill information for this variable.
  * @param params  Simulation parameters containing grid dimensions.
  * @param strides Array of strides for flattening 3D indices.
  */
-void FillCube(double *arr, const VariableBoundary *vb, const SimParams *params, int strides[]) {
+void FillCube(Real *arr, const VariableBoundary *vb, const SimParams *params, int strides[]) {
     int NX = params->Num_X;
     int NY = params->Num_Y;
     int NZ = params->Num_Z;
@@ -24,11 +25,13 @@ void FillCube(double *arr, const VariableBoundary *vb, const SimParams *params,
     int kend   = (dim == 3) ? NZ - 1 : 1;
 
     // Loop over interior grid (excluding ghost cells)
+    #pragma omp for
     for (int i = 1; i < NX - 1; ++i) {
         for (int j = 1; j < NY - 1; ++j) {
             for (int k = kstart; k < kend; ++k) {
                 int idx = IDX(i, j, k);
-                bool inside = (i >= vb->fill.c.x_start && i <= vb->fill.c.x_end) &&
+                int gi = params->global_x ? params->global_x[i] : i;
+                bool inside = (gi >= vb->fill.c.x_start && gi <= vb->fill.c.x_end) &&
                               (j >= vb->fill.c.y_start && j <= vb->fill.c.y_end) &&
                               (dim == 2 || (k >= vb->fill.c.z_start && k <= vb->fill.c.z_end));
                 arr[idx] = inside ? vb->fillValue : (1.0 - vb->fillValue);
@@ -48,7 +51,7 @@ void FillCube(double *arr, const VariableBoundary *vb, const SimParams *params,
  * @param params  Simulation parameters containing grid dimensions.
  * @param strides Array of strides for flattening 3D indices.
  */
-void FillSphere(double *arr, const VariableBoundary *vb, const SimParams *params, int strides[]) {
+void FillSphere(Real *arr, const VariableBoundary *vb, const SimParams *params, int strides[]) {
     int NX = params->Num_X;
     int NY = params->Num_Y;
     int NZ = params->Num_Z;
@@ -57,11 +60,13 @@ void FillSphere(double *arr, const VariableBoundary *vb, const SimParams *params
     int kend   = (dim == 3) ? NZ - 1 : 1;
 
     // Loop over interior grid
+    #pragma omp for
     for (int i = 1; i < NX - 1; ++i) {
         for (int j = 1; j < NY - 1; ++j) {
             for (int k = kstart; k < kend; ++k) {
                 int idx = IDX(i, j, k);
-                double dx2 = (i - vb->fill.s.x_center) * (i - vb->fill.s.x_center);
+                int gi = params->global_x ? params->global_x[i] : i;
+                double dx2 = (gi - vb->fill.s.x_center) * (gi - vb->fill.s.x_center);
                 double dy2 = (j - vb->fill.s.y_center) * (j - vb->fill.s.y_center);
                 double dz2 = (dim == 2) ? 0.0 : (k - vb->fill.s.z_center) * (k - vb->fill.s.z_center);
                 double dist2 = dx2 + dy2 + dz2;
@@ -82,7 +87,7 @@ void FillSphere(double *arr, const VariableBoundary *vb, const SimParams *params
  * @param params  Simulation parameters containing grid dimensions.
  * @param strides Array of strides for flattening 3D indices.
  */
-void FillConstant(double *arr, const VariableBoundary *vb, const SimParams *params, int strides[]) {
+void FillConstant(Real *arr, const VariableBoundary *vb, const SimParams *params, int strides[]) {
     int NX = params->Num_X;
     int NY = params->Num_Y;
     int NZ = params->Num_Z;
@@ -91,6 +96,7 @@ void FillConstant(double *arr, const VariableBoundary *vb, const SimParams *para
     int kend   = (dim == 3) ? NZ - 1 : 1;
 
     // Loop over interior grid
+    #pragma omp for
     for (int i = 1; i < NX - 1; ++i) {
         for (int j = 1; j < NY - 1; ++j) {
             for (int k = kstart; k < kend; ++k) {
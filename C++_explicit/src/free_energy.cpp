@@ -1,46 +1,93 @@
 #include "header.hpp"
+#include "kernels.hpp"
+#include "vecmath.hpp"
 #include <cmath>
 
-// Macro to compute flattened array index for 3D data
-#define IDX(i, j, k) ((i) * strides[0] + (j) * strides[1] + (k) * strides[2])
-
 /**
  * @brief Compute the derivative of free energy with respect to the phase-field φ.
  *
- * For each interior grid point (excluding ghost cells), computes:
+ * For each interior grid point (excluding ghost cells; with NARROW_BAND
+ * the band cells only, with TILE_SKIP the active tiles only), computes:
  *   m = (alpha / PI) * atan(gamma * (T_e - temp))
  *   dfdphi = phi * (1 - phi) * (phi - 0.5 + m)
  *
+ * @tparam DIM    Spatial dimension (2 or 3)
+ * @param phi     Input phase-field array of size NX*NY*NZ
+ * @param dfdphi  Output array to store computed dF/dphi values
+ * @param temp    Temperature field array
+ * @param params  Simulation parameters containing grid dimensions and constants
+ * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1]
+ */
+template <int DIM>
+void computedfdphiKernel(Real *phi, Real *dfdphi, Real *temp, const SimParams *params, int strides[]) {
+    const Interior<DIM> g(params, strides);
+
+    const Accum coef  = params->alpha / M_PI;
+    const Accum gamma = params->gamma;
+    const Accum T_e   = params->T_e;
+
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            int lo, hi;
+            for (int pos = 0; g.nextSegment(i, run, &pos, &lo, &hi); ) {
+                for (int n = lo; n < hi; ++n) {
+                    int idx = start + n;
+                    // Coupling term: m = (alpha/PI) * atan(gamma * (T_e - temp))
+                    const Accum T = temp[idx];
+                    const Accum p = phi[idx];
+                    Accum m = coef * std::atan(gamma * (T_e - T));
+                    // Derivative of free energy
+                    dfdphi[idx] = p * (Accum(1.0) - p) * (p - Accum(0.5) + m);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief computedfdphi with the SIMD atan from vecmath.hpp (MATH_MODE = VECTOR).
+ *
+ * Walks each unit-stride row of the interior (j in 2D, k in 3D) VM_LANES
+ * cells at a time; the last partial register of a row is zero-padded.
+ *
+ * @tparam DIM    Spatial dimension (2 or 3)
  * @param phi     Input phase-field array of size NX*NY*NZ
  * @param dfdphi  Output array to store computed dF/dphi values
  * @param temp    Temperature field array
  * @param params  Simulation parameters containing grid dimensions and constants
  * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1]
  */
-void computedfdphi(double *phi, double *dfdphi, double *temp, const SimParams *params, int strides[]) {
-    int NX = params->Num_X;
-    int NY = params->Num_Y;
-    int NZ = params->Num_Z;
-    int dim = params->DIM;
-    int kstart = (dim == 3) ? 1 : 0;
-    int kend   = (dim == 3) ? NZ - 1 : 1;
-
-    const double alpha = params->alpha;
+template <int DIM>
+void computedfdphiVectorKernel(Real *phi, Real *dfdphi, Real *temp, const SimParams *params, int strides[]) {
+    const Interior<DIM> g(params, strides);
+
+    const double coef  = params->alpha / M_PI;
     const double gamma = params->gamma;
     const double T_e   = params->T_e;
 
-    for (int i = 1; i < NX - 1; ++i) {
-        for (int j = 1; j < NY - 1; ++j) {
-            for (int k = kstart; k < kend; ++k) {
-                int idx = IDX(i, j, k);
-                // Coupling term: m = (alpha/PI) * atan(gamma * (T_e - temp))
-                double m = (alpha / M_PI) * std::atan(gamma * (T_e - temp[idx]));
-                // Derivative of free energy
-                dfdphi[idx] = phi[idx] * (1.0 - phi[idx]) * (phi[idx] - 0.5 + m);
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            int lo, hi;
+            for (int pos = 0; g.nextSegment(i, run, &pos, &lo, &hi); ) {
+                for (int n = lo; n < hi; n += VM_LANES) {
+                    const int lanes = (hi - n < VM_LANES) ? hi - n : VM_LANES;
+                    const int idx = start + n;
+                    vm_double T = vm_load(temp + idx, lanes);
+                    vm_double p = vm_load(phi + idx, lanes);
+                    vm_double m = coef * vm_atan(gamma * (T_e - T));
+                    vm_store(dfdphi + idx, p * (1.0 - p) * (p - 0.5 + m), lanes);
+                }
             }
         }
     }
 }
 
-#undef IDX
+template void computedfdphiKernel<2>(Real*, Real*, Real*, const SimParams*, int[]);
+template void computedfdphiKernel<3>(Real*, Real*, Real*, const SimParams*, int[]);
+template void computedfdphiVectorKernel<2>(Real*, Real*, Real*, const SimParams*, int[]);
+template void computedfdphiVectorKernel<3>(Real*, Real*, Real*, const SimParams*, int[]);
 
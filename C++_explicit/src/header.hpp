@@ -13,6 +13,12 @@
  *  - Allocation/deallocation routines for buffers
  *  - I/O functions for parameters, VTK/CSV input and output
  *  - Simulation routines: filling shapes, updating fields, computing derivatives
+ *  - Kernel table: specialized stencil kernels selected once per run (KernelTable)
+ *  - Narrow band of the phase-field kernels (NarrowBand)
+ *  - Tile activity map skipping quiescent tiles (TileMap)
+ *  - Block-structured refinement of the interface region (AmrLevel)
+ *  - Moving window following a front along x (MovingWindow)
+ *  - Per-tile multirate local time stepping (LocalTimeStep)
  *
  */
 
@@ -21,6 +27,7 @@
 #include <cctype>
 #include <cmath>
 #include <cstring>
+#include <stdint.h>
 #include <sys/stat.h>
 #include <cerrno>
 #include <unistd.h>
@@ -33,7 +40,25 @@ static constexpr int MAX_VARIABLES   = 10;   // Maximum number of variables supp
 static constexpr int MAX_DIM         = 3;    // Maximum spatial dimensions     
 
 //-----------------------------------------------------------------------------
-// Enum to represent boundary & filling type.
+// Floating-point types, chosen at build time (make PRECISION=...):
+//  - Real:  storage of the fields and of the FieldBuffers arrays
+//  - Accum: arithmetic in the stencil kernels; values are widened on load
+// double (default) uses double for both, mixed stores float and computes
+// in double, single uses float for both. SimParams stays double.
+//-----------------------------------------------------------------------------
+#if defined(PRECISION_SINGLE)
+typedef float  Real;
+typedef float  Accum;
+#elif defined(PRECISION_MIXED)
+typedef float  Real;
+typedef double Accum;
+#else
+typedef double Real;
+typedef double Accum;
+#endif
+
+//-----------------------------------------------------------------------------
+// Enum to represent boundary, filling & anisotropy evaluation type.
 //----------------------------------------------------------------------------- 
 enum BoundaryType {
     BOUNDARY_UNDEFINED,
@@ -42,6 +67,28 @@ enum BoundaryType {
     // Additional boundary conditions can be added here.
 };
 
+enum AnisotropyEngine {
+    ANISOTROPY_TRIG,        // atan2/cos/sin per face
+    ANISOTROPY_ALGEBRAIC    // multiple-angle identities, j = 4 or 6 only
+};
+
+enum MathMode {
+    MATH_LIBM,              // scalar std::atan/atan2/sin/cos
+    MATH_VECTOR             // SIMD polynomials from vecmath.hpp
+};
+
+enum TempSolver {
+    TEMP_EXPLICIT,          // forward Euler, updateTempKernel
+    TEMP_ADI,               // implicit Douglas-Gunn ADI, temperature_adi.cpp
+    TEMP_MULTIGRID          // implicit theta method, multigrid V-cycles, multigrid.cpp
+};
+
+// Phase-field time integrator (PHI_SOLVER)
+enum PhiSolver {
+    PHI_EXPLICIT,           // forward Euler
+    PHI_IMEX                // stabilized semi-implicit step, multigrid.cpp
+};
+
 enum FillType { 
     FILL_NONE, 
     FILL_CUBE, 
@@ -91,10 +138,15 @@ struct VariableBoundary {
 
 struct VariableData {
     char   varName[MAX_VAR_NAME];
-    double *dataArray;  // Pointer to the variable's data
+    Real   *dataArray;  // Current generation of the variable's data
+    Real   *nextArray;  // Generation written by the next step; swapped with dataArray
     size_t  dataSize;   // Number of elements in the array
 };
 
+struct NarrowBand;
+struct TileMap;
+struct MovingWindow;
+
 //-----------------------------------------------------------------------------
 // Struct to hold simulation parameters.
 //----------------------------------------------------------------------------- 
@@ -107,9 +159,16 @@ struct SimParams {
     double dt;
     int    total_timesteps;
     int    timebreak;
+    // Adaptive time stepping (timestep.cpp); times are physical
+    int    ADAPTIVE_DT;     // 1: dt from the stability limit and max |dphi/dt|
+    double DT_SAFETY;       // fraction of the explicit stability limit (default 0.9)
+    double DT_PHI_TOL;      // largest change of phi per step; 0 = stability limit only
+    double end_time;        // end of the run (default total_steps * dt)
+    double output_time;     // output interval (default timebreak * dt)
     double epsilon, tau, delta;
     int    j;
     double theta_0, alpha, gamma, a, K, T_e;
+    uint64_t noise_seed;    // Philox key of the thermal noise stream
     int    numVariables;
     VariableBoundary variables[MAX_VARIABLES];
 
@@ -120,19 +179,265 @@ struct SimParams {
     // File writing options
     int WRITE_TO_CSV;
     int WRITE_TO_VTK;
+
+    // Kernel options
+    int FUSED_KERNEL;   // 1: single-pass phi update without intermediate buffers
+    AnisotropyEngine ANISOTROPY_ENGINE;
+    MathMode MATH_MODE;
+    TempSolver TEMP_SOLVER;
+    double MG_THETA;        // TEMP_SOLVER = MULTIGRID: 1 backward Euler (default), 0.5 Crank-Nicolson
+    double MG_TOL;          // relative residual of the multigrid solve (default 1e-8)
+    int    MG_MAX_CYCLES;   // V-cycles per step at most (default 30)
+    PhiSolver PHI_SOLVER;
+    double IMEX_STAB;       // PHI_SOLVER = IMEX: stabilization over the stiffness bounds (default 1)
+    int SPECTRAL;       // 1: semi-implicit Fourier-spectral stepping (all faces PERIODIC)
+    int NARROW_BAND;    // 1: phi kernels only on the cells near the interface (narrow_band.cpp)
+    double NB_TOL;      // interface: NB_TOL < phi < 1 - NB_TOL or a jump above NB_TOL (default 1e-6)
+    int    NB_MARGIN;   // cells added around the interface on every side (default 2)
+    int TILE_SKIP;      // 1: skip the kernels on quiescent tiles (tile_activity.cpp)
+    int    TILE_SIZE;   // cells per tile edge (default 16)
+    double TILE_TOL;    // largest change per step of a quiescent tile (default 0: no change at all)
+    double TILE_DRIFT;  // TILE_TOL > 0: largest change a tile may miss over the run, per field (default 1e-6)
+    int AMR;            // 1: refine the blocks near the interface to half the spacing (amr.cpp)
+    int    AMR_BLOCK;   // coarse cells per block edge (default 8)
+    double AMR_PHI_TOL; // refine where phi (1 - phi) exceeds this (default 1e-3)
+    double AMR_GRAD_TOL;// or where phi jumps by more than this between coarse cells (default 1e-2)
+    int LTS;            // 1: local time stepping, tiles step by power-of-two multiples of dt (local_timestep.cpp)
+    int    LTS_LEVELS;  // step sizes dt, 2 dt, ..., 2^(LTS_LEVELS-1) dt (default 4)
+    double LTS_TOL;     // largest change of a tile over one of its steps (default 1e-4)
+    int MOVING_WINDOW;  // 1: shift the grid along x with a front growing toward +x (moving_window.cpp)
+    double WINDOW_TRIGGER;  // share of the interior x extent the front may reach before a shift (default 0.5)
+    int BLOCK_STEPS;    // >1: temporal blocking, steps advanced per cache tile
+    int BLOCK_WIDTH;    // interior cells per tile edge; 0 sizes tiles from the L2 cache
+
+    // Parallel options
+    int NUM_THREADS;    // OpenMP team size; 0 defers to OMP_NUM_THREADS
+    int NUMA_REPORT;    // 1: print the NUMA node distribution of the field pages
+
+    // Set on the tile-local grids of the temporal blocking, the rank-local
+    // grid of the domain decomposition and the moving window only
+    const int *global_x;    // global x index of each local column (noise cell ids, fills); null = identity
+    // Set on the tile-local grids of the temporal blocking only
+    int global_y0, global_z0;   // global y and z index of local row and plane 0
+    int global_NY, global_NZ;   // Num_Y and Num_Z of the global grid; 0 = same as the local grid
+    // Set by setupNarrowBand when NARROW_BAND = 1
+    const NarrowBand *band; // cells the phi kernels update; null = whole interior
+    // Set by setupTileActivity when TILE_SKIP = 1 or LTS = 1
+    const TileMap *tiles;   // tiles the kernels update; null = all
+    // Set by setupMovingWindow when MOVING_WINDOW = 1
+    const MovingWindow *window; // offset of the grid along x, for the output; null = none
 };
 
 //-----------------------------------------------------------------------------
-// Field buffers for intermediate computations
+// Arena holding field arrays of one grid size in a single mapping: 64-byte
+// aligned, huge pages advised, arrays staggered to avoid cache-set aliasing
+// (memory_allocation.cpp). Released as a whole.
+//-----------------------------------------------------------------------------
+static constexpr size_t ARENA_ALIGN = 64;           // cache line, widest SIMD load
+static constexpr size_t ARENA_HUGE_PAGE = 2u << 20;  // transparent huge page size
+
+struct FieldArena {
+    char   *base;       // start of the mapping
+    size_t  capacity;   // bytes mapped
+    size_t  used;       // bytes handed out
+    size_t  arrayBytes; // bytes per array, padding included
+    int     hugePages;  // 1 when MADV_HUGEPAGE was accepted
+};
+
+//-----------------------------------------------------------------------------
+// Field buffers for intermediate computations. With FUSED_KERNEL only
+// dphi_dt is allocated; all other intermediate pointers are null. phi_new
+// and temp_new are not owned: they alias the next generation of the fields.
+// temp_star (intermediate ADI stages, stabilized spectral rate) is allocated
+// with TEMP_SOLVER = ADI or SPECTRAL = 1 only.
 //----------------------------------------------------------------------------- 
 struct FieldBuffers {
-    double *phi_new, *temp_new;
-    double *dphi_dt, *dfdphi;
-    double *ac, *ac_right, *ac_left, *ac_top, *ac_bottom;
-    double *ac_p, *ac_p_right, *ac_p_left, *ac_p_top, *ac_p_bottom;
-    double *DERX_c, *DERY_c;
-    double *DERX_right, *DERX_left, *DERY_top, *DERY_bottom;
-    double *DERY_right, *DERY_left, *DERX_top, *DERX_bottom;
+    Real *phi_new, *temp_new;
+    Real *dphi_dt, *dfdphi;
+    Real *temp_star;
+    Real *ac, *ac_right, *ac_left, *ac_top, *ac_bottom;
+    Real *ac_p, *ac_p_right, *ac_p_left, *ac_p_top, *ac_p_bottom;
+    Real *DERX_c, *DERY_c;
+    Real *DERX_right, *DERX_left, *DERY_top, *DERY_bottom;
+    Real *DERY_right, *DERY_left, *DERX_top, *DERX_bottom;
+};
+
+//-----------------------------------------------------------------------------
+// Temporal blocking (BLOCK_STEPS > 1): overlapped x/y(/z) tiles advanced
+// several steps at a time in per-thread local grids (temporal_blocking.cpp)
+//-----------------------------------------------------------------------------
+struct TileWorkspace {
+    SimParams params;       // copy of the run parameters, grid set per tile
+    FieldArena arena;       // storage of all local arrays below
+    Real *phi, *temp;       // local fields, laid out with TemporalBlocking::strides
+    FieldBuffers fb;        // local intermediate buffers and second field generation
+};
+
+struct TemporalBlocking {
+    int steps;              // BLOCK_STEPS; 0 when temporal blocking is off
+    int width;              // interior columns owned per x-slab
+    int height, depth;      // interior rows and planes owned per tile (whole extent if untiled)
+    int xtiles, ytiles, ztiles; // tiles along x, y and z (ztiles = 1 in 2D)
+    int ntiles;             // xtiles * ytiles * ztiles
+    int max_cols;           // largest local grid, halo and ghost columns included
+    int max_rows, max_planes;
+    int strides[3];         // strides of the local grids
+    int *tile_start;        // xtiles+1 offsets into col_global / col_role
+    int *owned_first;       // local index of the first owned column of each x-slab
+    int *owned_count;
+    int *col_global;        // global x index of each local column
+    char *col_role;         // interior, boundary ghost or periodic ghost column
+    int nworkspaces;        // one per thread
+    TileWorkspace *ws;
+};
+
+//-----------------------------------------------------------------------------
+// Clock of the adaptive time stepping (ADAPTIVE_DT = 1, timestep.cpp)
+//-----------------------------------------------------------------------------
+struct TimeControl {
+    int    adaptive;        // 0: fixed dt, steps and timebreak as given
+    double time;            // physical time reached
+    double end_time;
+    double output_time;     // output interval
+    int    outputs;         // output times passed
+    double dt_limit;        // DT_SAFETY times the explicit stability limit
+    double dt_free;         // last dt before shortening to an output time
+    double step_end;        // physical time at the end of the planned step
+    int    lands_on_output; // the planned step ends on an output time
+    int    output_due;      // the step just taken ended on an output time
+    int    steps;           // steps taken
+};
+
+//-----------------------------------------------------------------------------
+// Narrow band (NARROW_BAND = 1, narrow_band.cpp): the phi kernels update
+// one interval of every unit-stride run of cells (Interior::runRange), the
+// cells within NB_MARGIN of the interface. Outside it phi is frozen at
+// 0 or 1 within NB_TOL, both generations agree and dphi_dt is zero.
+//-----------------------------------------------------------------------------
+struct NarrowBand {
+    int  runs;              // runs per x-plane: 1 in 2D, Num_Y - 2 in 3D
+    int  len;               // cells per run
+    int  *lo, *hi;          // band of run i * runs + r: cells [lo, hi) along the run
+    int  *next_lo, *next_hi;// band of the next step, built by trackNarrowBand
+    int  *core_lo, *core_hi;// interface cells of each run found by the last scan
+    int  wrapX, wrapY;      // phi is periodic across x / y: the margin wraps around
+    int  wrapRun;           // phi is periodic along the runs: a margin past an end takes the whole run
+    long cells;             // cells in the current band
+    double interval_cells;  // band cells summed over the steps of the output interval
+    int    interval_steps;
+    double interval_start;  // wall-clock seconds at the start of the interval
+    double total_cells;     // band cells summed over the run
+    long   total_steps;
+};
+
+//-----------------------------------------------------------------------------
+// Tile activity map (TILE_SKIP = 1, tile_activity.cpp): the interior split
+// into tiles of TILE_SIZE cells per edge, numbered (tx * nty + ty) * ntz + tz.
+// The kernels of a field skip the tiles whose flag is 0 (Interior::
+// nextSegment); both generations of a skipped tile agree, and a skipped phi
+// tile has a zero dphi_dt. The phi and temp kernels record per x-plane the
+// largest |dphi_dt| and |grad T| of every tile they cross, from which
+// trackTileActivity sets the flags of the next step.
+//-----------------------------------------------------------------------------
+struct TileMap {
+    int  size;              // TILE_SIZE
+    int  ntx, nty, ntz;     // tiles along x, y, z; ntz = 1 in 2D
+    int  count;             // ntx * nty * ntz
+    int  perPlane;          // tiles crossed by one x-plane: nty * ntz
+    int  skip_temp;         // 1: temp tiles are skipped too (explicit temperature update)
+    int  wrap[3];           // a field is periodic along x / y / z: neighbours wrap around
+    unsigned char *phi_on, *temp_on;        // tile updated this step, per field
+    unsigned char *next_phi, *next_temp;    // flags of the next step
+    unsigned char *live;    // 1: phi, 2: temp changed by more than TILE_TOL
+    double *change;         // per tile and field (phi, temp): change per step at the last update
+    double *drift;          // per tile and field: change missed while asleep, summed over the run
+    double *phi_rate;       // largest |dphi_dt| per x-plane and tile: Num_X * perPlane
+    double *temp_grad;      // largest |grad T| per x-plane and tile
+    long phi_tiles, temp_tiles;       // tiles updated in the step just taken
+    double interval_phi, interval_temp;   // tiles updated, summed over the output interval
+    int    interval_steps;
+    double interval_start;  // wall-clock seconds at the start of the interval
+    double total_phi, total_temp;     // tiles updated, summed over the run
+    long   total_steps;
+};
+
+//-----------------------------------------------------------------------------
+// Block-structured refinement (AMR = 1, amr.cpp): the grid of the input is
+// the coarse level, cut into blocks of AMR_BLOCK cells per edge numbered
+// (bx * nby + by) * nbz + bz. Blocks near the interface carry a fine patch
+// at half the spacing with one ghost layer, advanced by the regular kernels
+// in `substeps` steps per coarse step; the coarse cells under a patch hold
+// the average of its cells.
+//-----------------------------------------------------------------------------
+struct AmrLevel {
+    int  block;             // AMR_BLOCK
+    int  nbx, nby, nbz;     // blocks along x, y, z; nbz = 1 in 2D
+    int  count;             // nbx * nby * nbz
+    int  substeps;          // fine steps per coarse step, from the fine stability limit
+    SimParams fine;         // parameters of a whole patch: Num_* = 2 * block + 2, half spacing, dt / substeps
+    int  strides[MAX_DIM];  // strides of the patch arrays
+    FieldArena pool;        // phi and temp of every block's patch, two generations each
+    int  gen;               // generation of the patches holding the current fields
+    FaceBoundary phiBC, tempBC;
+    unsigned char *refined; // block carries a patch
+    unsigned char *flag;    // block marked by the refinement criteria
+    int  *list, nlist;      // refined blocks
+    int  *fresh, nfresh;    // blocks refined by the last regrid, filled from the coarse level
+    int  faceCells;         // coarse cells per block face: block^(DIM-1)
+    double *flux;           // heat leaving each patch per face cell over the coarse step, 2 * DIM faces per block
+    int  nworkspaces;       // one per thread
+    TileWorkspace *ws;      // kernel buffers of one patch; phi and temp unused
+    long fine_cells;        // fine cells in the current patches
+    double interval_blocks; // refined blocks, summed over the steps of the output interval
+    double interval_updates;// cell updates of both levels over the interval
+    int    interval_steps;
+    double interval_start;  // wall-clock seconds at the start of the interval
+    double total_blocks, total_updates;
+    long   total_steps;
+};
+
+//-----------------------------------------------------------------------------
+// Local time stepping (LTS = 1, local_timestep.cpp): every tile of the tile
+// map has a level L and takes steps of 2^L dt at the steps divisible by
+// 2^L; the levels are chosen anew at the start of each cycle, when all
+// tiles are at the same time. The heat a coarse tile exchanges with a finer
+// neighbour is the sum over the fine steps, kept in a register per face cell.
+//-----------------------------------------------------------------------------
+#define LTS_MAX_LEVELS 8
+
+struct LocalTimeStep {
+    int  levels;            // LTS_LEVELS after the stability and output caps
+    int  cycle;             // 2^(levels-1) steps
+    unsigned char *level;   // level of each tile
+    unsigned char *raw;     // level from the tile's own activity, before grading
+    long *cells;            // interior cells of each tile
+    int  faceCells;         // register entries per tile face: TILE_SIZE^(DIM-1)
+    double *reg;            // correction of each tile's face cells, per face (2 * DIM), from the fine steps
+    int  wrap[3];           // temp periodic along x, y, z
+    long levelTiles[LTS_MAX_LEVELS];    // tiles at each level in the current cycle
+    double levelCells[LTS_MAX_LEVELS];  // their interior cells
+    double interval_updates;// cell updates over the steps of the output interval
+    int    interval_steps;
+    double interval_start;  // wall-clock seconds at the start of the interval
+    double interval_tiles[LTS_MAX_LEVELS];  // tiles per level, summed over the interval
+    double total_updates;
+    long   total_steps;
+};
+
+//-----------------------------------------------------------------------------
+// Moving window (MOVING_WINDOW = 1, moving_window.cpp): the grid covers
+// global x columns offset + 1 .. offset + Num_X - 2 of a front growing
+// toward +x, and is shifted by whole x-planes when the front reaches the
+// trigger column.
+//-----------------------------------------------------------------------------
+struct MovingWindow {
+    int  trigger;           // interior column whose first solid cell (phi > 1/2) starts a shift
+    Real farPhi, farTemp;   // values of the planes exposed at +x
+    long offset;            // planes shifted so far
+    int  *columns;          // global column of each local column: i + offset
+    int  shift;             // planes shifted after the step just taken
+    long shifts;            // shifts over the run
+    double seconds;         // wall-clock seconds spent shifting
 };
 
 //-----------------------------------------------------------------------------
@@ -144,47 +449,231 @@ extern int          numGlobalVars;
 //-----------------------------------------------------------------------------
 // Allocation / deallocation routines
 //----------------------------------------------------------------------------- 
-void allocateFieldBuffers(const SimParams *params, FieldBuffers *fb);
-void freeFieldBuffers(FieldBuffers *fb);
+void   fieldStrides(const SimParams *params, int strides[]);
+size_t fieldArrayBytes(const SimParams *params, const int strides[]);
+int    fieldBufferCount(const SimParams *params);
+void   createArena(FieldArena *arena, int arrays, size_t arrayBytes);
+Real  *arenaAlloc(FieldArena *arena);
+void   releaseArena(FieldArena *arena);
+void   allocateFieldBuffers(const SimParams *params, FieldBuffers *fb, FieldArena *arena);
+void   printMemoryReport(const SimParams *params, const int strides[], const FieldArena *arena,
+                         const TemporalBlocking *tb);
+void   firstTouchArena(const FieldArena *arena, const SimParams *params, const int strides[]);
+void   printNumaReport(const FieldArena *arena);
 
 //-----------------------------------------------------------------------------
 // Function prototypes for file I/O.
 //----------------------------------------------------------------------------- 
 int    readParameters(const char *filename,  SimParams *params);
 void   writeParameters(const char *outfile, const SimParams *params);
-void   read_input_vtk(const char *filename, double *arr, const SimParams *params, int strides[]);
-void   read_input_csv(const char *filename, double *arr, const SimParams *params, int strides[]);
-void   write_output_vtk(const char *filename, double *arr, const SimParams *params, int strides[]);
-void   write_output_csv(const char *filename, double *arr, const SimParams *params, int strides[]);
+void   read_input_vtk(const char *filename, Real *arr, const SimParams *params, int strides[]);
+void   read_input_csv(const char *filename, Real *arr, const SimParams *params, int strides[]);
+void   write_output_vtk(const char *filename, Real *arr, const SimParams *params, int strides[]);
+void   write_output_csv(const char *filename, Real *arr, const SimParams *params, int strides[]);
 void   trim(char *str);
 
 //-----------------------------------------------------------------------------
 // Variable management routines
 //----------------------------------------------------------------------------- 
-void   setupVariables(const SimParams *params);
-double *alloc3(int NX, int NY, int NZ);
-void   freeGlobalVariableArrays(void);
-void   addVariableData(const char* varName, double *array, size_t dataSize);
-double* getDataArray(const char* varName);    
+void   setupVariables(const SimParams *params, FieldArena *arena);
+void   clearGlobalVariables(void);
+void   addVariableData(const char* varName, Real *array, Real *next, size_t dataSize);
+Real* getDataArray(const char* varName);    
+Real* getNextDataArray(const char* varName);
+void   swapDataArrays(void);
 VariableBoundary* findVariableBoundary(const char *name, SimParams *params);
 
 //-----------------------------------------------------------------------------
-// Function prototype for applying boundary conditions.
+// Boundary kernels: one face-pair routine per axis, specialized on the
+// boundary types and chosen once per variable by selectBoundaryKernel.
+// A face routine fills the ghosts of rows [begin, end) of its outer loop
+// (j for the X faces, i for the Y and Z faces) and runs serially.
 //----------------------------------------------------------------------------- 
-void applyBoundaryConditions(double *arr, const SimParams *params, int strides[], FaceBoundary bc);
+typedef void (*BoundaryFaceFn)(Real *arr, const SimParams *params, int strides[], int begin, int end);
+
+struct BoundaryKernel {
+    BoundaryFaceFn faceX, faceY, faceZ;   // faceZ is null in 2D
+};
+
+BoundaryKernel selectBoundaryKernel(const SimParams *params, FaceBoundary bc);
+void applyBoundaryConditions(Real *const arrs[], const BoundaryKernel bks[], int nfields,
+                             const SimParams *params, int strides[]);
 
 //-----------------------------------------------------------------------------
 // Function prototypes for simulation routines.
 //----------------------------------------------------------------------------- 
-void   FillCube(double *arr, const VariableBoundary *vb, const SimParams *params, int strides[]);
-void   FillSphere(double *arr, const VariableBoundary *vb, const SimParams *params, int strides[]);
-void   FillConstant(double *arr, const VariableBoundary *vb, const SimParams *params, int strides[]);
-void   updateTemp(double *temp, FieldBuffers *fb, const SimParams *params, int strides[], double r2[]);
-double computeLaplacian(double *arr, int index, int strides[], double r2[], int dim);
-void   computedfdphi(double *phi, double *dfdphi, double *temp, const SimParams *params, int strides[]);
-void   updatePhi(double *phi, FieldBuffers *fb, const SimParams *params, double r[], int strides[]);
-void   computeGradientPhi(double *phi, FieldBuffers *fb, const SimParams *params, double r[], int strides[]); 
-void   computeAnisotropy(FieldBuffers *fb, const SimParams *params, int strides[]);     
-void   copyInterior(double *dst, double *src, const SimParams *params, int strides[]);
+void   FillCube(Real *arr, const VariableBoundary *vb, const SimParams *params, int strides[]);
+void   FillSphere(Real *arr, const VariableBoundary *vb, const SimParams *params, int strides[]);
+void   FillConstant(Real *arr, const VariableBoundary *vb, const SimParams *params, int strides[]);
+
+//-----------------------------------------------------------------------------
+// Stencil kernels, templated on the dimension (DIM) and, for the anisotropy,
+// on the symmetry handled by the algebraic engine (J = 4, 6; 0 = trig).
+// Instantiated for DIM = 2, 3 in their translation units. The *Vector
+// variants evaluate the transcendental functions with vecmath.hpp.
+// Their outer loops are orphaned `omp for` constructs: inside the parallel
+// region of main they split the work across the team, outside they run
+// serially. The same holds for applyBoundaryConditions and the Fill* routines.
+//----------------------------------------------------------------------------- 
+template <int DIM>
+void computedfdphiKernel(Real *phi, Real *dfdphi, Real *temp, const SimParams *params, int strides[]);
+template <int DIM>
+void computedfdphiVectorKernel(Real *phi, Real *dfdphi, Real *temp, const SimParams *params, int strides[]);
+template <int DIM>
+void computeGradientPhiKernel(Real *phi, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[]);
+template <int DIM, int J>
+void computeAnisotropyKernel(FieldBuffers *fb, const SimParams *params, int strides[]);
+template <int DIM>
+void computeAnisotropyVectorKernel(FieldBuffers *fb, const SimParams *params, int strides[]);
+template <int DIM>
+void updatePhiKernel(Real *phi, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[], int step);
+template <int DIM, int J>
+void updatePhiFusedKernel(Real *phi, Real *temp, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[], int step);
+template <bool VEC>
+void updatePhiCubicKernel(Real *phi, Real *temp, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[], int step);
+template <int DIM>
+void updateTempKernel(Real *temp, FieldBuffers *fb, const SimParams *params, int strides[], Accum r2[]);
+template <int DIM>
+void updateTempADIKernel(Real *temp, FieldBuffers *fb, const SimParams *params, int strides[], Accum r2[]);
+void freeAdiFactors(void);
+template <int DIM>
+void updateTempMultigridKernel(Real *temp, FieldBuffers *fb, const SimParams *params, int strides[], Accum r2[]);
+template <int DIM>
+void updatePhiIMEXKernel(Real *phi, FieldBuffers *fb, const SimParams *params, int strides[]);
+void printMultigridReport(void);
+void freeMultigrid(void);
+template <int DIM>
+void updateSpectralKernel(Real *temp, FieldBuffers *fb, const SimParams *params, int strides[], Accum r2[]);
+void freeSpectral(void);
+
+//-----------------------------------------------------------------------------
+// Kernel table filled once by selectKernels after readParameters
+//----------------------------------------------------------------------------- 
+struct KernelTable {
+    void (*computedfdphi)(Real *phi, Real *dfdphi, Real *temp, const SimParams *params, int strides[]);
+    void (*computeGradientPhi)(Real *phi, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[]);
+    void (*computeAnisotropy)(FieldBuffers *fb, const SimParams *params, int strides[]);
+    void (*updatePhi)(Real *phi, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[], int step);
+    void (*updatePhiFused)(Real *phi, Real *temp, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[], int step);
+    void (*updateTemp)(Real *temp, FieldBuffers *fb, const SimParams *params, int strides[], Accum r2[]);
+    void (*stabilizePhi)(Real *phi, FieldBuffers *fb, const SimParams *params, int strides[]);   // null unless PHI_SOLVER = IMEX
+    BoundaryKernel phiBoundary;
+    BoundaryKernel tempBoundary;
+};
+
+void selectKernels(const SimParams *params, KernelTable *kt);
+
+//-----------------------------------------------------------------------------
+// Temporal blocking routines
+//-----------------------------------------------------------------------------
+void setupTemporalBlocking(const SimParams *params, TemporalBlocking *tb);
+int  temporalBlockLength(const SimParams *params, const TemporalBlocking *tb, int t);
+void advanceTemporalBlock(Real *phi, Real *temp, FieldBuffers *fb, TemporalBlocking *tb,
+                          const SimParams *params, const KernelTable *kt,
+                          Accum r[], Accum r2[], int strides[], int step, int nsteps);
+void freeTemporalBlocking(TemporalBlocking *tb);
+FieldBuffers shiftFieldBuffers(const FieldBuffers &fb, size_t shift);
+
+//-----------------------------------------------------------------------------
+// Domain decomposition (make MPI=1): one x-slab of the global grid per rank,
+// halo columns exchanged every step (decomposition.cpp). Without MPI, or on
+// one rank, the slab is the whole grid and global equals the run parameters.
+//-----------------------------------------------------------------------------
+static constexpr int HALO_FIELDS = 2;   // phi, temp
+
+struct Decomposition {
+    int rank, nranks;
+    SimParams global;           // parameters of the global grid
+    int x_first;                // global index of the first owned column (local column 1)
+    int *x_start;               // first owned global column of every rank, nranks+1 entries
+    int *global_x;              // global x index of each local column
+    BoundaryKernel boundaries[HALO_FIELDS];  // x face kernels only on the global x faces
+    int recv_from[HALO_FIELDS][2];   // rank filling the left/right halo, -1 for none
+    int send_to[HALO_FIELDS][2];     // rank receiving the first/last owned column, -1 for none
+    int wraps[HALO_FIELDS][2];       // 1 when that halo is a periodic x ghost column
+    Real *stage;                // receive buffers of the wrapped halo columns
+    FieldArena gather;          // global field on rank 0, for output and respawn
+};
+
+// Signature shared by write_output_* and read_input_*
+typedef void (*FieldIO)(const char *filename, Real *arr, const SimParams *params, int strides[]);
+
+void initDecomposition(int *argc, char ***argv, Decomposition *dec);
+int  decomposeDomain(SimParams *params, Decomposition *dec);
+void setupDecompositionBuffers(Decomposition *dec, int strides[]);
+void advanceDecomposed(Real *phi, Real *temp, FieldBuffers *fb, Decomposition *dec,
+                       const SimParams *params, const KernelTable *kt,
+                       Accum r[], Accum r2[], int strides[], int step);
+void writeGlobalField(Decomposition *dec, FieldIO write, const char *filename, Real *arr, int strides[]);
+void readGlobalField(Decomposition *dec, FieldIO read, const char *filename, Real *arr, int strides[]);
+double maxOverRanks(const Decomposition *dec, double value);
+int  shareFromRank0(const Decomposition *dec, int value);
+void finalizeDecomposition(Decomposition *dec);
+
+//-----------------------------------------------------------------------------
+// Narrow band routines
+//-----------------------------------------------------------------------------
+void setupNarrowBand(SimParams *params, NarrowBand *nb);
+void buildNarrowBand(Real *phi, FieldBuffers *fb, NarrowBand *nb, const SimParams *params, int strides[]);
+void trackNarrowBand(Real *phi, FieldBuffers *fb, NarrowBand *nb, const SimParams *params, int strides[]);
+void startNarrowBandInterval(NarrowBand *nb);
+void reportNarrowBandInterval(NarrowBand *nb, const SimParams *params, int step);
+void printNarrowBandReport(const NarrowBand *nb, const SimParams *params);
+void freeNarrowBand(NarrowBand *nb);
+
+//-----------------------------------------------------------------------------
+// Tile activity routines
+//-----------------------------------------------------------------------------
+void setupTileActivity(SimParams *params, TileMap *tm);
+void trackTileActivity(Real *phi, Real *temp, FieldBuffers *fb, TileMap *tm, const SimParams *params, int strides[]);
+void startTileInterval(TileMap *tm);
+void reportTileInterval(TileMap *tm, const SimParams *params, int step);
+void printTileReport(const TileMap *tm, const SimParams *params);
+void freeTileActivity(TileMap *tm);
+
+//-----------------------------------------------------------------------------
+// Block-structured refinement routines
+//-----------------------------------------------------------------------------
+void setupAmr(const SimParams *params, AmrLevel *amr);
+void buildAmr(Real *phi, Real *temp, AmrLevel *amr, const SimParams *params,
+              const KernelTable *kt, int strides[]);
+void advanceAmr(Real *phi, Real *temp, FieldBuffers *fb, AmrLevel *amr, const SimParams *params,
+                const KernelTable *kt, int strides[], int step);
+void writeAmrFields(const AmrLevel *amr, Real *phi, Real *temp, const SimParams *params,
+                    int strides[], int step);
+void startAmrInterval(AmrLevel *amr);
+void reportAmrInterval(AmrLevel *amr, const SimParams *params, int step);
+void printAmrReport(const AmrLevel *amr, const SimParams *params);
+void freeAmr(AmrLevel *amr);
+
+//-----------------------------------------------------------------------------
+// Local time stepping routines
+//-----------------------------------------------------------------------------
+void setupLocalTimeStep(SimParams *params, const TileMap *tm, LocalTimeStep *lts);
+void advanceLocalTimeStep(Real *phi, Real *temp, FieldBuffers *fb, LocalTimeStep *lts, TileMap *tm,
+                          const SimParams *params, const KernelTable *kt, Accum r[], Accum r2[],
+                          int strides[], int step);
+void startLtsInterval(LocalTimeStep *lts);
+void reportLtsInterval(LocalTimeStep *lts, const SimParams *params, int step);
+void printLtsReport(const LocalTimeStep *lts, const SimParams *params, const TileMap *tm);
+void freeLocalTimeStep(LocalTimeStep *lts);
+
+//-----------------------------------------------------------------------------
+// Moving window routines
+//-----------------------------------------------------------------------------
+int  setupMovingWindow(SimParams *params, MovingWindow *mw);
+int  shiftMovingWindow(Real *phi, Real *temp, MovingWindow *mw, const SimParams *params, int strides[]);
+void recordWindowOffset(const MovingWindow *mw, const SimParams *params, int step);
+void printMovingWindowReport(const MovingWindow *mw, const SimParams *params);
+void freeMovingWindow(MovingWindow *mw);
+
+//-----------------------------------------------------------------------------
+// Adaptive time stepping
+//-----------------------------------------------------------------------------
+void phiStiffnessBounds(const SimParams *params, double *D, double *L);
+double stableTimestep(const SimParams *params);
+void   setupTimeControl(SimParams *params, TimeControl *tc);
+double maxAbsInterior(const Real *arr, const SimParams *params, int strides[]);
+void   advanceClock(TimeControl *tc, SimParams *params, double rate);
 
 #endif // HEADER_HPP
@@ -0,0 +1,39 @@
+#ifndef INTERVAL_TIMER_HPP
+#define INTERVAL_TIMER_HPP
+
+/*
+ * interval_timer.hpp
+ *
+ * Timing of the output intervals reported by the optional modes (narrow
+ * band, tile skipping, AMR, local time stepping) and of the shifts of the
+ * moving window. Each mode stores wallSeconds() when an interval starts and
+ * prints the seconds and throughput of the interval before the output.
+ */
+
+#include "header.hpp"
+#include <chrono>
+
+/**
+ * @brief Seconds on a monotonic wall clock.
+ */
+inline double wallSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Interior cells of the grid, ghost cells excluded.
+ */
+inline double interiorCells(const SimParams *params) {
+    return (double)(params->Num_X - 2) * (params->Num_Y - 2)
+         * ((params->DIM == 3) ? params->Num_Z - 2 : 1);
+}
+
+/**
+ * @brief Mcell-updates/s of cells updated on each of steps steps taking
+ * seconds, as the time-loop report counts them (0 when nothing was timed).
+ */
+inline double cellRate(double cells, int steps, double seconds) {
+    return (seconds > 0.0) ? cells * steps / seconds * 1e-6 : 0.0;
+}
+
+#endif
@@ -0,0 +1,437 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+/*
+ * kernels.hpp
+ *
+ * Inline per-cell building blocks shared by the templated stencil kernels.
+ * Keeping them in one place guarantees that the split (multi-pass) and the
+ * fused (single-pass) paths evaluate exactly the same expressions:
+ *  - Interior: loop bounds and strides of the interior grid, with the
+ *    k-range and the y-stride fixed at compile time in 2D, its
+ *    decomposition into unit-stride runs, and the parts of each run a
+ *    kernel updates (all of it, or the narrow band, less the skipped tiles)
+ *  - laplacian: 5/7-point Laplacian for a given dimension
+ *  - fluxX, fluxY: anisotropic flux through an x or y face
+ *  - AnisotropyCoeffs: per-run anisotropy constants, built once per sweep
+ *  - anisotropyAt: anisotropy function and its angular derivative for a
+ *    given gradient direction, using either trig calls (J = 0) or the
+ *    algebraic multiple-angle engine (J = 4 or 6)
+ *  - CubicCoeffs, cubicFlux: cubic anisotropy flux through a face for DIM = 3
+ *  - NoiseRun: thermal noise for one run of cells from the Philox stream
+ *  - recordPhiActivity, recordTempActivity: per-tile activity of a run
+ *    segment for the tile activity map (TILE_SKIP)
+ */
+
+#include "header.hpp"
+#include "philox.hpp"
+#include <cmath>
+
+//-----------------------------------------------------------------------------
+// Interior loop bounds
+//-----------------------------------------------------------------------------
+template <int DIM>
+struct Interior {
+    int NX, NY;
+    int kstart, kend;   // [0, 1) in 2D, [1, NZ-1) in 3D
+    int sx, sy;         // sy == 1 in 2D
+    const int *xglobal; // global x index per column on tile-local grids, else null
+    int ybase, zbase;   // global y and z index of row and plane 0
+    int NYg, NZg;       // Num_Y and Num_Z of the global grid
+    const NarrowBand *band; // NARROW_BAND = 1 on the phi kernels, else null
+    const TileMap *tiles;   // TILE_SKIP = 1, else null
+    const unsigned char *active;    // tile flags of the field updated, or null
+
+    // temp: loop bounds of the temperature update, which ignores the narrow
+    // band and follows the temp flags of the tile map
+    Interior(const SimParams *params, const int strides[], bool temp = false)
+        : NX(params->Num_X), NY(params->Num_Y),
+          kstart((DIM == 3) ? 1 : 0),
+          kend((DIM == 3) ? params->Num_Z - 1 : 1),
+          sx(strides[0]),
+          sy((DIM == 3) ? strides[1] : 1),
+          xglobal(params->global_x),
+          ybase(params->global_y0), zbase(params->global_z0),
+          NYg(params->global_NY ? params->global_NY : params->Num_Y),
+          NZg(params->global_NZ ? params->global_NZ : params->Num_Z),
+          band(temp ? nullptr : params->band),
+          tiles(params->tiles),
+          active(params->tiles ? (temp ? params->tiles->temp_on : params->tiles->phi_on) : nullptr) {}
+
+    // Unit-stride runs of interior cells: one per i along j in 2D, one per
+    // (i, j) along k in 3D. r numbers the runs of plane i.
+    int runs() const { return (DIM == 3) ? NY - 2 : 1; }
+    int runLength() const { return (DIM == 3) ? kend - kstart : NY - 2; }
+    int runStart(int i, int r) const {
+        return (DIM == 3) ? i * sx + (r + 1) * sy + kstart : i * sx + 1;
+    }
+    // Logical cell id (i * NY + j) * NZ + k of the first cell of a run,
+    // independent of any padding in the strides; i, j, k and the extents
+    // are those of the global grid
+    uint64_t runCellId(int i, int r) const {
+        if (xglobal) i = xglobal[i];
+        return (DIM == 3) ? ((uint64_t)i * NYg + ybase + r + 1) * (uint64_t)NZg + zbase + kstart
+                          : (uint64_t)i * NYg + ybase + 1;
+    }
+    // Cells [lo, hi) of run r of plane i that the phi kernels update, as
+    // offsets from runStart: the narrow band when there is one, else all
+    void runRange(int i, int r, int *lo, int *hi) const {
+        if (band) {
+            const int q = i * band->runs + r;
+            *lo = band->lo[q];
+            *hi = band->hi[q];
+        } else {
+            *lo = 0;
+            *hi = runLength();
+        }
+    }
+    // Tile flags along run r of plane i, indexed by offset / tiles->size
+    const unsigned char *tileRow(int i, int r) const {
+        const int T = tiles->size;
+        return active + ((i - 1) / T) * tiles->perPlane + ((DIM == 3) ? (r / T) * tiles->ntz : 0);
+    }
+    // Next part [lo, hi) of run r of plane i to update, from offset *pos on:
+    // runRange less the skipped tiles (TILE_SKIP). Returns false when none
+    // is left; start with *pos = 0, which then moves past each part:
+    //   for (int pos = 0; g.nextSegment(i, r, &pos, &lo, &hi); ) { ... }
+    bool nextSegment(int i, int r, int *pos, int *lo, int *hi) const {
+        int a, b;
+        runRange(i, r, &a, &b);
+        if (*pos > a) a = *pos;
+        if (active) {
+            const int T = tiles->size;
+            const unsigned char *row = tileRow(i, r);
+            while (a < b && !row[a / T]) a = (a / T + 1) * T;
+            int e = a;
+            while (e < b && row[e / T]) e = (e / T + 1) * T;
+            if (e < b) b = e;
+        }
+        if (a >= b) return false;
+        *lo = a;
+        *hi = b;
+        *pos = b;
+        return true;
+    }
+    // The same as bounds of j in plane i, for loops over j at k = kstart
+    bool nextJSegment(int i, int *pos, int *jlo, int *jhi) const {
+        if (DIM == 2) {
+            if (!nextSegment(i, 0, pos, jlo, jhi)) return false;
+            *jlo += 1;
+            *jhi += 1;
+            return true;
+        }
+        if (*pos > 0) return false;
+        *pos = 1;
+        *jlo = 1;
+        *jhi = NY - 1;
+        return true;
+    }
+};
+
+/**
+ * @brief Discrete Laplacian of arr at a flattened index (5-point in 2D, 7-point in 3D).
+ *
+ * @param arr  Input array.
+ * @param idx  Flattened index for which to compute the Laplacian.
+ * @param sx   Stride in x.
+ * @param sy   Stride in y.
+ * @param r2   Squared inverse grid spacings: [1/dx*dx, 1/dy*dy, 1/dz*dz].
+ */
+template <int DIM>
+static inline Accum laplacian(const Real *arr, int idx, int sx, int sy, const Accum r2[]) {
+    const Accum c = arr[idx];
+    // X-direction
+    Accum lap = (Accum(arr[idx + sx]) - Accum(2.0) * c + Accum(arr[idx - sx])) * r2[0];
+    // Y-direction
+    lap += (Accum(arr[idx + sy]) - Accum(2.0) * c + Accum(arr[idx - sy])) * r2[1];
+    // Z-direction if 3D
+    if (DIM == 3) {
+        lap += (Accum(arr[idx + 1]) - Accum(2.0) * c + Accum(arr[idx - 1])) * r2[2];
+    }
+    return lap;
+}
+
+/**
+ * @brief Anisotropic flux through an x face, a (a gx - a' gy), and through a
+ * y face, a (a gy + a' gx), from the face anisotropy and gradient.
+ */
+static inline Accum fluxX(Accum ac, Accum ac_p, Accum gx, Accum gy) {
+    return ac * (ac * gx - ac_p * gy);
+}
+
+static inline Accum fluxY(Accum ac, Accum ac_p, Accum gy, Accum gx) {
+    return ac * (ac * gy + ac_p * gx);
+}
+
+//-----------------------------------------------------------------------------
+// Anisotropy constants hoisted out of the cell loops
+//-----------------------------------------------------------------------------
+struct AnisotropyCoeffs {
+    Accum eps, delta, theta0;
+    int   jmult;
+    Accum cos_j0, sin_j0;    // cos(j theta0), sin(j theta0)
+};
+
+/**
+ * @brief Gather the anisotropy constants for one sweep.
+ */
+static inline AnisotropyCoeffs makeAnisotropyCoeffs(const SimParams *params) {
+    AnisotropyCoeffs c;
+    c.eps    = params->epsilon;
+    c.delta  = params->delta;
+    c.theta0 = params->theta_0;
+    c.jmult  = params->j;
+    c.cos_j0 = std::cos(c.jmult * params->theta_0);
+    c.sin_j0 = std::sin(c.jmult * params->theta_0);
+    return c;
+}
+
+/**
+ * @brief Anisotropy symmetry used to instantiate the kernels.
+ *
+ * Returns j when the algebraic engine can handle it (j = 4 or 6 with
+ * ANISOTROPY_ENGINE = ALGEBRAIC) and 0, the generic trig path, otherwise.
+ */
+static inline int anisotropySymmetry(const SimParams *params) {
+    if (params->ANISOTROPY_ENGINE == ANISOTROPY_ALGEBRAIC && (params->j == 4 || params->j == 6)) {
+        return params->j;
+    }
+    return 0;
+}
+
+// Squared gradient norms the algebraic engine normalizes directly; outside
+// this range 1/sqrt(g2) could underflow or overflow and atan2 is used
+#if defined(PRECISION_SINGLE)
+static constexpr Accum ANISOTROPY_G2_MIN = 1e-30f;
+static constexpr Accum ANISOTROPY_G2_MAX = 1e30f;
+#else
+static constexpr Accum ANISOTROPY_G2_MIN = 1e-280;
+static constexpr Accum ANISOTROPY_G2_MAX = 1e280;
+#endif
+
+/**
+ * @brief Evaluate the anisotropy function for the gradient direction (gx, gy).
+ *
+ *   theta = atan2(gy, gx)
+ *   a_c   = epsilon * [1 + delta cos(j (theta - theta0))]
+ *   a_p   = -epsilon * delta * j * sin(j (theta - theta0))
+ *
+ * J = 0 evaluates the expressions above with trig calls for any j.
+ * J = 4 or 6 selects the algebraic engine, which never forms theta. With
+ * (c, s) = (gx, gy)/|g| it builds cos(2 theta) = c^2 - s^2 and
+ * sin(2 theta) = 2cs, raises that pair to the power J/2 with the
+ * double/triple-angle identities, and rotates the result by j*theta0 using
+ * the precomputed cos(j theta0), sin(j theta0). A zero gradient takes
+ * theta = 0, as atan2(0, 0) does; gradients whose squared norm would
+ * underflow or overflow use the trig path.
+ *
+ * Tolerance: against the trig path, |a_c - a_c(trig)| <= 1e-14 * epsilon and
+ * |a_p - a_p(trig)| <= 1e-14 * epsilon * delta * j for all finite gradients
+ * (in double arithmetic; with PRECISION=single the bound scales with the
+ * float epsilon).
+ *
+ * @param gx      x-component of the phase-field gradient
+ * @param gy      y-component of the phase-field gradient
+ * @param c       Anisotropy constants from makeAnisotropyCoeffs
+ * @param ac      Output anisotropy value a(theta)
+ * @param ac_p    Output angular derivative a'(theta)
+ */
+template <int J>
+static inline void anisotropyAt(Accum gx, Accum gy, const AnisotropyCoeffs &c, Accum *ac, Accum *ac_p) {
+    if (J == 4 || J == 6) {
+        Accum g2 = gx * gx + gy * gy;
+        Accum cj, sj;   // cos(j theta), sin(j theta)
+        if (gx == Accum(0.0) && gy == Accum(0.0)) {
+            cj = 1.0;
+            sj = 0.0;
+        } else if (g2 >= ANISOTROPY_G2_MIN && g2 <= ANISOTROPY_G2_MAX) {
+            Accum inv = Accum(1.0) / std::sqrt(g2);
+            Accum cs = gx * inv, sn = gy * inv;
+            Accum c2 = cs * cs - sn * sn;      // cos(2 theta)
+            Accum s2 = Accum(2.0) * cs * sn;   // sin(2 theta)
+            if (J == 4) {
+                cj = c2 * c2 - s2 * s2;
+                sj = Accum(2.0) * c2 * s2;
+            } else {
+                cj = c2 * (c2 * c2 - Accum(3.0) * s2 * s2);
+                sj = s2 * (Accum(3.0) * c2 * c2 - s2 * s2);
+            }
+        } else {
+            Accum theta = std::atan2(gy, gx);
+            cj = std::cos(J * theta);
+            sj = std::sin(J * theta);
+        }
+        // cos/sin(j (theta - theta0)) by rotation
+        Accum cosv = cj * c.cos_j0 + sj * c.sin_j0;
+        Accum sinv = sj * c.cos_j0 - cj * c.sin_j0;
+        *ac   = c.eps * (Accum(1.0) + c.delta * cosv);
+        *ac_p = -c.eps * (c.delta * J * sinv);
+        return;
+    }
+
+    Accum theta = std::atan2(gy, gx);
+    *ac   = c.eps * (Accum(1.0) + c.delta * std::cos(c.jmult * (theta - c.theta0)));
+    *ac_p = -c.eps * (c.delta * c.jmult * std::sin(c.jmult * (theta - c.theta0)));
+}
+
+//-----------------------------------------------------------------------------
+// Cubic anisotropy for DIM = 3 (phasefield_cubic.cpp)
+//-----------------------------------------------------------------------------
+struct CubicCoeffs {
+    Accum eps2, delta;
+    Accum c0, s0;   // cos(theta0), sin(theta0): crystal axes rotated about z
+};
+
+/**
+ * @brief Gather the cubic anisotropy constants for one sweep.
+ */
+static inline CubicCoeffs makeCubicCoeffs(const SimParams *params) {
+    CubicCoeffs c;
+    c.eps2  = params->epsilon * params->epsilon;
+    c.delta = params->delta;
+    c.c0    = std::cos(params->theta_0);
+    c.s0    = std::sin(params->theta_0);
+    return c;
+}
+
+/**
+ * @brief Flux of the cubic anisotropy through a face normal to axis N
+ * (0 = x, 1 = y, 2 = z), from the face gradient g.
+ *
+ * With n = g/|g| in the crystal frame (g rotated by -theta0 about z),
+ *
+ *   eps(n) = epsilon * a(n),  a(n) = 1 + delta (4 (nx^4 + ny^4 + nz^4) - 3)
+ *   J      = d/dg [eps(n)^2 |g|^2 / 2]
+ *          = epsilon^2 a [a g + 16 delta (g^3/|g|^2 - S4 g)],  S4 = sum n^4
+ *
+ * so J_i = g_i (A + B n_i^2) with A = epsilon^2 a (a - 16 delta S4) and
+ * B = 16 delta epsilon^2 a, and J is rotated back by theta0. For nz = 0 this
+ * is the 2D Kobayashi flux with j = 4, a (a g_x - a' g_y) of fluxX. A zero
+ * gradient gives a zero flux. Branch-free, so that the k loops vectorize;
+ * valid for |g| below 1e154 (1e19 in single precision).
+ */
+template <int N>
+static inline Accum cubicFlux(Accum gx, Accum gy, Accum gz, const CubicCoeffs &c) {
+    const Accum ux = c.c0 * gx + c.s0 * gy;
+    const Accum uy = c.c0 * gy - c.s0 * gx;
+    const Accum x2 = ux * ux, y2 = uy * uy, z2 = gz * gz;
+    const Accum g2 = x2 + y2 + z2;
+    // The floor turns 0/0 into n = 0 for a vanishing gradient and leaves any
+    // g2 above ~1e16 ANISOTROPY_G2_MIN unchanged; an add, unlike a compare,
+    // keeps the loop free of branches
+    const Accum inv = Accum(1.0) / (g2 + ANISOTROPY_G2_MIN);
+    const Accum nx2 = x2 * inv, ny2 = y2 * inv, nz2 = z2 * inv;
+    const Accum s4 = nx2 * nx2 + ny2 * ny2 + nz2 * nz2;
+    const Accum a  = Accum(1.0) + c.delta * (Accum(4.0) * s4 - Accum(3.0));
+    const Accum A  = c.eps2 * a * (a - Accum(16.0) * c.delta * s4);
+    const Accum B  = Accum(16.0) * c.delta * c.eps2 * a;
+    if (N == 2) {
+        return gz * (A + B * nz2);
+    }
+    const Accum jx = ux * (A + B * nx2);
+    const Accum jy = uy * (A + B * ny2);
+    return (N == 0) ? c.c0 * jx - c.s0 * jy : c.s0 * jx + c.c0 * jy;
+}
+
+/**
+ * @brief Thermal noise a * (u - 0.5) along one run of cells, u uniform in [0, 1).
+ *
+ * u comes from philoxUniformRun keyed on (noise_seed, step, cell id) and is
+ * produced NOISE_BATCH cells at a time as the run is walked in order:
+ *
+ *   NoiseRun noise(params, step, g.runCellId(i, r), g.runLength());
+ *   for (int n = 0; n < len; ++n) { ... noise.next() ... }
+ */
+struct NoiseRun {
+    uint64_t seed, step, id;
+    int left, pos, fill;
+    double a;
+    double u[NOISE_BATCH];   // generated in double in every precision
+
+    NoiseRun(const SimParams *params, int step_, uint64_t id0, int len)
+        : seed(params->noise_seed), step((uint64_t)step_), id(id0),
+          left(len), pos(0), fill(0), a(params->a) {}
+
+    Accum next() {
+        if (pos == fill) {
+            fill = (left < NOISE_BATCH) ? left : NOISE_BATCH;
+            philoxUniformRun(seed, step, id, fill, u);
+            id   += fill;
+            left -= fill;
+            pos   = 0;
+        }
+        return Accum(a * (u[pos++] - 0.5));
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Tile activity records (TILE_SKIP = 1, tile_activity.cpp). Called after a
+// kernel has updated cells [lo, hi) of run r of plane i; each keeps the
+// largest value of every tile the segment crosses in the record of plane
+// i, which only the thread updating that plane writes.
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Largest |dphi_dt| of the segment per tile, into tiles->phi_rate.
+ */
+template <int DIM>
+static inline void recordPhiActivity(const Interior<DIM> &g, int i, int r, int lo, int hi, const Real *dphi_dt) {
+    const TileMap *tm = g.tiles;
+    const int T = tm->size;
+    const Real *v = dphi_dt + g.runStart(i, r);
+    double *rec = tm->phi_rate + (size_t)i * tm->perPlane + ((DIM == 3) ? (r / T) * tm->ntz : 0);
+    for (int a = lo; a < hi; ) {
+        const int e = ((a / T + 1) * T < hi) ? (a / T + 1) * T : hi;
+        Accum m = 0.0;
+        #pragma omp simd reduction(max : m)
+        for (int n = a; n < e; ++n) {
+            const Accum d = std::fabs(Accum(v[n]));
+            m = (d > m) ? d : m;
+        }
+        if (m > rec[a / T]) rec[a / T] = m;
+        a = e;
+    }
+}
+
+/**
+ * @brief Largest |grad T| of the segment per tile, into tiles->temp_grad:
+ * the one-sided differences through every face of its cells, so that the
+ * faces shared with neighbouring tiles count too.
+ */
+template <int DIM>
+static inline void recordTempActivity(const Interior<DIM> &g, int i, int r, int lo, int hi, const Real *temp,
+                                      const Accum r2[]) {
+    const TileMap *tm = g.tiles;
+    const int T = tm->size;
+    const int sx = g.sx, sy = g.sy;
+    const Real *c = temp + g.runStart(i, r);
+    const Accum rx = std::sqrt(r2[0]), ry = std::sqrt(r2[1]);
+    const Accum rz = (DIM == 3) ? std::sqrt(r2[2]) : Accum(0.0);
+    double *rec = tm->temp_grad + (size_t)i * tm->perPlane + ((DIM == 3) ? (r / T) * tm->ntz : 0);
+    for (int a = lo; a < hi; ) {
+        const int e = ((a / T + 1) * T < hi) ? (a / T + 1) * T : hi;
+        Accum mx = 0.0, my = 0.0, mz = 0.0;
+        #pragma omp simd reduction(max : mx, my, mz)
+        for (int n = a; n < e; ++n) {
+            const Accum t = c[n];
+            const Accum ex = std::fabs(Accum(c[n + sx]) - t), wx = std::fabs(t - Accum(c[n - sx]));
+            const Accum ny = std::fabs(Accum(c[n + sy]) - t), sy_ = std::fabs(t - Accum(c[n - sy]));
+            mx = (ex > mx) ? ex : mx;
+            mx = (wx > mx) ? wx : mx;
+            my = (ny > my) ? ny : my;
+            my = (sy_ > my) ? sy_ : my;
+            if (DIM == 3) {
+                const Accum fz = std::fabs(Accum(c[n + 1]) - t), bz = std::fabs(t - Accum(c[n - 1]));
+                mz = (fz > mz) ? fz : mz;
+                mz = (bz > mz) ? bz : mz;
+            }
+        }
+        Accum m = mx * rx;
+        if (my * ry > m) m = my * ry;
+        if (mz * rz > m) m = mz * rz;
+        if (m > rec[a / T]) rec[a / T] = m;
+        a = e;
+    }
+}
+
+#endif // KERNELS_HPP
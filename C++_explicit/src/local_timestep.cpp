@@ -0,0 +1,429 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include "interval_timer.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * local_timestep.cpp
+ *
+ * Local time stepping (LTS = 1). The stable dt is set by the interface,
+ * while the bulk solid and melt change slowly, so every tile of the tile
+ * map (TILE_SIZE cells per edge) gets a level L and advances by 2^L dt at
+ * the steps divisible by 2^L: the kernels run once per level due, with
+ * the tile flags of the map selecting the tiles of that level and dt
+ * scaled by 2^L. In between, a tile keeps its values in both generations.
+ * Every 2^(LTS_LEVELS-1) steps (a cycle) all tiles reach the same time,
+ * and the levels of the next cycle are chosen from the activity the
+ * kernels recorded over the last one (as for TILE_SKIP): the largest L whose step changes the
+ * tile by at most LTS_TOL, with neighbouring tiles at most one level apart,
+ * and at most the explicit stability limit.
+ *
+ * Within a tile, phi and temp share the step, so the latent heat K dphi_dt
+ * added by updateTemp is exactly K times the change of phi over it. Across
+ * the face between a tile and a finer neighbour, the coarse tile's
+ * diffusive flux is replaced by the sum of the fluxes of the fine steps,
+ * collected in a register per face cell: the heat one side loses is what
+ * the other gains, and temp - K phi is conserved.
+ *  - setupLocalTimeStep: levels, tile sizes and registers
+ *  - advanceLocalTimeStep: one step, with every level due
+ *  - reportLtsInterval / startLtsInterval: cell updates saved and
+ *    throughput of each output interval
+ *  - printLtsReport: cell updates saved over the whole run
+ *  - freeLocalTimeStep: release the levels and registers
+ */
+
+/**
+ * @brief Interior cells [lo, hi) of tile coordinate c along axis a (cells
+ * counted from 1, as the x-planes and the j and k indices are).
+ */
+static void tileSpan(const TileMap *tm, const int n[], int a, int c, int *lo, int *hi) {
+    *lo = 1 + c * tm->size;
+    *hi = (*lo + tm->size < n[a] + 1) ? *lo + tm->size : n[a] + 1;
+}
+
+/**
+ * @brief Set up the levels (null arrays unless LTS).
+ *
+ * Caps LTS_LEVELS so that the longest step stays within the explicit
+ * stability limit and a cycle divides timebreak and total_steps, so that
+ * the output finds every tile at the same time. Every tile starts at level 0.
+ */
+void setupLocalTimeStep(SimParams *params, const TileMap *tm, LocalTimeStep *lts) {
+    std::memset(lts, 0, sizeof(*lts));
+    if (!params->LTS) return;
+
+    int levels = params->LTS_LEVELS;
+    if (levels > LTS_MAX_LEVELS) levels = LTS_MAX_LEVELS;
+    const int asked = levels;
+    const double limit = stableTimestep(params);
+    while (levels > 1 && params->dt * (1 << (levels - 1)) > limit) --levels;
+    if (levels < asked) {
+        std::fprintf(stderr, "Note: LTS steps of up to %d dt stay within the stability limit %g; using %d level(s).\n",
+                     1 << (levels - 1), limit, levels);
+    }
+    const int capped = levels;
+    while (levels > 1 && (params->timebreak % (1 << (levels - 1)) != 0
+                          || params->total_timesteps % (1 << (levels - 1)) != 0)) --levels;
+    if (levels < capped) {
+        std::fprintf(stderr, "Note: LTS cycles must divide timebreak = %d and total_steps = %d; using %d level(s).\n",
+                     params->timebreak, params->total_timesteps, levels);
+    }
+    lts->levels = levels;
+    lts->cycle = 1 << (levels - 1);
+
+    const int n[3] = { params->Num_X - 2, params->Num_Y - 2, (params->DIM == 3) ? params->Num_Z - 2 : 1 };
+    const int ntiles[3] = { tm->ntx, tm->nty, tm->ntz };
+    lts->level = (unsigned char*)std::calloc(tm->count, 1);
+    lts->raw = (unsigned char*)std::calloc(tm->count, 1);
+    lts->cells = (long*)std::malloc(tm->count * sizeof(long));
+    for (int t = 0; t < tm->count; ++t) {
+        const int c[3] = { t / tm->perPlane, (t / tm->ntz) % tm->nty, t % tm->ntz };
+        long cells = 1;
+        for (int a = 0; a < params->DIM; ++a) {
+            int lo, hi;
+            tileSpan(tm, n, a, c[a], &lo, &hi);
+            cells *= hi - lo;
+        }
+        lts->cells[t] = cells;
+    }
+    lts->levelTiles[0] = tm->count;
+    lts->levelCells[0] = (double)n[0] * n[1] * n[2];
+    lts->faceCells = (params->DIM == 3) ? tm->size * tm->size : tm->size;
+    lts->reg = (double*)std::calloc((size_t)tm->count * 2 * params->DIM * lts->faceCells, sizeof(double));
+
+    const VariableBoundary *vb = findVariableBoundary("temp", params);
+    if (vb) {
+        lts->wrap[0] = vb->bc.left == BOUNDARY_PERIODIC && ntiles[0] > 1;
+        lts->wrap[1] = vb->bc.bottom == BOUNDARY_PERIODIC && ntiles[1] > 1;
+        lts->wrap[2] = params->DIM == 3 && vb->bc.back == BOUNDARY_PERIODIC && ntiles[2] > 1;
+    }
+
+    std::printf("Local time stepping: %d tiles of %d^%d cells, steps of dt to %d dt, levels chosen every %d steps\n",
+                tm->count, tm->size, params->DIM, lts->cycle, lts->cycle);
+}
+
+/**
+ * @brief Run the phi and temp kernels on the tiles flagged in the tile
+ * map, with the step of lp.
+ */
+static void stepTiles(Real *phi, Real *temp, FieldBuffers *fb, const SimParams *lp,
+                      const KernelTable *kt, Accum r[], Accum r2[], int strides[], int step) {
+    if (lp->FUSED_KERNEL) {
+        kt->updatePhiFused(phi, temp, fb, lp, r, strides, step);
+    } else {
+        kt->computedfdphi(phi, fb->dfdphi, temp, lp, strides);
+        kt->computeGradientPhi(phi, fb, lp, r, strides);
+        kt->computeAnisotropy(fb, lp, strides);
+        kt->updatePhi(phi, fb, lp, r, strides, step);
+    }
+    kt->updateTemp(temp, fb, lp, strides, r2);
+}
+
+/**
+ * @brief Flux registers of the faces between tiles and their finer
+ * neighbours, at time index n (step n + 1).
+ *
+ * Each fine step through a face adds its diffusive heat to the register of
+ * the coarse tile's face cell, and the coarse step, which the kernel took
+ * with its own flux, starts the register from that flux removed. With
+ * apply, after the last fine step of a coarse one, the register goes into
+ * both generations of the coarse cell, which is waiting. Collection reads
+ * the current temp, which every update of the step has used, so it ends
+ * (at the implicit barrier) before the corrections write it.
+ *
+ * Every tile handles its own faces and writes its own cells only.
+ */
+template <int DIM>
+static void refluxTiles(Real *temp, Real *temp_new, LocalTimeStep *lts, const TileMap *tm,
+                        const SimParams *params, const int strides[], const Accum r2[], int n, bool apply) {
+    const int st[3] = { strides[0], (DIM == 3) ? strides[1] : 1, 1 };
+    const int nc[3] = { params->Num_X - 2, params->Num_Y - 2, (DIM == 3) ? params->Num_Z - 2 : 1 };
+    const int ntiles[3] = { tm->ntx, tm->nty, tm->ntz };
+
+    #pragma omp for schedule(dynamic, 4)
+    for (int t = 0; t < tm->count; ++t) {
+        const int Lc = lts->level[t];
+        if (Lc == 0) continue;
+        const int c[3] = { t / tm->perPlane, (t / tm->ntz) % tm->nty, t % tm->ntz };
+        for (int a = 0; a < DIM; ++a) {
+            for (int side = 0; side < 2; ++side) {
+                int q[3] = { c[0], c[1], c[2] };
+                q[a] += side ? 1 : -1;
+                if (q[a] < 0 || q[a] >= ntiles[a]) {
+                    if (!lts->wrap[a]) continue;
+                    q[a] = (q[a] + ntiles[a]) % ntiles[a];
+                }
+                const int Lf = lts->level[(q[0] * tm->nty + q[1]) * tm->ntz + q[2]];
+                if (Lf >= Lc || n % (1 << Lf) != 0) continue;
+                if (apply && (n + (1 << Lf)) % (1 << Lc) != 0) continue;
+
+                // Face layer u of this tile and layer v across it (wrapping
+                // to the opposite face when periodic)
+                int lo[3] = { 0, 0, 0 }, hi[3] = { 1, 1, 1 };
+                for (int b = 0; b < DIM; ++b) tileSpan(tm, nc, b, c[b], &lo[b], &hi[b]);
+                const int u = side ? hi[a] - 1 : lo[a];
+                int v = side ? u + 1 : u - 1;
+                if (v < 1) v = nc[a];
+                if (v > nc[a]) v = 1;
+                const int b0 = (a == 0) ? 1 : 0;
+                const int b1 = (DIM == 3) ? ((a == 2) ? 1 : 2) : 2;
+
+                double *reg = lts->reg + ((size_t)t * 2 * DIM + 2 * a + side) * lts->faceCells;
+                const bool coarseDue = n % (1 << Lc) == 0;
+                const double dtf = params->dt * (1 << Lf), dtc = params->dt * (1 << Lc);
+                int m = 0;
+                for (int p0 = lo[b0]; p0 < hi[b0]; ++p0) {
+                    for (int p1 = lo[b1]; p1 < hi[b1]; ++p1, ++m) {
+                        int cell[3];
+                        cell[a] = u;
+                        cell[b0] = p0;
+                        cell[b1] = p1;
+                        const int ic = cell[0] * st[0] + cell[1] * st[1] + ((DIM == 3) ? cell[2] : 0);
+                        if (apply) {
+                            temp[ic] = Real(double(temp[ic]) + reg[m]);
+                            temp_new[ic] = temp[ic];
+                            reg[m] = 0.0;
+                        } else {
+                            // Heat into the face cell per unit time
+                            const int in = ic + (v - u) * st[a];
+                            const double flux = (double(temp[in]) - double(temp[ic])) * double(r2[a]);
+                            if (coarseDue) reg[m] = -dtc * flux;
+                            reg[m] += dtf * flux;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Copy the new values of both fields over tile t into their current
+ * generation, so that both hold them while the tile waits.
+ */
+template <int DIM>
+static void holdTile(const TileMap *tm, int t, Real *phi, Real *temp, const FieldBuffers *fb,
+                     const SimParams *params, const int strides[]) {
+    const Interior<DIM> g(params, strides);
+    const int T = tm->size;
+    const int tx = t / tm->perPlane, ty = (t / tm->ntz) % tm->nty, tz = t % tm->ntz;
+    const int i0 = 1 + tx * T, i1 = (i0 + T < g.NX - 1) ? i0 + T : g.NX - 1;
+    const int r0 = (DIM == 3) ? ty * T : 0;
+    const int r1 = (DIM == 3) ? ((r0 + T < g.runs()) ? r0 + T : g.runs()) : 1;
+    const int n0 = ((DIM == 3) ? tz : ty) * T;
+    const int n1 = (n0 + T < g.runLength()) ? n0 + T : g.runLength();
+    for (int i = i0; i < i1; ++i) {
+        for (int r = r0; r < r1; ++r) {
+            const int start = g.runStart(i, r);
+            std::memcpy(phi + start + n0, fb->phi_new + start + n0, (size_t)(n1 - n0) * sizeof(Real));
+            std::memcpy(temp + start + n0, fb->temp_new + start + n0, (size_t)(n1 - n0) * sizeof(Real));
+        }
+    }
+}
+
+/**
+ * @brief Levels of the next cycle from the activity recorded over this one.
+ *
+ * A tile's change over a step of 2^L dt is bounded as in trackTileActivity
+ * by 2^L dt max(|dphi_dt|, 2 |grad T| (1/dx + 1/dy [+ 1/dz]) + K |dphi_dt|);
+ * the level is the largest one keeping it below LTS_TOL, then lowered
+ * until no neighbour (edges and corners included) is more than one level
+ * finer.
+ */
+static void chooseLevels(LocalTimeStep *lts, TileMap *tm, const SimParams *params) {
+    const int T = tm->size;
+    const int per = tm->perPlane;
+    const double dt = params->dt;
+    const double K = std::fabs(params->K);
+    double rsum = 1.0 / params->dx + 1.0 / params->dy;
+    if (params->DIM == 3) rsum += 1.0 / params->dz;
+
+    #pragma omp for
+    for (int t = 0; t < tm->count; ++t) {
+        const int i0 = 1 + (t / per) * T;
+        const int i1 = (i0 + T < params->Num_X - 1) ? i0 + T : params->Num_X - 1;
+        double rate = 0.0, grad = 0.0;
+        for (int i = i0; i < i1; ++i) {
+            double *pr = tm->phi_rate + (size_t)i * per + t % per;
+            double *tg = tm->temp_grad + (size_t)i * per + t % per;
+            if (*pr > rate) rate = *pr;
+            if (*tg > grad) grad = *tg;
+            *pr = 0.0;
+            *tg = 0.0;
+        }
+        double change = 2.0 * grad * rsum + K * rate;
+        if (rate > change) change = rate;
+        change *= dt;
+        int L = 0;
+        while (L + 1 < lts->levels && change * (1 << (L + 1)) <= params->LTS_TOL) ++L;
+        lts->raw[t] = (unsigned char)L;
+    }
+
+    #pragma omp single
+    {
+        const int nt[3] = { tm->ntx, tm->nty, tm->ntz };
+        for (int pass = 1; pass < lts->levels; ++pass) {
+            for (int t = 0; t < tm->count; ++t) {
+                const int c[3] = { t / per, (t / tm->ntz) % tm->nty, t % tm->ntz };
+                int L = lts->raw[t];
+                for (int dx = -1; dx <= 1; ++dx) {
+                    for (int dy = -1; dy <= 1; ++dy) {
+                        for (int dz = -1; dz <= 1; ++dz) {
+                            int q[3] = { c[0] + dx, c[1] + dy, c[2] + dz };
+                            bool inside = true;
+                            for (int a = 0; a < 3; ++a) {
+                                if (q[a] >= 0 && q[a] < nt[a]) continue;
+                                if (lts->wrap[a]) q[a] = (q[a] + nt[a]) % nt[a];
+                                else inside = false;
+                            }
+                            if (!inside) continue;
+                            const int nbL = lts->raw[(q[0] * tm->nty + q[1]) * tm->ntz + q[2]];
+                            if (nbL + 1 < L) L = nbL + 1;
+                        }
+                    }
+                }
+                lts->level[t] = (unsigned char)L;
+            }
+            std::memcpy(lts->raw, lts->level, tm->count);
+        }
+        if (lts->levels == 1) std::memcpy(lts->level, lts->raw, tm->count);
+        for (int L = 0; L < LTS_MAX_LEVELS; ++L) {
+            lts->levelTiles[L] = 0;
+            lts->levelCells[L] = 0.0;
+        }
+        for (int t = 0; t < tm->count; ++t) {
+            lts->levelTiles[lts->level[t]]++;
+            lts->levelCells[lts->level[t]] += lts->cells[t];
+        }
+    }
+}
+
+/**
+ * @brief One step: the levels of a new cycle, boundary conditions, the
+ * kernels once for every level due, the flux registers, and the tiles that
+ * stepped by more than dt keep their new values in both generations.
+ *
+ * Called by every thread of the team in place of the regular a-e. Step
+ * step advances from time index n = step - 1, at which the tiles of level
+ * L with n divisible by 2^L step; at a multiple of the cycle all tiles
+ * are at the same time.
+ */
+void advanceLocalTimeStep(Real *phi, Real *temp, FieldBuffers *fb, LocalTimeStep *lts, TileMap *tm,
+                          const SimParams *params, const KernelTable *kt, Accum r[], Accum r2[],
+                          int strides[], int step) {
+    const int n = step - 1;
+    // Levels of the cycle from the activity of the last one
+    if (lts->levels > 1 && n % lts->cycle == 0 && lts->total_steps > 0) chooseLevels(lts, tm, params);
+
+    // a) Ghost cells of both fields from the current generation
+    Real *fields[2] = { phi, temp };
+    const BoundaryKernel boundaries[2] = { kt->phiBoundary, kt->tempBoundary };
+    applyBoundaryConditions(fields, boundaries, 2, params, strides);
+
+    // b-e) The tiles of each level due, with its step
+    SimParams lp = *params;
+    for (int L = 0; L < lts->levels; ++L) {
+        if (n % (1 << L) != 0 || lts->levelTiles[L] == 0) continue;
+        #pragma omp for
+        for (int t = 0; t < tm->count; ++t) {
+            const unsigned char due = (lts->level[t] == L);
+            tm->phi_on[t] = due;
+            tm->temp_on[t] = due;
+        }
+        lp.dt = params->dt * (1 << L);
+        stepTiles(phi, temp, fb, &lp, kt, r, r2, strides, step);
+    }
+
+    // Fine fluxes into the registers, then the coarse cells they complete
+    for (int apply = 0; apply < 2; ++apply) {
+        if (params->DIM == 3) {
+            refluxTiles<3>(temp, fb->temp_new, lts, tm, params, strides, r2, n, apply);
+        } else {
+            refluxTiles<2>(temp, fb->temp_new, lts, tm, params, strides, r2, n, apply);
+        }
+    }
+
+    // Tiles that stepped and wait at the next step keep their new values
+    #pragma omp for
+    for (int t = 0; t < tm->count; ++t) {
+        const int L = lts->level[t];
+        if (L == 0 || n % (1 << L) != 0) continue;
+        if (params->DIM == 3) {
+            holdTile<3>(tm, t, phi, temp, fb, params, strides);
+        } else {
+            holdTile<2>(tm, t, phi, temp, fb, params, strides);
+        }
+    }
+
+    #pragma omp single
+    {
+        double updates = 0.0;
+        for (int L = 0; L < lts->levels; ++L) {
+            if (n % (1 << L) == 0) updates += lts->levelCells[L];
+            lts->interval_tiles[L] += lts->levelTiles[L];
+        }
+        lts->interval_updates += updates;
+        lts->total_updates += updates;
+        lts->interval_steps++;
+        lts->total_steps++;
+    }
+}
+
+/**
+ * @brief Start timing an output interval; called serially (omp single).
+ */
+void startLtsInterval(LocalTimeStep *lts) {
+    lts->interval_start = wallSeconds();
+}
+
+/**
+ * @brief Cell updates saved, tiles per level and throughput of the output
+ * interval ending at step; called serially (omp single).
+ *
+ * The throughput counts every interior cell, as the time-loop report does,
+ * so it compares directly with a run without local time stepping.
+ */
+void reportLtsInterval(LocalTimeStep *lts, const SimParams *params, int step) {
+    const double interior = interiorCells(params);
+    const double seconds = wallSeconds() - lts->interval_start;
+    const int steps = lts->interval_steps;
+    const double full = (steps > 0) ? interior * steps : 1.0;
+    double tiles = 0.0;
+    for (int L = 0; L < lts->levels; ++L) tiles += lts->interval_tiles[L];
+    std::printf("Local time stepping, steps %d-%d: %.2f%% of the cell updates saved, %.3f s, %.2f Mcell-updates/s\n",
+                step - steps + 1, step, 100.0 * (1.0 - lts->interval_updates / full), seconds,
+                cellRate(interior, steps, seconds));
+    std::printf("  tiles stepping by");
+    for (int L = 0; L < lts->levels; ++L) {
+        std::printf(" %d dt: %.1f%%%s", 1 << L, (tiles > 0.0) ? 100.0 * lts->interval_tiles[L] / tiles : 0.0,
+                    (L + 1 < lts->levels) ? "," : "\n");
+    }
+    lts->interval_updates = 0.0;
+    lts->interval_steps = 0;
+    for (int L = 0; L < LTS_MAX_LEVELS; ++L) lts->interval_tiles[L] = 0.0;
+}
+
+/**
+ * @brief Cell updates saved over the run; prints nothing unless LTS.
+ */
+void printLtsReport(const LocalTimeStep *lts, const SimParams *params, const TileMap *tm) {
+    if (!params->LTS || lts->total_steps == 0) return;
+    const double interior = interiorCells(params);
+    std::printf("Local time stepping: %.2f%% of the cell updates saved over %ld steps (%.4g of %.4g), %d tiles of %d^%d cells\n",
+                100.0 * (1.0 - lts->total_updates / (interior * lts->total_steps)), lts->total_steps,
+                lts->total_updates, interior * lts->total_steps, tm->count, tm->size, params->DIM);
+}
+
+/**
+ * @brief Release the levels and registers.
+ */
+void freeLocalTimeStep(LocalTimeStep *lts) {
+    std::free(lts->level);
+    std::free(lts->raw);
+    std::free(lts->cells);
+    std::free(lts->reg);
+    std::memset(lts, 0, sizeof(*lts));
+}
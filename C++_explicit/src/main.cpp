@@ -2,31 +2,80 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <chrono>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /*
  * main.cpp
  *
  * Entry point for the simulation application. Performs the following:
  *  - Parses command-line arguments for an input configuration file
+ *  - Starts MPI when built with MPI=1 (initDecomposition)
  *  - Reads simulation parameters from the input file
- *  - Manages output directory creation and optional cleanup
- *  - Initializes simulation variables and field buffers
+ *  - Selects the DIM/j/boundary-specialized kernels once (selectKernels)
+ *  - Manages output directory creation and optional cleanup (rank 0)
+ *  - Sets up the moving window (MOVING_WINDOW), whose offset the output carries
+ *  - Across several ranks, splits the grid into x-slabs and continues on
+ *    the rank-local slab (decomposeDomain)
+ *  - Sets the OpenMP team size (NUM_THREADS or OMP_NUM_THREADS)
+ *  - Builds the tiles of the temporal blocking when it is enabled
+ *  - Allocates the narrow band of the phi kernels (NARROW_BAND), the
+ *    tile activity map (TILE_SKIP, and the tiles of LTS), the tile levels
+ *    (LTS) and the refined patches (AMR)
+ *  - Initializes simulation variables (two generations each) and field buffers
+ *    in one aligned arena, and reports the memory used
+ *  - Opens one parallel region for the rest of the run; the kernels share
+ *    their loops across it and I/O runs in `omp single` blocks
+ *  - Zeroes the arena in parallel (NUMA first touch) and optionally reports
+ *    the page placement (NUMA_REPORT)
  *  - Handles respawn logic: loading previous phi and temperature fields
  *  - Executes the main time-stepping loop:
- *      a) Applies boundary conditions
+ *      a) Applies boundary conditions to phi and temp in one pass
+ *         (across ranks: exchanges the halo columns, overlapped with the
+ *         update of the columns that do not need them)
  *      b) Computes free energy derivatives
  *      c) Computes gradients and anisotropy
  *      d) Updates phase-field and temperature fields
- *      e) Periodically writes output in VTK or CSV formats
+ *         (b-d run as a single sweep when FUSED_KERNEL is set; with
+ *         BLOCK_STEPS > 1, a-d run several steps at a time per cache tile;
+ *         with SPECTRAL, the temperature update is the Fourier-space step
+ *         of both fields; with PHI_SOLVER = IMEX, the phi step is replaced
+ *         by the stabilized semi-implicit step before the temperature update;
+ *         with NARROW_BAND, the phi kernels visit the cells near the
+ *         interface only, and the band follows it after every step;
+ *         with TILE_SKIP, the kernels skip the quiescent tiles, which are
+ *         chosen anew after every step; with AMR, the fine patches near the
+ *         interface follow the coarse step in substeps, are averaged onto
+ *         it and are placed anew; with LTS, each tile steps by its own
+ *         power-of-two multiple of dt, with the levels chosen anew every
+ *         cycle and the heat across level changes kept conservative)
+ *      e) Swaps the field generations: the new fields become the current ones
+ *         (with MOVING_WINDOW, then shifts them along x once the front has
+ *         reached the trigger column)
+ *      f) Periodically writes output in VTK or CSV formats, gathered on rank 0
+ *         (with NARROW_BAND, TILE_SKIP or LTS, after a report of the band,
+ *         the skipped tiles or the cell updates saved over the interval; with AMR, after a report of
+ *         the refined blocks, and followed by the fields resampled on the
+ *         fine grid; with MOVING_WINDOW, followed by the offset of the window)
+ *      (with ADAPTIVE_DT, dt is chosen after every step and the loop runs
+ *      to end_time with output every output_time of physical time)
+ *  - Reports the time-loop wall time and throughput
  *  - Cleans up allocated memory on exit
  */
 
 int main(int argc, char* argv[]) {
+    // Ranks of the run; a single one without MPI
+    Decomposition dec;
+    initDecomposition(&argc, &argv, &dec);
+
     // Validate command-line arguments
     if (argc < 2) {
         std::fprintf(stderr, "Usage: %s <input_file>\n", argv[0]);
+        finalizeDecomposition(&dec);
         return EXIT_FAILURE;
     }
 
@@ -35,13 +84,20 @@ int main(int argc, char* argv[]) {
     params.numVariables = 0;
     if (readParameters(argv[1], &params) != 0) {
         // Exit if parameter reading fails
+        finalizeDecomposition(&dec);
         return EXIT_FAILURE;
     }
 
+    // Choose the specialized kernel instantiations for this run
+    KernelTable kt;
+    selectKernels(&params, &kt);
+
     const char* folder = "output";
 
-    // Handle output directory creation or cleanup
-    if (!params.RESPAWN) {
+    // Handle output directory creation or cleanup; only rank 0 writes files.
+    // Rank 0 decides whether to go on and every rank exits with its code.
+    int exit_code = -1;  // -1: go on, otherwise the exit code
+    if (!params.RESPAWN && dec.rank == 0) {
         // Check if folder exists
         if (access(folder, F_OK) != -1) {
             char response[4];
@@ -49,146 +105,344 @@ int main(int argc, char* argv[]) {
             int matches = std::scanf("%3s", response);
             if (matches != 1) {
                 std::fprintf(stderr, "Input failed or EOF\n");
-                // handle error or exit:
-                return 1;
-            }
-
-            if (std::strcmp(response, "yes") == 0) {
+                exit_code = EXIT_FAILURE;
+            } else if (std::strcmp(response, "yes") == 0) {
                 // Remove existing directory
                 char command[256];
                 std::snprintf(command, sizeof(command), "rm -rf %s", folder);
                 if (std::system(command) != 0) {
                     std::perror("Failed to delete folder");
-                    std::exit(EXIT_FAILURE);
+                    exit_code = EXIT_FAILURE;
                 }
             } else {
                 std::printf("Folder not deleted. Exiting.\n");
-                std::exit(EXIT_SUCCESS);
+                exit_code = EXIT_SUCCESS;
             }
         }
         // Create the output folder
-        if (mkdir(folder, 0777) == -1) {
-            std::perror("Error creating folder");
-            std::exit(EXIT_FAILURE);
+        if (exit_code < 0) {
+            if (mkdir(folder, 0777) == -1) {
+                std::perror("Error creating folder");
+                exit_code = EXIT_FAILURE;
+            } else {
+                std::printf("Folder '%s' created successfully.\n", folder);
+            }
         }
-        std::printf("Folder '%s' created successfully.\n", folder);
+    }
+    exit_code = shareFromRank0(&dec, exit_code);
+    if (exit_code >= 0) {
+        finalizeDecomposition(&dec);
+        return exit_code;
     }
 
     // Save updated parameters
-    writeParameters("output/outfile.in", &params);
+    if (dec.rank == 0) {
+        writeParameters("output/outfile.in", &params);
+    }
+
+    // Window following the front (MOVING_WINDOW = 1); published through
+    // params.window before the global parameters are taken for the output
+    MovingWindow mw;
+    if (setupMovingWindow(&params, &mw) != 0) {
+        finalizeDecomposition(&dec);
+        return EXIT_FAILURE;
+    }
+
+    // From here on params describes this rank's slab; dec.global the whole grid
+    if (decomposeDomain(&params, &dec) != 0) {
+        finalizeDecomposition(&dec);
+        return EXIT_FAILURE;
+    }
+
+    // Clock and first dt of the adaptive time stepping (ADAPTIVE_DT)
+    TimeControl tc;
+    setupTimeControl(&params, &tc);
+    if (tc.adaptive && dec.rank == 0) {
+        std::printf("Adaptive dt: stability limit %g (safety %g), first step %g, end time %g, output every %g\n",
+                    stableTimestep(&params), params.DT_SAFETY, params.dt, tc.end_time, tc.output_time);
+    }
 
     // Precompute inverse grid spacing and squared spacing
-    double r[MAX_DIM] = { 1.0 / params.dx, 1.0 / params.dy, 1.0 / params.dz };
-    double r2[MAX_DIM] = { 1.0/(params.dx*params.dx), 1.0/(params.dy*params.dy), 1.0/(params.dz*params.dz) };
-    int strides[MAX_DIM] = { params.Num_Y * params.Num_Z, params.Num_Z, 1 };
+    Accum r[MAX_DIM] = { Accum(1.0 / params.dx), Accum(1.0 / params.dy), Accum(1.0 / params.dz) };
+    Accum r2[MAX_DIM] = { Accum(1.0/(params.dx*params.dx)), Accum(1.0/(params.dy*params.dy)), Accum(1.0/(params.dz*params.dz)) };
+    // Strides with the row pitch padded for alignment (memory_allocation.cpp)
+    int strides[MAX_DIM];
+    fieldStrides(&params, strides);
+    setupDecompositionBuffers(&dec, strides);
+
+    // Thread team size: NUM_THREADS from the input file, else the OpenMP default
+#ifdef _OPENMP
+    if (params.NUM_THREADS > 0) {
+        omp_set_num_threads(params.NUM_THREADS);
+    }
+    params.NUM_THREADS = omp_get_max_threads();
+#else
+    params.NUM_THREADS = 1;
+#endif
+
+    // One arena for both generations of every variable and the field buffers
+    FieldArena arena;
+    createArena(&arena, 2 * params.numVariables + fieldBufferCount(&params),
+                fieldArrayBytes(&params, strides));
 
     // Allocate and register variable arrays
-    setupVariables(&params);
+    setupVariables(&params, &arena);
 
     // Retrieve primary field arrays
-    double* phi = getDataArray("phi");
+    Real* phi = getDataArray("phi");
     if (!phi) {
         std::fprintf(stderr, "Error: No data array for 'phi'.\n");
+        finalizeDecomposition(&dec);
         return EXIT_FAILURE;
     }
-    double* temp = getDataArray("temp");
+    Real* temp = getDataArray("temp");
     if (!temp) {
         std::fprintf(stderr, "Error: No data array for 'temp'.\n");
+        finalizeDecomposition(&dec);
         return EXIT_FAILURE;
     }
 
+    // Tiles and per-thread local grids for temporal blocking (BLOCK_STEPS > 1)
+    TemporalBlocking tb;
+    setupTemporalBlocking(&params, &tb);
+
+    // Cells the phi kernels visit (NARROW_BAND = 1); published through params.band
+    NarrowBand nb;
+    setupNarrowBand(&params, &nb);
+    // Tiles the kernels skip (TILE_SKIP = 1); published through params.tiles
+    TileMap tm;
+    setupTileActivity(&params, &tm);
+    // Step levels of the tiles (LTS = 1)
+    LocalTimeStep lts;
+    setupLocalTimeStep(&params, &tm, &lts);
+    // Fine patches around the interface (AMR = 1)
+    AmrLevel amr;
+    setupAmr(&params, &amr);
+
     // Allocate buffers for intermediate computations
     FieldBuffers fb;
-    allocateFieldBuffers(&params, &fb);
-
-    // Initial condition: fill or respawn fields
-    if (!params.RESPAWN) {
-        // Fill fields based on defined shapes
-        for (int i = 0; i < params.numVariables; ++i) {
-            VariableBoundary* vb = &params.variables[i];
-            double* arr = getDataArray(vb->varName);
-            switch (vb->fillType) {
-                case FILL_CUBE:    FillCube(arr, vb, &params, strides); break;
-                case FILL_SPHERE:  FillSphere(arr, vb, &params, strides); break;
-                case FILL_CONSTANT:FillConstant(arr, vb, &params, strides); break;
-                default: break;
-            }
-        }
-    } else {
-        // Respawn: read previous fields from VTK or CSV
-        char filename[256];
-        if (params.WRITE_TO_VTK) {
-            std::fprintf(stderr, "Reading phi from output/phi.%d.vtk\n", params.restart_time);
-            std::snprintf(filename, sizeof(filename), "output/phi_%d.vtk", params.restart_time);
-            read_input_vtk(filename, phi, &params, strides);
-            std::fprintf(stderr, "Reading temp from output/temp.%d.vtk\n", params.restart_time);
-            std::snprintf(filename, sizeof(filename), "output/temp_%d.vtk", params.restart_time);
-            read_input_vtk(filename, temp, &params, strides);
-        } else if (params.WRITE_TO_CSV) {
-            std::fprintf(stderr, "Reading phi from output/phi.%d.csv\n", params.restart_time);
-            std::snprintf(filename, sizeof(filename), "output/phi_%d.csv", params.restart_time);
-            read_input_csv(filename, phi, &params, strides);
-            std::fprintf(stderr, "Reading temp from output/temp.%d.csv\n", params.restart_time);
-            std::snprintf(filename, sizeof(filename), "output/temp_%d.csv", params.restart_time);
-            read_input_csv(filename, temp, &params, strides);
-        }
+    allocateFieldBuffers(&params, &fb, &arena);
+    if (dec.rank == 0) {
+        printMemoryReport(&params, strides, &arena, &tb);
     }
+    // The updates write into the next generation of phi and temp
+    fb.phi_new  = getNextDataArray("phi");
+    fb.temp_new = getNextDataArray("temp");
+
+    // Number of interior cells updated per step, for the throughput report
+    const double cells = (double)(dec.global.Num_X - 2) * (params.Num_Y - 2)
+                       * ((params.DIM == 3) ? params.Num_Z - 2 : 1);
+    std::chrono::steady_clock::time_point loop_start, loop_end;
+    // Boundary kernels of the fields refilled at the start of each step
+    const BoundaryKernel boundaries[2] = { kt.phiBoundary, kt.tempBoundary };
+    // Steps are numbered from the restart time, which keeps the noise stream continuous
+    const int t0 = params.RESPAWN ? params.restart_time : 0;
 
-    // Write initial output if not respawning
-    if (!params.RESPAWN) {
-        if (params.WRITE_TO_VTK) {
-            write_output_vtk("output/phi_0.vtk", phi, &params, strides);
-            write_output_vtk("output/temp_0.vtk", temp, &params, strides);
-        } else if (params.WRITE_TO_CSV) {
-            write_output_csv("output/phi_0.csv", phi, &params, strides);
-            write_output_csv("output/temp_0.csv", temp, &params, strides);
+    // One thread team for the whole run: the kernels below share their loops
+    // across it (orphaned omp for) and everything serial runs in omp single.
+    #pragma omp parallel
+    {
+        // Zero the fields and buffers with the kernels' row split, so that
+        // each thread's rows are first touched (and placed) by that thread
+        firstTouchArena(&arena, &params, strides);
+        if (params.NUMA_REPORT && dec.rank == 0) {
+            #pragma omp single
+            printNumaReport(&arena);
         }
-    }
 
-    // Main simulation loop over timesteps
-    for (int t = 1; t <= params.total_timesteps; ++t) {
-        // a) Apply boundary conditions to phi
-        if (auto vb_phi = findVariableBoundary("phi", &params)) {
-            applyBoundaryConditions(getDataArray("phi"), &params, strides, vb_phi->bc);
+        // Initial condition: fill or respawn fields
+        if (!params.RESPAWN) {
+            // Fill fields based on defined shapes
+            for (int i = 0; i < params.numVariables; ++i) {
+                VariableBoundary* vb = &params.variables[i];
+                Real* arr = getDataArray(vb->varName);
+                switch (vb->fillType) {
+                    case FILL_CUBE:    FillCube(arr, vb, &params, strides); break;
+                    case FILL_SPHERE:  FillSphere(arr, vb, &params, strides); break;
+                    case FILL_CONSTANT:FillConstant(arr, vb, &params, strides); break;
+                    default: break;
+                }
+            }
+        } else {
+            #pragma omp single
+            {
+                // Respawn: read previous fields from VTK or CSV (on rank 0)
+                char filename[256];
+                if (params.WRITE_TO_VTK) {
+                    std::fprintf(stderr, "Reading phi from output/phi.%d.vtk\n", params.restart_time);
+                    std::snprintf(filename, sizeof(filename), "output/phi_%d.vtk", params.restart_time);
+                    readGlobalField(&dec, read_input_vtk, filename, phi, strides);
+                    std::fprintf(stderr, "Reading temp from output/temp.%d.vtk\n", params.restart_time);
+                    std::snprintf(filename, sizeof(filename), "output/temp_%d.vtk", params.restart_time);
+                    readGlobalField(&dec, read_input_vtk, filename, temp, strides);
+                } else if (params.WRITE_TO_CSV) {
+                    std::fprintf(stderr, "Reading phi from output/phi.%d.csv\n", params.restart_time);
+                    std::snprintf(filename, sizeof(filename), "output/phi_%d.csv", params.restart_time);
+                    readGlobalField(&dec, read_input_csv, filename, phi, strides);
+                    std::fprintf(stderr, "Reading temp from output/temp.%d.csv\n", params.restart_time);
+                    std::snprintf(filename, sizeof(filename), "output/temp_%d.csv", params.restart_time);
+                    readGlobalField(&dec, read_input_csv, filename, temp, strides);
+                }
+            }
         }
-        // b) Compute free-energy derivative
-        computedfdphi(phi, fb.dfdphi, temp, &params, strides);
-        // c) Compute gradients and anisotropy
-        computeGradientPhi(phi, &fb, &params, r, strides);
-        computeAnisotropy(&fb, &params, strides);
-        // d) Update phi
-        updatePhi(phi, &fb, &params, r, strides);
-        // e) Apply boundary conditions to temp
-        if (auto vb_temp = findVariableBoundary("temp", &params)) {
-            applyBoundaryConditions(getDataArray("temp"), &params, strides, vb_temp->bc);
+
+        // First patches around the initial interface
+        if (params.AMR) buildAmr(phi, temp, &amr, &params, &kt, strides);
+
+        #pragma omp single
+        {
+            // Write initial output if not respawning
+            if (!params.RESPAWN) {
+                if (params.WRITE_TO_VTK) {
+                    writeGlobalField(&dec, write_output_vtk, "output/phi_0.vtk", phi, strides);
+                    writeGlobalField(&dec, write_output_vtk, "output/temp_0.vtk", temp, strides);
+                } else if (params.WRITE_TO_CSV) {
+                    writeGlobalField(&dec, write_output_csv, "output/phi_0.csv", phi, strides);
+                    writeGlobalField(&dec, write_output_csv, "output/temp_0.csv", temp, strides);
+                }
+                if (params.AMR) writeAmrFields(&amr, phi, temp, &params, strides, 0);
+                if (params.MOVING_WINDOW) recordWindowOffset(&mw, &params, 0);
+            }
+            loop_start = std::chrono::steady_clock::now();
+            if (params.TILE_SKIP) startTileInterval(&tm);
+            if (params.AMR) startAmrInterval(&amr);
+            if (params.LTS) startLtsInterval(&lts);
         }
-        // f) Update temp
-        updateTemp(temp, &fb, &params, strides, r2);
-        // g) Copy new values back to main arrays
-        copyInterior(phi, fb.phi_new, &params, strides);
-        copyInterior(temp, fb.temp_new, &params, strides);
-        // h) Periodic output
-        if (t % params.timebreak == 0) {
-            int t0 = params.RESPAWN ? params.restart_time : 0;
-            char filename[256];
-            if (params.WRITE_TO_VTK) {
-                std::snprintf(filename, sizeof(filename), "output/phi_%d.vtk", t + t0);
-                write_output_vtk(filename, phi, &params, strides);
-                std::snprintf(filename, sizeof(filename), "output/temp_%d.vtk", t + t0);
-                write_output_vtk(filename, temp, &params, strides);
-                std::printf("Step %d: VTK output complete\n", t + t0);
-            } else if (params.WRITE_TO_CSV) {
-                std::snprintf(filename, sizeof(filename), "output/phi_%d.csv", t + t0);
-                write_output_csv(filename, phi, &params, strides);
-                std::snprintf(filename, sizeof(filename), "output/temp_%d.csv", t + t0);
-                write_output_csv(filename, temp, &params, strides);
-                std::printf("Step %d: CSV output complete\n", t + t0);
+        // First narrow band around the initial interface
+        if (params.NARROW_BAND) buildNarrowBand(phi, &fb, &nb, &params, strides);
+
+        // Main simulation loop over timesteps
+        for (int t = 1; tc.adaptive ? tc.time < tc.end_time : t <= params.total_timesteps; ++t) {
+            if (tb.steps > 1) {
+                // a-e) Several steps per cache tile, ending at the next output step
+                const int nsteps = temporalBlockLength(&params, &tb, t);
+                advanceTemporalBlock(phi, temp, &fb, &tb, &params, &kt, r, r2, strides, t + t0, nsteps);
+                t += nsteps - 1;
+            } else if (params.LTS) {
+                // a-e) Every tile level due at this step, by its own dt
+                advanceLocalTimeStep(phi, temp, &fb, &lts, &tm, &params, &kt, r, r2, strides, t + t0);
+            } else if (dec.nranks > 1) {
+                // a-e) One step of this rank's slab, halo exchange included
+                advanceDecomposed(phi, temp, &fb, &dec, &params, &kt, r, r2, strides, t + t0);
+            } else {
+                // a) Refill the ghost cells of phi and temp in one pass; the
+                //    phi update reads temp but does not write it
+                Real *fields[2] = { phi, temp };
+                applyBoundaryConditions(fields, boundaries, 2, &params, strides);
+                if (params.FUSED_KERNEL) {
+                    // b-d) Free energy, gradients, anisotropy and phi update in one sweep
+                    kt.updatePhiFused(phi, temp, &fb, &params, r, strides, t + t0);
+                } else {
+                    // b) Compute free-energy derivative
+                    kt.computedfdphi(phi, fb.dfdphi, temp, &params, strides);
+                    // c) Compute gradients and anisotropy
+                    kt.computeGradientPhi(phi, &fb, &params, r, strides);
+                    kt.computeAnisotropy(&fb, &params, strides);
+                    // d) Update phi
+                    kt.updatePhi(phi, &fb, &params, r, strides, t + t0);
+                }
+                // d') Replace the explicit phi step by the IMEX step (PHI_SOLVER = IMEX)
+                if (kt.stabilizePhi) kt.stabilizePhi(phi, &fb, &params, strides);
+                // e) Update temp
+                kt.updateTemp(temp, &fb, &params, strides, r2);
+                // e') Band of the next step around the new interface (NARROW_BAND)
+                if (params.NARROW_BAND) trackNarrowBand(phi, &fb, &nb, &params, strides);
+                // e'') Tiles of the next step from the recorded activity (TILE_SKIP)
+                if (params.TILE_SKIP) trackTileActivity(phi, temp, &fb, &tm, &params, strides);
+                // e''') Fine patches over the step, averaged onto the new fields (AMR)
+                if (params.AMR) advanceAmr(phi, temp, &fb, &amr, &params, &kt, strides, t + t0);
+            }
+            // Fastest phi change of the step, which bounds the next dt
+            double rate = 0.0;
+            if (tc.adaptive && params.DT_PHI_TOL > 0.0) {
+                rate = maxAbsInterior(fb.dphi_dt, &params, strides);
+            }
+            // f) Swap generations; face ghosts are refilled at the next step
+            #pragma omp single
+            {
+                swapDataArrays();
+                phi  = getDataArray("phi");
+                temp = getDataArray("temp");
+                fb.phi_new  = getNextDataArray("phi");
+                fb.temp_new = getNextDataArray("temp");
+                if (tc.adaptive) advanceClock(&tc, &params, maxOverRanks(&dec, rate));
+            }
+            // f') Shift the window once the front has reached the trigger column (MOVING_WINDOW)
+            if (params.MOVING_WINDOW) shiftMovingWindow(phi, temp, &mw, &params, strides);
+            // g) Periodic output
+            if (tc.adaptive ? tc.output_due : t % params.timebreak == 0) {
+                #pragma omp single
+                {
+                    char filename[256];
+                    if (params.NARROW_BAND) reportNarrowBandInterval(&nb, &params, t + t0);
+                    if (params.TILE_SKIP) reportTileInterval(&tm, &params, t + t0);
+                    if (params.AMR) reportAmrInterval(&amr, &params, t + t0);
+                    if (params.LTS) reportLtsInterval(&lts, &params, t + t0);
+                    if (params.WRITE_TO_VTK) {
+                        std::snprintf(filename, sizeof(filename), "output/phi_%d.vtk", t + t0);
+                        writeGlobalField(&dec, write_output_vtk, filename, phi, strides);
+                        std::snprintf(filename, sizeof(filename), "output/temp_%d.vtk", t + t0);
+                        writeGlobalField(&dec, write_output_vtk, filename, temp, strides);
+                        if (dec.rank == 0) std::printf("Step %d: VTK output complete\n", t + t0);
+                        if (dec.rank == 0 && tc.adaptive) std::printf("  t = %g, dt %g\n", tc.time, tc.dt_free);
+                    } else if (params.WRITE_TO_CSV) {
+                        std::snprintf(filename, sizeof(filename), "output/phi_%d.csv", t + t0);
+                        writeGlobalField(&dec, write_output_csv, filename, phi, strides);
+                        std::snprintf(filename, sizeof(filename), "output/temp_%d.csv", t + t0);
+                        writeGlobalField(&dec, write_output_csv, filename, temp, strides);
+                        if (dec.rank == 0) std::printf("Step %d: CSV output complete\n", t + t0);
+                        if (dec.rank == 0 && tc.adaptive) std::printf("  t = %g, dt %g\n", tc.time, tc.dt_free);
+                    }
+                    if (params.AMR) writeAmrFields(&amr, phi, temp, &params, strides, t + t0);
+                    if (params.MOVING_WINDOW) recordWindowOffset(&mw, &params, t + t0);
+                    if (params.NARROW_BAND) startNarrowBandInterval(&nb);
+                    if (params.TILE_SKIP) startTileInterval(&tm);
+                    if (params.AMR) startAmrInterval(&amr);
+                    if (params.LTS) startLtsInterval(&lts);
+                }
             }
         }
+
+        #pragma omp single
+        loop_end = std::chrono::steady_clock::now();
+    }
+
+    // Time-loop report (includes periodic output)
+    double seconds = std::chrono::duration<double>(loop_end - loop_start).count();
+    const int steps = tc.adaptive ? tc.steps : params.total_timesteps;
+    const double rate = (seconds > 0.0) ? cells * steps / seconds * 1e-6 : 0.0;
+    if (dec.nranks > 1) {
+        if (dec.rank == 0) {
+            std::printf("Time loop: %.3f s for %d steps on %d rank(s) x %d thread(s), %.2f Mcell-updates/s\n",
+                        seconds, steps, dec.nranks, params.NUM_THREADS, rate);
+        }
+    } else {
+        std::printf("Time loop: %.3f s for %d steps on %d thread(s), %.2f Mcell-updates/s\n",
+                    seconds, steps, params.NUM_THREADS, rate);
+    }
+    if (tc.adaptive && dec.rank == 0) {
+        std::printf("Adaptive dt: t = %g after %d steps, mean dt %g\n",
+                    tc.time, tc.steps, (tc.steps > 0) ? tc.time / tc.steps : 0.0);
     }
+    printMultigridReport();
+    printNarrowBandReport(&nb, &params);
+    printTileReport(&tm, &params);
+    printAmrReport(&amr, &params);
+    printLtsReport(&lts, &params, &tm);
+    printMovingWindowReport(&mw, &params);
 
     // Cleanup allocated memory and exit
-    freeGlobalVariableArrays();
-    freeFieldBuffers(&fb);
+    clearGlobalVariables();
+    releaseArena(&arena);
+    freeTemporalBlocking(&tb);
+    freeNarrowBand(&nb);
+    freeTileActivity(&tm);
+    freeAmr(&amr);
+    freeLocalTimeStep(&lts);
+    freeMovingWindow(&mw);
+    freeAdiFactors();
+    freeMultigrid();
+    freeSpectral();
+    finalizeDecomposition(&dec);
     return EXIT_SUCCESS;
 }
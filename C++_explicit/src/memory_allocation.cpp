@@ -3,114 +3,312 @@
 #include <cstdio>
 #include <cstring>
 #include <cerrno>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 /*
  * memory_allocation.cpp
  *
- * Provides routines for dynamic allocation, deallocation, and global management
- * of simulation data arrays:
- *  - allocate_vector: allocate a flat 1D array for NX*NY*NZ elements via malloc
- *  - free_vector: free memory allocated by allocate_vector
- *  - alloc3: helper to allocate contiguous 3D data via allocate_vector
- *  - allocateFieldBuffers: allocate all intermediate FieldBuffers arrays
- *  - freeFieldBuffers: release all memory in FieldBuffers
- *  - setupVariables: allocate and register each simulation variable
- *  - addVariableData: register a variable and its data array globally
- *  - getDataArray: retrieve a data array by variable name
+ * Provides routines for allocation, deallocation, and global management
+ * of simulation data arrays. All field arrays of one grid come from a single
+ * arena: one anonymous mapping, 64-byte aligned, advised for transparent huge
+ * pages, and released in one call.
+ *  - fieldStrides: strides of the field arrays, with the row pitch padded
+ *  - fieldArrayBytes: size of one field array in the arena
+ *  - fieldBufferCount: number of FieldBuffers arrays the kernel path needs
+ *  - createArena / arenaAlloc / releaseArena: the arena itself
+ *  - allocateFieldBuffers: carve the FieldBuffers arrays needed by the selected kernel path
+ *  - printMemoryReport: field and workspace memory at startup
+ *  - firstTouchArena: zero the arena in parallel, each thread its own rows
+ *  - printNumaReport: NUMA node distribution of the field pages (NUMA_REPORT)
+ *  - setupVariables: allocate and register both generations of each simulation variable
+ *  - addVariableData: register a variable and its two data arrays globally
+ *  - getDataArray: retrieve the current generation of a variable by name
+ *  - getNextDataArray: retrieve the generation the next step writes into
+ *  - swapDataArrays: make the next generation of every variable the current one
  *  - findVariableBoundary: find boundary settings by variable name
- *  - freeGlobalVariableArrays: free all registered arrays
+ *  - clearGlobalVariables: forget the registered arrays (their storage goes with the arena)
  */
 
+// Set-aliasing period: offsets that differ by a multiple of this land in the
+// same set of a typical L1/L2 (4 KiB page, 64 sets of 64-byte lines)
+static constexpr size_t ALIAS_PERIOD = 4096;
+
+/**
+ * @brief Round a pitch in bytes up to whole cache lines, then add one line
+ * if it is a multiple of the aliasing period, so that the rows (or arrays)
+ * read together by a stencil do not compete for the same cache sets.
+ */
+static size_t padPitch(size_t bytes) {
+    bytes = (bytes + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (bytes % ALIAS_PERIOD == 0) bytes += ARENA_ALIGN;
+    return bytes;
+}
+
+/**
+ * @brief Strides of the field arrays, in elements.
+ *
+ * The contiguous row (j in 2D, k in 3D) is padded to whole cache lines and
+ * the x pitch is kept off multiples of 4 KiB. Padding cells are never read
+ * or written by the kernels; the logical layout is unchanged, so results do
+ * not depend on the padding.
+ *
+ * @param params   Simulation parameters (grid dimensions)
+ * @param strides  Output: [x pitch, y pitch, 1]
+ */
+void fieldStrides(const SimParams *params, int strides[]) {
+    const size_t e = sizeof(Real);
+    if (params->DIM == 3) {
+        strides[1] = (int)(padPitch((size_t)params->Num_Z * e) / e);
+        strides[0] = (int)(padPitch((size_t)params->Num_Y * strides[1] * e) / e);
+    } else {
+        strides[1] = 1;
+        strides[0] = (int)(padPitch((size_t)params->Num_Y * e) / e);
+    }
+    strides[2] = 1;
+}
+
 /**
- * @brief Allocate a flat vector of doubles for a 3D grid using malloc.
- * Exits on failure.
+ * @brief Bytes of one field array of Num_X x-planes in the arena, rounded so
+ * that consecutive arrays start on a cache line and off the aliasing period.
  */
-double* allocate_vector(int Num_X, int Num_Y, int Num_Z) {
-    size_t total = static_cast<size_t>(Num_X) * Num_Y * Num_Z;
-    double *arr = static_cast<double*>(std::malloc(total * sizeof(double)));
-    if (!arr) {
-        std::fprintf(stderr, "Error: Could not allocate memory for %zu elements.\n", total);
+size_t fieldArrayBytes(const SimParams *params, const int strides[]) {
+    return padPitch((size_t)params->Num_X * strides[0] * sizeof(Real));
+}
+
+/**
+ * @brief Number of FieldBuffers arrays allocateFieldBuffers takes from the arena.
+ */
+int fieldBufferCount(const SimParams *params) {
+    const int adi = (params->TEMP_SOLVER == TEMP_ADI || params->SPECTRAL) ? 1 : 0;
+    return ((params->FUSED_KERNEL || params->BLOCK_STEPS > 1) ? 1 : 22) + adi;
+}
+
+/**
+ * @brief Map an arena for `arrays` arrays of arrayBytes each.
+ *
+ * The mapping is page aligned, hence 64-byte aligned, and regions of at
+ * least one huge page are rounded up to whole huge pages and advised with
+ * MADV_HUGEPAGE. Pages are untouched until first written. Exits on failure.
+ */
+void createArena(FieldArena *arena, int arrays, size_t arrayBytes) {
+    std::memset(arena, 0, sizeof(*arena));
+    size_t bytes = (size_t)arrays * arrayBytes;
+    if (bytes == 0) return;
+    if (bytes >= ARENA_HUGE_PAGE) {
+        bytes = (bytes + ARENA_HUGE_PAGE - 1) / ARENA_HUGE_PAGE * ARENA_HUGE_PAGE;
+    }
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        std::fprintf(stderr, "Error: Could not map %zu bytes for the field arrays: %s\n",
+                     bytes, std::strerror(errno));
         std::exit(EXIT_FAILURE);
     }
+#ifdef MADV_HUGEPAGE
+    if (bytes >= ARENA_HUGE_PAGE && madvise(p, bytes, MADV_HUGEPAGE) == 0) {
+        arena->hugePages = 1;
+    }
+#endif
+    arena->base = static_cast<char*>(p);
+    arena->capacity = bytes;
+    arena->arrayBytes = arrayBytes;
+}
+
+/**
+ * @brief Take the next field array from the arena. Exits when it is full.
+ */
+Real* arenaAlloc(FieldArena *arena) {
+    if (arena->used + arena->arrayBytes > arena->capacity) {
+        std::fprintf(stderr, "Error: Field arena exhausted (%zu of %zu bytes used).\n",
+                     arena->used, arena->capacity);
+        std::exit(EXIT_FAILURE);
+    }
+    Real *arr = reinterpret_cast<Real*>(arena->base + arena->used);
+    arena->used += arena->arrayBytes;
     return arr;
 }
 
 /**
- * @brief Free a vector allocated by allocate_vector.
- */
-void free_vector(double *arr) {
-    std::free(arr);
-}
-
-/**
- * @brief Helper to allocate a contiguous 3D block of data.
- */
-double* alloc3(int NX, int NY, int NZ) {
-    double* ptr = allocate_vector(NX, NY, NZ);
-    return ptr;
-}
-
-/**
- * @brief Allocate all intermediate buffers in a FieldBuffers struct.
- */
-void allocateFieldBuffers(const SimParams *params, FieldBuffers *fb) {
-    int NX = params->Num_X;
-    int NY = params->Num_Y;
-    int NZ = params->Num_Z;
-    fb->phi_new      = alloc3(NX, NY, NZ);
-    fb->temp_new     = alloc3(NX, NY, NZ);
-    fb->dphi_dt      = alloc3(NX, NY, NZ);
-    fb->dfdphi       = alloc3(NX, NY, NZ);
-    fb->ac           = alloc3(NX, NY, NZ);
-    fb->ac_right     = alloc3(NX, NY, NZ);
-    fb->ac_left      = alloc3(NX, NY, NZ);
-    fb->ac_top       = alloc3(NX, NY, NZ);
-    fb->ac_bottom    = alloc3(NX, NY, NZ);
-    fb->ac_p         = alloc3(NX, NY, NZ);
-    fb->ac_p_right   = alloc3(NX, NY, NZ);
-    fb->ac_p_left    = alloc3(NX, NY, NZ);
-    fb->ac_p_top     = alloc3(NX, NY, NZ);
-    fb->ac_p_bottom  = alloc3(NX, NY, NZ);
-    fb->DERX_c       = alloc3(NX, NY, NZ);
-    fb->DERY_c       = alloc3(NX, NY, NZ);
-    fb->DERX_right   = alloc3(NX, NY, NZ);
-    fb->DERX_left    = alloc3(NX, NY, NZ);
-    fb->DERY_top     = alloc3(NX, NY, NZ);
-    fb->DERY_bottom  = alloc3(NX, NY, NZ);
-    fb->DERY_right   = alloc3(NX, NY, NZ);
-    fb->DERY_left    = alloc3(NX, NY, NZ);
-    fb->DERX_top     = alloc3(NX, NY, NZ);
-    fb->DERX_bottom  = alloc3(NX, NY, NZ);
-}
-
-/**
- * @brief Free all intermediate buffers in a FieldBuffers struct.
- */
-void freeFieldBuffers(FieldBuffers *fb) {
-    free_vector(fb->phi_new);
-    free_vector(fb->temp_new);
-    free_vector(fb->dphi_dt);
-    free_vector(fb->dfdphi);
-    free_vector(fb->ac);
-    free_vector(fb->ac_right);
-    free_vector(fb->ac_left);
-    free_vector(fb->ac_top);
-    free_vector(fb->ac_bottom);
-    free_vector(fb->ac_p);
-    free_vector(fb->ac_p_right);
-    free_vector(fb->ac_p_left);
-    free_vector(fb->ac_p_top);
-    free_vector(fb->ac_p_bottom);
-    free_vector(fb->DERX_c);
-    free_vector(fb->DERY_c);
-    free_vector(fb->DERX_right);
-    free_vector(fb->DERX_left);
-    free_vector(fb->DERY_top);
-    free_vector(fb->DERY_bottom);
-    free_vector(fb->DERY_right);
-    free_vector(fb->DERY_left);
-    free_vector(fb->DERX_top);
-    free_vector(fb->DERX_bottom);
+ * @brief Unmap the arena; every array taken from it becomes invalid.
+ */
+void releaseArena(FieldArena *arena) {
+    if (arena->base) {
+        munmap(arena->base, arena->capacity);
+    }
+    std::memset(arena, 0, sizeof(*arena));
+}
+
+/**
+ * @brief Take the intermediate buffers of a FieldBuffers struct from an arena.
+ *
+ * The split kernel path needs every gradient and anisotropy array, whereas
+ * the fused path (FUSED_KERNEL = 1) keeps those values in registers and only
+ * needs dphi_dt. With temporal blocking the intermediates live in the
+ * per-thread tile workspaces instead, so the global buffers are the same as
+ * for the fused path. Unused pointers are set to nullptr. The arena must
+ * have room for fieldBufferCount(params) arrays. The ADI temperature solver
+ * (TEMP_SOLVER = ADI) and the spectral mode (SPECTRAL = 1) add temp_star on
+ * every path.
+ *
+ * phi_new and temp_new are not allocated here: they point at the next
+ * generation of the registered variables (getNextDataArray) and are set by
+ * the caller.
+ */
+void allocateFieldBuffers(const SimParams *params, FieldBuffers *fb, FieldArena *arena) {
+    std::memset(fb, 0, sizeof(*fb));
+    fb->dphi_dt      = arenaAlloc(arena);
+    if (params->TEMP_SOLVER == TEMP_ADI || params->SPECTRAL) {
+        fb->temp_star = arenaAlloc(arena);
+    }
+    if (params->FUSED_KERNEL || params->BLOCK_STEPS > 1) {
+        return;
+    }
+    fb->dfdphi       = arenaAlloc(arena);
+    fb->ac           = arenaAlloc(arena);
+    fb->ac_right     = arenaAlloc(arena);
+    fb->ac_left      = arenaAlloc(arena);
+    fb->ac_top       = arenaAlloc(arena);
+    fb->ac_bottom    = arenaAlloc(arena);
+    fb->ac_p         = arenaAlloc(arena);
+    fb->ac_p_right   = arenaAlloc(arena);
+    fb->ac_p_left    = arenaAlloc(arena);
+    fb->ac_p_top     = arenaAlloc(arena);
+    fb->ac_p_bottom  = arenaAlloc(arena);
+    fb->DERX_c       = arenaAlloc(arena);
+    fb->DERY_c       = arenaAlloc(arena);
+    fb->DERX_right   = arenaAlloc(arena);
+    fb->DERX_left    = arenaAlloc(arena);
+    fb->DERY_top     = arenaAlloc(arena);
+    fb->DERY_bottom  = arenaAlloc(arena);
+    fb->DERY_right   = arenaAlloc(arena);
+    fb->DERY_left    = arenaAlloc(arena);
+    fb->DERX_top     = arenaAlloc(arena);
+    fb->DERX_bottom  = arenaAlloc(arena);
+}
+
+/**
+ * @brief Print the memory held by the field arena and the tile workspaces.
+ */
+void printMemoryReport(const SimParams *params, const int strides[], const FieldArena *arena,
+                       const TemporalBlocking *tb) {
+    const double MiB = 1.0 / (1 << 20);
+    const int logical = (params->DIM == 3) ? params->Num_Z : params->Num_Y;
+    const int pitch = (params->DIM == 3) ? strides[1] : strides[0];
+    std::printf("Memory: %zu field arrays of %.2f MiB (row pitch %d for %d cells), "
+                "%.1f MiB arena, huge pages %s\n",
+                arena->used / arena->arrayBytes, arena->arrayBytes * MiB, pitch, logical,
+                arena->capacity * MiB, arena->hugePages ? "advised" : "not advised");
+    if (tb->nworkspaces > 0) {
+        size_t ws = 0;
+        for (int w = 0; w < tb->nworkspaces; ++w) ws += tb->ws[w].arena.capacity;
+        std::printf("Memory: %d tile workspace(s), %.1f MiB; total %.1f MiB\n",
+                    tb->nworkspaces, ws * MiB, (arena->capacity + ws) * MiB);
+    }
+}
+
+/**
+ * @brief Zero every array of the arena, each thread its own x-planes.
+ *
+ * Linux places a page on the NUMA node of the thread that first writes it.
+ * The planes are shared out like the `omp for` over i = 1..NX-2 of the
+ * kernels and Fill* routines, so each thread's rows land on its own node;
+ * the ghost planes go with the first and last interior plane, and the
+ * padding at the end of an array with the last. Orphaned omp for: call in
+ * the parallel region before any field is written.
+ */
+void firstTouchArena(const FieldArena *arena, const SimParams *params, const int strides[]) {
+    const int NX = params->Num_X;
+    const int arrays = (arena->arrayBytes > 0) ? (int)(arena->used / arena->arrayBytes) : 0;
+    const size_t plane = (size_t)strides[0] * sizeof(Real);
+
+    #pragma omp for
+    for (int i = 1; i < NX - 1; ++i) {
+        const size_t begin = (i == 1) ? 0 : i * plane;
+        const size_t end = (i == NX - 2) ? arena->arrayBytes : (i + 1) * plane;
+        for (int a = 0; a < arrays; ++a) {
+            std::memset(arena->base + a * arena->arrayBytes + begin, 0, end - begin);
+        }
+    }
+}
+
+// Largest node number counted by printNumaReport
+static constexpr int NUMA_MAX_NODES = 64;
+
+/**
+ * @brief Count the pages of [p, p + bytes) per NUMA node with move_pages
+ * (query mode: no page is moved). counts[NUMA_MAX_NODES] collects pages not
+ * yet touched or on a node beyond the table.
+ *
+ * @return 0, or -1 when the kernel does not provide move_pages.
+ */
+static int countPageNodes(const char *p, size_t bytes, long counts[]) {
+#ifdef SYS_move_pages
+    const long page = sysconf(_SC_PAGESIZE);
+    const size_t npages = (bytes + page - 1) / page;
+    enum { BATCH = 1024 };
+    void *pages[BATCH];
+    int status[BATCH];
+    for (size_t first = 0; first < npages; first += BATCH) {
+        const int n = (int)((npages - first < BATCH) ? npages - first : BATCH);
+        for (int k = 0; k < n; ++k) {
+            pages[k] = const_cast<char*>(p) + (first + k) * page;
+        }
+        if (syscall(SYS_move_pages, 0, (unsigned long)n, pages, nullptr, status, 0) != 0) {
+            return -1;
+        }
+        for (int k = 0; k < n; ++k) {
+            const int node = status[k];
+            ++counts[(node >= 0 && node < NUMA_MAX_NODES) ? node : NUMA_MAX_NODES];
+        }
+    }
+    return 0;
+#else
+    (void)p; (void)bytes; (void)counts;
+    return -1;
+#endif
+}
+
+/**
+ * @brief Print one line of page counts per node, skipping empty nodes.
+ */
+static void printNodeCounts(const char *label, const long counts[]) {
+    std::printf("NUMA:   %-10s", label);
+    for (int node = 0; node < NUMA_MAX_NODES; ++node) {
+        if (counts[node]) std::printf(" node%d %ld", node, counts[node]);
+    }
+    if (counts[NUMA_MAX_NODES]) std::printf(" untouched %ld", counts[NUMA_MAX_NODES]);
+    std::printf("\n");
+}
+
+/**
+ * @brief Print the memory policy of the process and, for each registered
+ * variable (both generations) and for the remaining field buffers, the
+ * number of pages on each NUMA node. Call after firstTouchArena.
+ */
+void printNumaReport(const FieldArena *arena) {
+#ifdef SYS_get_mempolicy
+    static const char *const policies[] = { "default", "preferred", "bind", "interleave", "local" };
+    int mode = -1;
+    if (syscall(SYS_get_mempolicy, &mode, nullptr, 0, nullptr, 0) == 0 && mode >= 0 && mode <= 4) {
+        std::printf("NUMA: memory policy %s, %ld-byte pages per node\n",
+                    policies[mode], sysconf(_SC_PAGESIZE));
+    }
+#endif
+    long total[NUMA_MAX_NODES + 1] = {};
+    if (countPageNodes(arena->base, arena->used, total) != 0) {
+        std::printf("NUMA: move_pages is not available, no page report\n");
+        return;
+    }
+    for (int v = 0; v < numGlobalVars; ++v) {
+        long counts[NUMA_MAX_NODES + 1] = {};
+        const size_t bytes = globalVars[v].dataSize * sizeof(Real);
+        countPageNodes(reinterpret_cast<const char*>(globalVars[v].dataArray), bytes, counts);
+        countPageNodes(reinterpret_cast<const char*>(globalVars[v].nextArray), bytes, counts);
+        printNodeCounts(globalVars[v].varName, counts);
+        for (int node = 0; node <= NUMA_MAX_NODES; ++node) total[node] -= counts[node];
+    }
+    printNodeCounts("buffers", total);
 }
 
 // Define and initialize global storage for variable data.
@@ -118,21 +316,29 @@ VariableData globalVars[MAX_VARIABLES];
 int numGlobalVars = 0;
 
 /**
- * @brief Allocate and register each variable array based on SimParams.
+ * @brief Take both generations of each variable array from the arena and
+ * register them.
+ *
+ * Arrays start zeroed (fresh arena pages, written by firstTouchArena): the
+ * ghost edge and corner cells are read by the mixed-derivative stencils but
+ * never written by the boundary kernels, so they must agree in both
+ * generations. The face ghosts of the current generation are refilled by
+ * the boundary kernels before every use.
  */
-void setupVariables(const SimParams *params) {
-    size_t totalElements = static_cast<size_t>(params->Num_X) * params->Num_Y * params->Num_Z;
+void setupVariables(const SimParams *params, FieldArena *arena) {
+    size_t totalElements = arena->arrayBytes / sizeof(Real);
     for (int i = 0; i < params->numVariables; ++i) {
         const char* name = params->variables[i].varName;
-        double* data = allocate_vector(params->Num_X, params->Num_Y, params->Num_Z);
-        addVariableData(name, data, totalElements);
+        Real* data = arenaAlloc(arena);
+        Real* next = arenaAlloc(arena);
+        addVariableData(name, data, next, totalElements);
     }
 }
 
 /**
- * @brief Register a variable and its data array.
+ * @brief Register a variable with its current and next data arrays.
  */
-void addVariableData(const char* varName, double *array, size_t dataSize) {
+void addVariableData(const char* varName, Real *array, Real *next, size_t dataSize) {
     if (numGlobalVars >= MAX_VARIABLES) {
         std::fprintf(stderr, "Error: Exceeded maximum number of variables (%d).\n", MAX_VARIABLES);
         return;
@@ -140,14 +346,15 @@ void addVariableData(const char* varName, double *array, size_t dataSize) {
     std::strncpy(globalVars[numGlobalVars].varName, varName, MAX_VAR_NAME - 1);
     globalVars[numGlobalVars].varName[MAX_VAR_NAME - 1] = '\0';
     globalVars[numGlobalVars].dataArray = array;
+    globalVars[numGlobalVars].nextArray = next;
     globalVars[numGlobalVars].dataSize = dataSize;
     ++numGlobalVars;
 }
 
 /**
- * @brief Retrieve the data array pointer for a given variable name.
+ * @brief Retrieve the current generation of a variable by name.
  */
-double* getDataArray(const char* varName) {
+Real* getDataArray(const char* varName) {
     for (int i = 0; i < numGlobalVars; ++i) {
         if (std::strcmp(globalVars[i].varName, varName) == 0) {
             return globalVars[i].dataArray;
@@ -157,6 +364,31 @@ double* getDataArray(const char* varName) {
     return nullptr;
 }
 
+/**
+ * @brief Retrieve the generation a variable's next step writes into.
+ */
+Real* getNextDataArray(const char* varName) {
+    for (int i = 0; i < numGlobalVars; ++i) {
+        if (std::strcmp(globalVars[i].varName, varName) == 0) {
+            return globalVars[i].nextArray;
+        }
+    }
+    std::fprintf(stderr, "Warning: Variable '%s' not found.\n", varName);
+    return nullptr;
+}
+
+/**
+ * @brief End of a step: the next generation of every variable becomes the
+ * current one and the old current generation is written by the next step.
+ */
+void swapDataArrays(void) {
+    for (int i = 0; i < numGlobalVars; ++i) {
+        Real *tmp = globalVars[i].dataArray;
+        globalVars[i].dataArray = globalVars[i].nextArray;
+        globalVars[i].nextArray = tmp;
+    }
+}
+
 /**
  * @brief Find the VariableBoundary for a given variable name in SimParams.
  */
@@ -170,12 +402,13 @@ VariableBoundary* findVariableBoundary(const char *name, SimParams *params) {
 }
 
 /**
- * @brief Free all globally registered variable arrays.
+ * @brief Unregister all variables. Their arrays belong to the field arena and
+ * are released with it.
  */
-void freeGlobalVariableArrays(void) {
+void clearGlobalVariables(void) {
     for (int i = 0; i < numGlobalVars; ++i) {
-        std::free(globalVars[i].dataArray);
         globalVars[i].dataArray = nullptr;
+        globalVars[i].nextArray = nullptr;
     }
     numGlobalVars = 0;
 }
@@ -0,0 +1,201 @@
+#include "header.hpp"
+#include "interval_timer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+/*
+ * moving_window.cpp
+ *
+ * Moving window (MOVING_WINDOW = 1) for a front growing along +x. Behind
+ * the front the crystal has solidified, ahead of it the melt is nearly
+ * uniform, so the grid only needs to cover a window around the front.
+ * Once phi > 1/2 reaches the trigger column, the interior x-planes move
+ * toward -x until the leading edge of the front sits just before the
+ * trigger again: with i the slowest index, a plane is one contiguous block
+ * of strides[0] values, so the shift is one memmove per field. The planes
+ * leaving at -x are dropped, and the planes exposed at +x take the
+ * far-field values, the Fill_Constant value of the field (0 without one).
+ * The offset of the window, in planes, maps the local columns to global
+ * ones through params->global_x, which keeps the noise attached to the
+ * material; output writes it as the VTK origin and the CSV x index, and
+ * output/window.csv records it for every output step, where a respawn
+ * finds it again.
+ *  - setupMovingWindow: trigger column, far field and offset; publishes the
+ *    window through params->window and params->global_x
+ *  - shiftMovingWindow: shift after a step once the front reached the trigger
+ *  - recordWindowOffset: offset of an output step, printed and logged
+ *  - printMovingWindowReport: shifts over the whole run
+ *  - freeMovingWindow: release the window
+ */
+
+/**
+ * @brief Far-field value of a field: its Fill_Constant value, else 0.
+ */
+static Real farFieldValue(const char *name, const SimParams *params) {
+    for (int v = 0; v < params->numVariables; ++v) {
+        const VariableBoundary &vb = params->variables[v];
+        if (vb.fillType == FILL_CONSTANT && std::strcmp(vb.varName, name) == 0) {
+            return (Real)vb.fillValue;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Whether any interior cell of x-plane i holds phi > 1/2.
+ */
+static bool solidPlane(const Real *phi, int i, const SimParams *params, const int strides[]) {
+    const int sy = (params->DIM == 3) ? strides[1] : 1;
+    const int ny = params->Num_Y - 2;
+    const int nz = (params->DIM == 3) ? params->Num_Z - 2 : 1;
+    const Real *plane = phi + (size_t)i * strides[0] + sy + ((params->DIM == 3) ? 1 : 0);
+    for (int j = 0; j < ny; ++j) {
+        for (int k = 0; k < nz; ++k) {
+            if (plane[j * sy + k] > 0.5) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Offset of the window at step, from output/window.csv (respawn).
+ *
+ * @return The offset of the last line for step, or -1 if there is none
+ */
+static long readWindowOffset(int step) {
+    FILE *fp = std::fopen("output/window.csv", "r");
+    if (!fp) return -1;
+    char line[256];
+    long offset = -1;
+    while (std::fgets(line, sizeof(line), fp)) {
+        int s;
+        long o;
+        if (std::sscanf(line, "%d,%ld", &s, &o) == 2 && s == step) offset = o;
+    }
+    std::fclose(fp);
+    return offset;
+}
+
+/**
+ * @brief Set up the window and set params->window (null unless MOVING_WINDOW).
+ *
+ * Called before decomposeDomain, so that the global parameters used by the
+ * writers see the window too. On a respawn the offset of restart_time is
+ * read back from output/window.csv.
+ *
+ * @return 0 on success, 1 if a respawn finds no offset for restart_time
+ */
+int setupMovingWindow(SimParams *params, MovingWindow *mw) {
+    std::memset(mw, 0, sizeof(*mw));
+    params->window = nullptr;
+    if (!params->MOVING_WINDOW) return 0;
+
+    // At least one interior plane ahead of the trigger column
+    const int nx = params->Num_X - 2;
+    mw->trigger = 1 + (int)(params->WINDOW_TRIGGER * nx);
+    if (mw->trigger > nx - 1) mw->trigger = nx - 1;
+    if (mw->trigger < 1) mw->trigger = 1;
+    mw->farPhi = farFieldValue("phi", params);
+    mw->farTemp = farFieldValue("temp", params);
+
+    if (params->RESPAWN) {
+        mw->offset = readWindowOffset(params->restart_time);
+        if (mw->offset < 0) {
+            std::fprintf(stderr, "Error: no window offset for step %d in output/window.csv.\n",
+                         params->restart_time);
+            return 1;
+        }
+    }
+    mw->columns = (int*)std::malloc(params->Num_X * sizeof(int));
+    for (int i = 0; i < params->Num_X; ++i) mw->columns[i] = (int)(i + mw->offset);
+    params->global_x = mw->columns;
+    params->window = mw;
+
+    std::printf("Moving window: shift once phi > 1/2 reaches column %d of %d, far field phi %g, temp %g, offset %ld\n",
+                mw->trigger, nx, (double)mw->farPhi, (double)mw->farTemp, mw->offset);
+    return 0;
+}
+
+/**
+ * @brief Shift the fields once the front has reached the trigger column.
+ *
+ * Called by every thread of the team after the generations are swapped,
+ * with phi and temp the current fields; the ghost cells are refilled at
+ * the start of the next step. The next generations need no shift, since
+ * every update rewrites their whole interior.
+ *
+ * @return The planes shifted (0 if the front is still behind the trigger)
+ */
+int shiftMovingWindow(Real *phi, Real *temp, MovingWindow *mw, const SimParams *params, int strides[]) {
+    #pragma omp single
+    {
+        mw->shift = 0;
+        const int sx = strides[0];
+
+        // Leading solid plane; the usual step ends after checking the
+        // trigger column alone
+        int front = 0;
+        if (solidPlane(phi, mw->trigger, params, strides)) {
+            front = mw->trigger;
+            for (int i = params->Num_X - 2; i > mw->trigger; --i) {
+                if (solidPlane(phi, i, params, strides)) { front = i; break; }
+            }
+        }
+
+        if (front) {
+            const double start = wallSeconds();
+            const int s = front - mw->trigger + 1;
+            const int keep = params->Num_X - 2 - s;
+            Real *fields[2] = { phi, temp };
+            const Real far[2] = { mw->farPhi, mw->farTemp };
+            for (int f = 0; f < 2; ++f) {
+                std::memmove(fields[f] + sx, fields[f] + (size_t)(1 + s) * sx, (size_t)keep * sx * sizeof(Real));
+                Real *exposed = fields[f] + (size_t)(1 + keep) * sx;
+                for (size_t c = 0; c < (size_t)s * sx; ++c) exposed[c] = far[f];
+            }
+            mw->offset += s;
+            for (int i = 0; i < params->Num_X; ++i) mw->columns[i] = (int)(i + mw->offset);
+            mw->shift = s;
+            mw->shifts++;
+            mw->seconds += wallSeconds() - start;
+        }
+    }
+    return mw->shift;
+}
+
+/**
+ * @brief Print the offset of an output step and append it to
+ * output/window.csv; called serially (omp single).
+ */
+void recordWindowOffset(const MovingWindow *mw, const SimParams *params, int step) {
+    std::printf("Moving window, step %d: offset %ld column(s), x = %g\n",
+                step, mw->offset, mw->offset * params->dx);
+    const bool fresh = (access("output/window.csv", F_OK) == -1);
+    FILE *fp = std::fopen("output/window.csv", "a");
+    if (!fp) {
+        std::fprintf(stderr, "Warning: Could not open output/window.csv for writing.\n");
+        return;
+    }
+    if (fresh) std::fprintf(fp, "step,offset,x\n");
+    std::fprintf(fp, "%d,%ld,%g\n", step, mw->offset, mw->offset * params->dx);
+    std::fclose(fp);
+}
+
+/**
+ * @brief Shifts over the run; prints nothing unless MOVING_WINDOW.
+ */
+void printMovingWindowReport(const MovingWindow *mw, const SimParams *params) {
+    if (!params->MOVING_WINDOW) return;
+    std::printf("Moving window: %ld shift(s), offset %ld column(s) (x = %g), %.3f s shifting\n",
+                mw->shifts, mw->offset, mw->offset * params->dx, mw->seconds);
+}
+
+/**
+ * @brief Release the window.
+ */
+void freeMovingWindow(MovingWindow *mw) {
+    std::free(mw->columns);
+    std::memset(mw, 0, sizeof(*mw));
+}
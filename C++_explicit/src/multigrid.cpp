@@ -0,0 +1,537 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+/*
+ * multigrid.cpp
+ *
+ * Matrix-free geometric multigrid for the implicit steps, one level
+ * hierarchy per field:
+ *  - temperature (TEMP_SOLVER = MULTIGRID): the theta method for
+ *    dT/dt = lap T + K dphi/dt,
+ *
+ *      (1 - theta dt L) T' = (1 + (1 - theta) dt L) T + dt K dphi/dt
+ *
+ *    with theta = MG_THETA (1: backward Euler, 0.5: Crank-Nicolson)
+ *  - phase field (PHI_SOLVER = IMEX): the explicit rate F = dphi/dt of the
+ *    phi kernels is replaced by the linearly stabilized rate u,
+ *
+ *      (1 - dt S / tau L) u = F,   phi' = phi + dt u
+ *
+ *    i.e. an isotropic gradient term S lap phi is taken implicitly and
+ *    subtracted again explicitly, so the anisotropic flux and df/dphi stay
+ *    explicit. S is IMEX_STAB times the flux stiffness bound D of
+ *    stableTimestep (phiStiffnessBounds); for IMEX_STAB >= 1/2 the
+ *    gradient terms are stable for any dt, leaving the reaction limit.
+ *
+ * Both are solved on the strided field layout:
+ *  - levels: cell-centred coarsening, each axis with at least 4 interior
+ *    cells halved (n -> (n + 1) / 2, spacing doubled); axes that are too
+ *    short keep their size (semi-coarsening) until no axis can be halved
+ *  - smoother: red-black Gauss-Seidel, 2 sweeps before and after the
+ *    coarse-grid correction, MG_COARSE_SWEEPS on the coarsest level
+ *  - transfers: restriction averages the fine cells of each coarse cell,
+ *    prolongation interpolates linearly (weights 3/4, 1/4 per halved axis)
+ *  - boundaries: the ghosts of every level are filled by the boundary
+ *    kernels of the field (applyBoundaryConditions), so NOFLUX and PERIODIC
+ *    faces follow the explicit solver; ghosts of other faces keep their
+ *    value on the finest level (temp, or zero for the phi rate) and are
+ *    zero (no correction) on the coarse levels
+ * Cycles repeat until max |residual| <= MG_TOL max |right-hand side| or
+ * MG_MAX_CYCLES is reached. Every loop is an orphaned omp for, and the
+ * red-black ordering makes the result independent of the thread count.
+ *
+ *  - updateTempMultigridKernel: one implicit temperature step
+ *  - updatePhiIMEXKernel: stabilize the phi step just taken
+ *  - printMultigridReport: levels and V-cycles per step of the run
+ *  - freeMultigrid: release the level hierarchies
+ */
+
+#define MG_MAX_LEVELS 16
+#define MG_PRE_SWEEPS 2
+#define MG_POST_SWEEPS 2
+#define MG_COARSE_SWEEPS 16
+
+// One grid of the hierarchy; level 0 is the field grid
+struct MGLevel {
+    SimParams params;       // Num_X/Y/Z and spacings of this level
+    int   strides[MAX_DIM];
+    int   halve[MAX_DIM];   // 1: the next coarser level halves this axis
+    Accum c[MAX_DIM];       // theta dt / h^2 per axis
+    Real *u, *f, *r;        // iterate (level 0: temp_new), right-hand side, residual
+    FieldArena arena;
+};
+
+// Level hierarchy of one field
+struct MGSolver {
+    const char *var;        // field whose boundary kernels fill the ghosts
+    int     levels;
+    MGLevel level[MG_MAX_LEVELS];
+    BoundaryKernel bc;      // boundary kernels of var, for every level
+    // Statistics of the run
+    long    solves, cycles;
+    int     max_cycles;
+    int     warned;
+};
+
+static MGSolver tempMG = { "temp" };
+static MGSolver phiMG  = { "phi" };
+
+// Shared accumulator of the norms: a reduction variable of an orphaned
+// omp for must be shared in the enclosing parallel region
+static double mgMax;
+
+/**
+ * @brief Build the level hierarchy for the field grid. Runs in omp single.
+ */
+static void buildHierarchy(MGSolver *mg, const SimParams *params, const int strides[]) {
+    MGLevel *L = &mg->level[0];
+    L->params = *params;
+    L->params.global_x = nullptr;
+    L->params.band = nullptr;
+    L->params.tiles = nullptr;
+    std::memcpy(L->strides, strides, sizeof(L->strides));
+    createArena(&L->arena, 2, fieldArrayBytes(&L->params, L->strides));
+    L->f = arenaAlloc(&L->arena);
+    L->r = arenaAlloc(&L->arena);
+
+    FaceBoundary bc;
+    bc.top = bc.bottom = bc.left = bc.right = bc.front = bc.back = BOUNDARY_UNDEFINED;
+    for (int v = 0; v < params->numVariables; ++v) {
+        if (std::strcmp(params->variables[v].varName, mg->var) == 0) bc = params->variables[v].bc;
+    }
+    mg->bc = selectBoundaryKernel(params, bc);
+
+    const int dims = params->DIM;
+    mg->levels = 1;
+    while (mg->levels < MG_MAX_LEVELS) {
+        MGLevel *fine = &mg->level[mg->levels - 1];
+        int *num[MAX_DIM] = { &fine->params.Num_X, &fine->params.Num_Y, &fine->params.Num_Z };
+        int any = 0;
+        for (int d = 0; d < dims; ++d) {
+            fine->halve[d] = (*num[d] - 2 >= 4);
+            any |= fine->halve[d];
+        }
+        if (!any) break;
+
+        MGLevel *C = &mg->level[mg->levels];
+        C->params = fine->params;
+        int *cnum[MAX_DIM] = { &C->params.Num_X, &C->params.Num_Y, &C->params.Num_Z };
+        double *h[MAX_DIM] = { &C->params.dx, &C->params.dy, &C->params.dz };
+        for (int d = 0; d < dims; ++d) {
+            if (fine->halve[d]) {
+                *cnum[d] = (*num[d] - 2 + 1) / 2 + 2;
+                *h[d] *= 2.0;
+            }
+        }
+        fieldStrides(&C->params, C->strides);
+        createArena(&C->arena, 3, fieldArrayBytes(&C->params, C->strides));
+        C->u = arenaAlloc(&C->arena);
+        C->f = arenaAlloc(&C->arena);
+        C->r = arenaAlloc(&C->arena);
+        mg->levels++;
+    }
+    std::memset(mg->level[mg->levels - 1].halve, 0, sizeof(mg->level[0].halve));
+}
+
+/**
+ * @brief Red-black Gauss-Seidel sweeps on (1 - theta dt L) u = f.
+ */
+template <int DIM>
+static void smooth(const MGSolver *mg, MGLevel *L, int sweeps) {
+    const Interior<DIM> g(&L->params, L->strides);
+    const int sx = g.sx, sy = g.sy;
+    const Accum cx = L->c[0], cy = L->c[1];
+    const Accum cz = (DIM == 3) ? L->c[2] : Accum(0.0);
+    const Accum inv_diag = Accum(1.0) / (Accum(1.0) + Accum(2.0) * (cx + cy + cz));
+    Real *u = L->u;
+    const Real *f = L->f;
+
+    for (int s = 0; s < sweeps; ++s) {
+        for (int color = 0; color < 2; ++color) {
+            applyBoundaryConditions(&u, &mg->bc, 1, &L->params, L->strides);
+            #pragma omp for schedule(static)
+            for (int i = 1; i < g.NX - 1; ++i) {
+                if (DIM == 3) {
+                    for (int j = 1; j < g.NY - 1; ++j) {
+                        const int row = i * sx + j * sy;
+                        for (int k = 1 + ((i + j + 1 + color) & 1); k < g.kend; k += 2) {
+                            const int idx = row + k;
+                            u[idx] = (Accum(f[idx]) + cx * (Accum(u[idx + sx]) + Accum(u[idx - sx]))
+                                                    + cy * (Accum(u[idx + sy]) + Accum(u[idx - sy]))
+                                                    + cz * (Accum(u[idx + 1]) + Accum(u[idx - 1]))) * inv_diag;
+                        }
+                    }
+                } else {
+                    const int row = i * sx;
+                    for (int j = 1 + ((i + 1 + color) & 1); j < g.NY - 1; j += 2) {
+                        const int idx = row + j;
+                        u[idx] = (Accum(f[idx]) + cx * (Accum(u[idx + sx]) + Accum(u[idx - sx]))
+                                                + cy * (Accum(u[idx + 1]) + Accum(u[idx - 1]))) * inv_diag;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief r = f - (1 - theta dt L) u on the interior; returns max |r| to every thread.
+ */
+template <int DIM>
+static double residual(const MGSolver *mg, MGLevel *L) {
+    const Interior<DIM> g(&L->params, L->strides);
+    const int sx = g.sx, sy = g.sy;
+    const int len = g.runLength();
+    const Accum cx = L->c[0], cy = L->c[1];
+    const Accum cz = (DIM == 3) ? L->c[2] : Accum(0.0);
+    const Accum diag = Accum(1.0) + Accum(2.0) * (cx + cy + cz);
+    const Real *u = L->u;
+    const Real *f = L->f;
+    Real *r = L->r;
+
+    applyBoundaryConditions(&L->u, &mg->bc, 1, &L->params, L->strides);
+    #pragma omp single
+    mgMax = 0.0;
+
+    #pragma omp for reduction(max : mgMax)
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            for (int n = 0; n < len; ++n) {
+                const int idx = start + n;
+                Accum Au = diag * Accum(u[idx]) - cx * (Accum(u[idx + sx]) + Accum(u[idx - sx]))
+                                                - cy * (Accum(u[idx + sy]) + Accum(u[idx - sy]));
+                if (DIM == 3) Au -= cz * (Accum(u[idx + 1]) + Accum(u[idx - 1]));
+                const Accum res = Accum(f[idx]) - Au;
+                r[idx] = res;
+                const double a = std::fabs((double)res);
+                if (a > mgMax) mgMax = a;
+            }
+        }
+    }
+    return mgMax;
+}
+
+/**
+ * @brief Average the residual of F over each cell of C into C's right-hand side; zero C's iterate.
+ */
+template <int DIM>
+static void restrictResidual(const MGLevel *F, MGLevel *C) {
+    const Interior<DIM> fg(&F->params, F->strides);
+    const Interior<DIM> cg(&C->params, C->strides);
+    const int fn[MAX_DIM] = { fg.NX - 2, fg.NY - 2, fg.kend - 1 };
+
+    #pragma omp for schedule(static)
+    for (int I = 1; I < cg.NX - 1; ++I) {
+        const int i0 = F->halve[0] ? 2 * I - 1 : I;
+        const int i1 = F->halve[0] && 2 * I <= fn[0] ? 2 * I : i0;
+        for (int J = 1; J < cg.NY - 1; ++J) {
+            const int j0 = F->halve[1] ? 2 * J - 1 : J;
+            const int j1 = F->halve[1] && 2 * J <= fn[1] ? 2 * J : j0;
+            for (int K = cg.kstart; K < cg.kend; ++K) {
+                const int k0 = (DIM == 3 && F->halve[2]) ? 2 * K - 1 : K;
+                const int k1 = (DIM == 3 && F->halve[2] && 2 * K <= fn[2]) ? 2 * K : k0;
+                Accum sum = 0.0;
+                for (int i = i0; i <= i1; ++i)
+                    for (int j = j0; j <= j1; ++j)
+                        for (int k = k0; k <= k1; ++k)
+                            sum += F->r[i * fg.sx + j * fg.sy + k];
+                const int cidx = I * cg.sx + J * cg.sy + K;
+                C->f[cidx] = sum / Accum((i1 - i0 + 1) * (j1 - j0 + 1) * (k1 - k0 + 1));
+                C->u[cidx] = 0.0;
+            }
+        }
+    }
+}
+
+// Coarse cells and weights interpolated to one fine cell along one axis
+struct ProlongAxis {
+    int   a, n;     // offsets of the parent cell and of its neighbour on the fine cell's side
+    Accum wa, wn;
+};
+
+static inline ProlongAxis prolongAxis(int i, int halve, int stride) {
+    ProlongAxis p;
+    if (halve) {
+        const int A = (i + 1) / 2;
+        p.a = A * stride;
+        p.n = ((i & 1) ? A - 1 : A + 1) * stride;
+        p.wa = 0.75;
+        p.wn = 0.25;
+    } else {
+        p.a = p.n = i * stride;
+        p.wa = 1.0;
+        p.wn = 0.0;
+    }
+    return p;
+}
+
+/**
+ * @brief Add the linear interpolation of C's iterate (the correction) to F's iterate.
+ */
+template <int DIM>
+static void prolongAdd(const MGSolver *mg, MGLevel *C, MGLevel *F) {
+    const Interior<DIM> fg(&F->params, F->strides);
+    const int csx = C->strides[0];
+    const int csy = (DIM == 3) ? C->strides[1] : 1;
+    const Real *c = C->u;
+    Real *u = F->u;
+
+    applyBoundaryConditions(&C->u, &mg->bc, 1, &C->params, C->strides);
+    #pragma omp for schedule(static)
+    for (int i = 1; i < fg.NX - 1; ++i) {
+        const ProlongAxis x = prolongAxis(i, F->halve[0], csx);
+        for (int j = 1; j < fg.NY - 1; ++j) {
+            const ProlongAxis y = prolongAxis(j, F->halve[1], csy);
+            const int row = i * fg.sx + j * fg.sy;
+            if (DIM == 3) {
+                for (int k = 1; k < fg.kend; ++k) {
+                    const ProlongAxis z = prolongAxis(k, F->halve[2], 1);
+                    const Accum ya = y.wa * (z.wa * Accum(c[x.a + y.a + z.a]) + z.wn * Accum(c[x.a + y.a + z.n]))
+                                   + y.wn * (z.wa * Accum(c[x.a + y.n + z.a]) + z.wn * Accum(c[x.a + y.n + z.n]));
+                    const Accum yn = y.wa * (z.wa * Accum(c[x.n + y.a + z.a]) + z.wn * Accum(c[x.n + y.a + z.n]))
+                                   + y.wn * (z.wa * Accum(c[x.n + y.n + z.a]) + z.wn * Accum(c[x.n + y.n + z.n]));
+                    u[row + k] += x.wa * ya + x.wn * yn;
+                }
+            } else {
+                const Accum ya = y.wa * Accum(c[x.a + y.a]) + y.wn * Accum(c[x.a + y.n]);
+                const Accum yn = y.wa * Accum(c[x.n + y.a]) + y.wn * Accum(c[x.n + y.n]);
+                u[row] += x.wa * ya + x.wn * yn;
+            }
+        }
+    }
+}
+
+/**
+ * @brief One V-cycle on level l and all coarser levels.
+ */
+template <int DIM>
+static void vcycle(MGSolver *mg, int l) {
+    MGLevel *L = &mg->level[l];
+    if (l == mg->levels - 1) {
+        smooth<DIM>(mg, L, MG_COARSE_SWEEPS);
+        return;
+    }
+    smooth<DIM>(mg, L, MG_PRE_SWEEPS);
+    residual<DIM>(mg, L);
+    restrictResidual<DIM>(L, &mg->level[l + 1]);
+    vcycle<DIM>(mg, l + 1);
+    prolongAdd<DIM>(mg, &mg->level[l + 1], L);
+    smooth<DIM>(mg, L, MG_POST_SWEEPS);
+}
+
+// Release the levels of one hierarchy
+static void releaseSolver(MGSolver *mg) {
+    for (int l = 0; l < mg->levels; ++l) releaseArena(&mg->level[l].arena);
+    mg->levels = 0;
+}
+
+/**
+ * @brief Point the hierarchy at the iterate u and set the operator (1 - scale L). Runs in omp single.
+ *
+ * The hierarchy is rebuilt when the grid changes. Resets the norm
+ * accumulator for the right-hand side.
+ */
+static void prepareSolve(MGSolver *mg, const SimParams *params, const int strides[], Real *u, double scale) {
+    MGLevel *L = &mg->level[0];
+    if (mg->levels == 0 || L->params.Num_X != params->Num_X || L->params.Num_Y != params->Num_Y
+                        || L->params.Num_Z != params->Num_Z) {
+        releaseSolver(mg);
+        buildHierarchy(mg, params, strides);
+    }
+    L->u = u;
+    for (int l = 0; l < mg->levels; ++l) {
+        const SimParams *lp = &mg->level[l].params;
+        const double h[MAX_DIM] = { lp->dx, lp->dy, lp->dz };
+        for (int d = 0; d < MAX_DIM; ++d) {
+            mg->level[l].c[d] = Accum(scale / (h[d] * h[d]));
+        }
+    }
+    mgMax = 0.0;
+}
+
+/**
+ * @brief V-cycles on level 0 until the residual is below MG_TOL times fmax.
+ *
+ * fmax is max |right-hand side|, accumulated in mgMax by the caller.
+ */
+template <int DIM>
+static void solveCycles(MGSolver *mg, const SimParams *params) {
+    MGLevel *L = &mg->level[0];
+    double tol = params->MG_TOL;
+    if (tol < 16.0 * std::numeric_limits<Real>::epsilon()) tol = 16.0 * std::numeric_limits<Real>::epsilon();
+    const double fmax = mgMax;
+    const double target = tol * fmax;
+
+    int cycles = 0;
+    double res = residual<DIM>(mg, L);
+    while (res > target && cycles < params->MG_MAX_CYCLES) {
+        vcycle<DIM>(mg, 0);
+        cycles++;
+        res = residual<DIM>(mg, L);
+    }
+
+    #pragma omp single
+    {
+        mg->solves++;
+        mg->cycles += cycles;
+        if (cycles > mg->max_cycles) mg->max_cycles = cycles;
+        if (res > target && !mg->warned) {
+            std::fprintf(stderr, "Warning: multigrid residual of %s %g above MG_TOL after %d V-cycles "
+                                 "(reported once).\n", mg->var, res / fmax, cycles);
+            mg->warned = 1;
+        }
+    }
+}
+
+/**
+ * @brief Update the temperature field over one time step with multigrid.
+ *
+ * Same interface as updateTempKernel: reads temp (ghosts filled) and
+ * fb->dphi_dt, writes fb->temp_new. Called by every thread of the team.
+ *
+ * @tparam DIM    Spatial dimension (2 or 3).
+ * @param temp    Input temperature array.
+ * @param fb      FieldBuffers with dphi_dt and output temp_new.
+ * @param params  Simulation parameters including grid dims, dt, K, MG_*.
+ * @param strides Strides of the field arrays.
+ * @param r2      Squared inverse grid spacings: [1/dx*dx, 1/dy*dy, 1/dz*dz].
+ */
+template <int DIM>
+void updateTempMultigridKernel(Real *temp, FieldBuffers *fb, const SimParams *params, int strides[], Accum r2[]) {
+    const Interior<DIM> g(params, strides);
+    const int sx = g.sx;
+    const int sy = g.sy;
+    const int len = g.runLength();
+    const Accum dt = params->dt;
+    const Accum K  = params->K;
+    const Accum e  = Accum(1.0 - params->MG_THETA) * dt;   // explicit weight
+    const Real * __restrict__ T = temp;
+    const Real * __restrict__ dphi_dt = fb->dphi_dt;
+
+    #pragma omp single
+    prepareSolve(&tempMG, params, strides, fb->temp_new, params->MG_THETA * params->dt);
+
+    // Right-hand side, and temp (ghosts included) as the first iterate
+    MGLevel *L = &tempMG.level[0];
+    Real *u = L->u;
+    Real *f = L->f;
+    #pragma omp for reduction(max : mgMax)
+    for (int i = 0; i < g.NX; ++i) {
+        std::memcpy(u + (size_t)i * sx, T + (size_t)i * sx, (size_t)sx * sizeof(Real));
+        if (i == 0 || i == g.NX - 1) continue;
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            for (int n = 0; n < len; ++n) {
+                const int idx = start + n;
+                const Accum c = T[idx];
+                Accum lap = (Accum(T[idx + sx]) - Accum(2.0) * c + Accum(T[idx - sx])) * r2[0]
+                          + (Accum(T[idx + sy]) - Accum(2.0) * c + Accum(T[idx - sy])) * r2[1];
+                if (DIM == 3) lap += (Accum(T[idx + 1]) - Accum(2.0) * c + Accum(T[idx - 1])) * r2[2];
+                const Accum rhs = c + e * lap + dt * K * Accum(dphi_dt[idx]);
+                f[idx] = rhs;
+                const double a = std::fabs((double)rhs);
+                if (a > mgMax) mgMax = a;
+            }
+        }
+    }
+    solveCycles<DIM>(&tempMG, params);
+}
+
+/**
+ * @brief Replace the explicit phi step just taken by the IMEX step.
+ *
+ * Called after the phi kernel, which wrote the explicit rate to
+ * fb->dphi_dt and phi + dt dphi_dt to fb->phi_new: solves for the
+ * stabilized rate in place in dphi_dt (the explicit rate as first
+ * iterate) and rewrites the interior of phi_new. The
+ * temperature update then couples to the stabilized rate. Called by every
+ * thread of the team.
+ *
+ * @tparam DIM    Spatial dimension (2 or 3).
+ * @param phi     Current phase field.
+ * @param fb      FieldBuffers with dphi_dt and phi_new.
+ * @param params  Simulation parameters including grid dims, dt, tau, IMEX_STAB, MG_*.
+ * @param strides Strides of the field arrays.
+ */
+template <int DIM>
+void updatePhiIMEXKernel(Real *phi, FieldBuffers *fb, const SimParams *params, int strides[]) {
+    const Interior<DIM> g(params, strides);
+    const int len = g.runLength();
+    double D, Lr;
+    phiStiffnessBounds(params, &D, &Lr);
+
+    #pragma omp single
+    prepareSolve(&phiMG, params, strides, fb->dphi_dt, params->IMEX_STAB * D * params->dt / params->tau);
+
+    // Right-hand side F, also the first iterate
+    Real *u = fb->dphi_dt;
+    Real *f = phiMG.level[0].f;
+    #pragma omp for reduction(max : mgMax)
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            for (int n = 0; n < len; ++n) {
+                const int idx = start + n;
+                const Real rhs = u[idx];
+                f[idx] = rhs;
+                const double a = std::fabs((double)rhs);
+                if (a > mgMax) mgMax = a;
+            }
+        }
+    }
+    solveCycles<DIM>(&phiMG, params);
+
+    const Accum dt = params->dt;
+    Real * __restrict__ phi_new = fb->phi_new;
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            #pragma GCC ivdep
+            for (int n = 0; n < len; ++n) {
+                const int idx = start + n;
+                phi_new[idx] = Accum(phi[idx]) + dt * Accum(u[idx]);
+            }
+        }
+    }
+}
+
+// Levels and V-cycles per solve of one hierarchy
+static void printSolverReport(const MGSolver *mg) {
+    if (mg->solves == 0) return;
+    const SimParams *cp = &mg->level[mg->levels - 1].params;
+    std::printf("Multigrid %s: %d levels (coarsest %d x %d", mg->var, mg->levels, cp->Num_X - 2, cp->Num_Y - 2);
+    if (cp->DIM == 3) std::printf(" x %d", cp->Num_Z - 2);
+    std::printf("), %.2f V-cycles per step, at most %d\n", (double)mg->cycles / mg->solves, mg->max_cycles);
+}
+
+/**
+ * @brief Print the level sizes and the V-cycles per step of the run so far.
+ */
+void printMultigridReport(void) {
+    printSolverReport(&tempMG);
+    printSolverReport(&phiMG);
+}
+
+/**
+ * @brief Release the level hierarchies.
+ */
+void freeMultigrid(void) {
+    releaseSolver(&tempMG);
+    releaseSolver(&phiMG);
+}
+
+template void updateTempMultigridKernel<2>(Real*, FieldBuffers*, const SimParams*, int[], Accum[]);
+template void updateTempMultigridKernel<3>(Real*, FieldBuffers*, const SimParams*, int[], Accum[]);
+template void updatePhiIMEXKernel<2>(Real*, FieldBuffers*, const SimParams*, int[]);
+template void updatePhiIMEXKernel<3>(Real*, FieldBuffers*, const SimParams*, int[]);
+
+#undef MG_MAX_LEVELS
+#undef MG_PRE_SWEEPS
+#undef MG_POST_SWEEPS
+#undef MG_COARSE_SWEEPS
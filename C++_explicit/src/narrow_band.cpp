@@ -0,0 +1,291 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include "interval_timer.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * narrow_band.cpp
+ *
+ * Narrow-band phase-field update (NARROW_BAND = 1). Away from the interface
+ * phi sits at 0 or 1, where dfdphi and the noise vanish with phi (1 - phi)
+ * and the anisotropic fluxes with the gradient, so the phi kernels visit
+ * the band only: on every unit-stride run of cells, one interval covering
+ * the interface cells of the runs within NB_MARGIN of it, widened by
+ * NB_MARGIN along the run. A cell belongs to the interface when
+ * NB_TOL < phi < 1 - NB_TOL or when it differs from a face neighbour by
+ * more than NB_TOL (a sharp initial interface has no cells in between). Cells outside the
+ * band are not updated, so the interface can only appear inside it: after
+ * each step the band is rebuilt from a scan of the band itself. Cells that
+ * leave it keep their last value in both generations of phi and a zero
+ * dphi_dt, so the temperature update, which stays global, sees no source
+ * there.
+ *  - setupNarrowBand: allocate the band and publish it through params->band
+ *  - buildNarrowBand: first band, from a scan of the whole grid
+ *  - trackNarrowBand: band of the next step, after the phi and temp updates
+ *  - reportNarrowBandInterval / startNarrowBandInterval: band size and
+ *    throughput of each output interval
+ *  - printNarrowBandReport: band size over the whole run
+ *  - freeNarrowBand: release the band
+ */
+
+// Cells of the band being built: a reduction variable of an orphaned omp
+// for must be shared in the enclosing parallel region
+static long bandCells;
+
+/**
+ * @brief Allocate the band of the grid and set params->band (null unless NARROW_BAND).
+ *
+ * The margin wraps around the periodic faces of phi, so that the cells
+ * next to an interface across such a face stay in the band.
+ */
+void setupNarrowBand(SimParams *params, NarrowBand *nb) {
+    std::memset(nb, 0, sizeof(*nb));
+    params->band = nullptr;
+    if (!params->NARROW_BAND) return;
+
+    nb->runs = (params->DIM == 3) ? params->Num_Y - 2 : 1;
+    nb->len  = (params->DIM == 3) ? params->Num_Z - 2 : params->Num_Y - 2;
+    // One interval per run of every x-plane, ghost planes included (empty)
+    const size_t n = (size_t)params->Num_X * nb->runs;
+    int **arrays[6] = { &nb->lo, &nb->hi, &nb->next_lo, &nb->next_hi, &nb->core_lo, &nb->core_hi };
+    for (int a = 0; a < 6; ++a) {
+        *arrays[a] = (int*)std::calloc(n, sizeof(int));
+    }
+
+    const VariableBoundary *vb = findVariableBoundary("phi", params);
+    if (vb) {
+        const FaceBoundary &bc = vb->bc;
+        const int px = bc.left == BOUNDARY_PERIODIC || bc.right == BOUNDARY_PERIODIC;
+        const int py = bc.bottom == BOUNDARY_PERIODIC || bc.top == BOUNDARY_PERIODIC;
+        const int pz = bc.back == BOUNDARY_PERIODIC || bc.front == BOUNDARY_PERIODIC;
+        nb->wrapX = px;
+        nb->wrapY = (params->DIM == 3) ? py : 0;
+        nb->wrapRun = (params->DIM == 3) ? pz : py;
+    }
+    params->band = nb;
+}
+
+/**
+ * @brief Whether the cell at c belongs to the interface (see the file comment).
+ */
+template <int DIM>
+static inline bool isInterface(const Real *c, int sx, int sy, Accum tol) {
+    const Accum p = *c;
+    if (p > tol && p < Accum(1.0) - tol) return true;
+    bool step = std::fabs(Accum(c[1]) - p) > tol || std::fabs(Accum(c[-1]) - p) > tol
+             || std::fabs(Accum(c[sx]) - p) > tol || std::fabs(Accum(c[-sx]) - p) > tol;
+    if (DIM == 3) {
+        step = step || std::fabs(Accum(c[sy]) - p) > tol || std::fabs(Accum(c[-sy]) - p) > tol;
+    }
+    return step;
+}
+
+/**
+ * @brief Interface cells of every run: the first and last interface cell
+ * of its band, as [core_lo, core_hi); len, 0 for none.
+ */
+template <int DIM>
+static void scanInterface(const Real *phi, NarrowBand *nb, const SimParams *params, const int strides[]) {
+    const Interior<DIM> g(params, strides);
+    const Accum tol = params->NB_TOL;
+
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int r = 0; r < nb->runs; ++r) {
+            const int q = i * nb->runs + r;
+            const Real *run = phi + g.runStart(i, r);
+            int lo = nb->lo[q], hi = nb->hi[q];
+            while (lo < hi && !isInterface<DIM>(run + lo, g.sx, g.sy, tol)) ++lo;
+            while (hi > lo && !isInterface<DIM>(run + hi - 1, g.sx, g.sy, tol)) --hi;
+            nb->core_lo[q] = (lo < hi) ? lo : nb->len;
+            nb->core_hi[q] = (lo < hi) ? hi : 0;
+        }
+    }
+}
+
+/**
+ * @brief Next band of every run from the interface cells around it, and
+ * the cells leaving the band frozen at their new value.
+ */
+template <int DIM>
+static void widenBand(Real *phi, FieldBuffers *fb, NarrowBand *nb, const SimParams *params, const int strides[]) {
+    const Interior<DIM> g(params, strides);
+    const int m = params->NB_MARGIN;
+    const int nx = g.NX - 2;
+    const int runs = nb->runs, len = nb->len;
+    const int mr = (DIM == 3) ? m : 0;   // margin across runs of a plane
+
+    #pragma omp for reduction(+ : bandCells)
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int r = 0; r < runs; ++r) {
+            // Hull of the interface cells within the margin
+            int clo = len, chi = 0;
+            for (int di = -m; di <= m; ++di) {
+                int ii = i + di;
+                if (ii < 1 || ii > nx) {
+                    if (!nb->wrapX) continue;
+                    ii = ((ii - 1) % nx + nx) % nx + 1;
+                }
+                for (int dr = -mr; dr <= mr; ++dr) {
+                    int rr = r + dr;
+                    if (rr < 0 || rr >= runs) {
+                        if (!nb->wrapY) continue;
+                        rr = (rr % runs + runs) % runs;
+                    }
+                    const int q = ii * runs + rr;
+                    if (nb->core_lo[q] < clo) clo = nb->core_lo[q];
+                    if (nb->core_hi[q] > chi) chi = nb->core_hi[q];
+                }
+            }
+            int lo = 0, hi = 0;
+            if (chi > 0) {
+                lo = clo - m;
+                hi = chi + m;
+                if (nb->wrapRun && (lo < 0 || hi > len)) {
+                    lo = 0;
+                    hi = len;
+                }
+                if (lo < 0) lo = 0;
+                if (hi > len) hi = len;
+            }
+
+            // Cells leaving the band: both generations hold the new value,
+            // and they no longer feed the temperature
+            const int q = i * runs + r;
+            const int start = g.runStart(i, r);
+            const int ends[2][2] = { { nb->lo[q], (lo < nb->hi[q]) ? lo : nb->hi[q] },
+                                     { (hi > nb->lo[q]) ? hi : nb->lo[q], nb->hi[q] } };
+            for (int e = 0; e < 2; ++e) {
+                for (int n = ends[e][0]; n < ends[e][1]; ++n) {
+                    phi[start + n] = fb->phi_new[start + n];
+                    fb->dphi_dt[start + n] = 0.0;
+                }
+            }
+            nb->next_lo[q] = lo;
+            nb->next_hi[q] = hi;
+            bandCells += hi - lo;
+        }
+    }
+}
+
+/**
+ * @brief Rebuild the band from the new generation of phi; the next band
+ * replaces the current one.
+ */
+static void rebuildBand(Real *phi, FieldBuffers *fb, NarrowBand *nb, const SimParams *params, int strides[]) {
+    if (params->DIM == 3) {
+        scanInterface<3>(fb->phi_new, nb, params, strides);
+    } else {
+        scanInterface<2>(fb->phi_new, nb, params, strides);
+    }
+    #pragma omp single
+    bandCells = 0;
+    if (params->DIM == 3) {
+        widenBand<3>(phi, fb, nb, params, strides);
+    } else {
+        widenBand<2>(phi, fb, nb, params, strides);
+    }
+    #pragma omp single
+    {
+        int *t = nb->lo; nb->lo = nb->next_lo; nb->next_lo = t;
+        t = nb->hi; nb->hi = nb->next_hi; nb->next_hi = t;
+        nb->cells = bandCells;
+    }
+}
+
+/**
+ * @brief First band, from the initial or respawned phi.
+ *
+ * Copies phi into its next generation, so that both agree outside the
+ * band from the start. Called by every thread of the team.
+ */
+void buildNarrowBand(Real *phi, FieldBuffers *fb, NarrowBand *nb, const SimParams *params, int strides[]) {
+    const int runs = nb->runs, len = nb->len;
+    const int sx = strides[0], sy = (params->DIM == 3) ? strides[1] : 1;
+    const int kstart = (params->DIM == 3) ? 1 : 0;
+
+    #pragma omp for
+    for (int i = 1; i < params->Num_X - 1; ++i) {
+        for (int r = 0; r < runs; ++r) {
+            const int start = (params->DIM == 3) ? i * sx + (r + 1) * sy + kstart : i * sx + 1;
+            std::memcpy(fb->phi_new + start, phi + start, (size_t)len * sizeof(Real));
+            nb->lo[i * runs + r] = 0;
+            nb->hi[i * runs + r] = len;
+        }
+    }
+    rebuildBand(phi, fb, nb, params, strides);
+    #pragma omp single
+    startNarrowBandInterval(nb);
+}
+
+/**
+ * @brief Band of the next step, once the step has updated phi and temp.
+ *
+ * Called by every thread of the team after updateTemp and before the
+ * generations are swapped.
+ */
+void trackNarrowBand(Real *phi, FieldBuffers *fb, NarrowBand *nb, const SimParams *params, int strides[]) {
+    // Work of the step just taken
+    #pragma omp single nowait
+    {
+        nb->interval_cells += nb->cells;
+        nb->interval_steps++;
+        nb->total_cells += nb->cells;
+        nb->total_steps++;
+    }
+    rebuildBand(phi, fb, nb, params, strides);
+}
+
+/**
+ * @brief Start timing an output interval; called serially (omp single).
+ */
+void startNarrowBandInterval(NarrowBand *nb) {
+    nb->interval_start = wallSeconds();
+}
+
+/**
+ * @brief Band size and throughput of the output interval ending at step;
+ * called serially (omp single), before the output is written.
+ *
+ * The phi work is the band's share of the interior cells; the throughput
+ * counts every interior cell, as the time-loop report does, so it compares
+ * directly with a run without the band.
+ */
+void reportNarrowBandInterval(NarrowBand *nb, const SimParams *params, int step) {
+    const double interior = interiorCells(params);
+    const double seconds = wallSeconds() - nb->interval_start;
+    const int steps = nb->interval_steps;
+    const double share = (steps > 0) ? nb->interval_cells / (steps * interior) : 0.0;
+    std::printf("Narrow band, steps %d-%d: %.2f%% of cells, phi work 1/%.1f, %.3f s, %.2f Mcell-updates/s\n",
+                step - steps + 1, step, 100.0 * share, (share > 0.0) ? 1.0 / share : 0.0, seconds,
+                cellRate(interior, steps, seconds));
+    nb->interval_cells = 0.0;
+    nb->interval_steps = 0;
+}
+
+/**
+ * @brief Mean band size over the run; prints nothing unless NARROW_BAND.
+ */
+void printNarrowBandReport(const NarrowBand *nb, const SimParams *params) {
+    if (!params->NARROW_BAND || nb->total_steps == 0) return;
+    const double interior = interiorCells(params);
+    const double share = nb->total_cells / (nb->total_steps * interior);
+    std::printf("Narrow band: %.2f%% of cells on average over %ld steps, phi work 1/%.1f\n",
+                100.0 * share, nb->total_steps, (share > 0.0) ? 1.0 / share : 0.0);
+}
+
+/**
+ * @brief Release the band.
+ */
+void freeNarrowBand(NarrowBand *nb) {
+    std::free(nb->lo);
+    std::free(nb->hi);
+    std::free(nb->next_lo);
+    std::free(nb->next_hi);
+    std::free(nb->core_lo);
+    std::free(nb->core_hi);
+    std::memset(nb, 0, sizeof(*nb));
+}
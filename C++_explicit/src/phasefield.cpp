@@ -1,89 +1,70 @@
 #include "header.hpp"
-#include <cstdlib>
+#include "kernels.hpp"
 #include <cmath>
 
 // Macro to compute flattened array index for 3D data
-#define IDX(i, j, k) ((i) * strides[0] + (j) * strides[1] + (k) * strides[2])
+#define IDX(i, j, k) ((i) * sx + (j) * sy + (k))
 
 /**
  * @brief Update phase-field phi using anisotropic fluxes, free energy derivative, and noise.
  *
  * Computes directional fluxes (rj, lj, tj, bj), adds reaction term dF/dphi and noise,
  * and advances phi by one time step: phi_new = phi + dt * dphi/dt.
+ * Cells are visited run by run so that the noise (see NoiseRun) is
+ * generated in batches along each run; with NARROW_BAND only the band part
+ * of each run (Interior::runRange).
  *
+ * @tparam DIM    Spatial dimension (2 or 3).
  * @param phi     Input phase-field array.
  * @param fb      FieldBuffers containing derivatives, anisotropy, and output buffers.
  * @param params  Simulation parameters including grid dims, dt, tau, a.
  * @param r       Inverse grid spacings: [1/dx, 1/dy, 1/dz].
  * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1].
+ * @param step    Timestep number, part of the noise counter.
  */
-void updatePhi(double *phi, FieldBuffers *fb, const SimParams *params, double r[], int strides[]) {
-    int NX = params->Num_X;
-    int NY = params->Num_Y;
-    int NZ = params->Num_Z;
-    int dim = params->DIM;
-    double dt = params->dt;
-    double a  = params->a;
-    double tau= params->tau;
-    int kstart = (dim == 3) ? 1 : 0;
-    int kend   = (dim == 3) ? NZ - 1 : 1;
+template <int DIM>
+void updatePhiKernel(Real *phi, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[], int step) {
+    const Interior<DIM> g(params, strides);
+    Accum dt = params->dt;
+    Accum tau= params->tau;
 
-    for (int i = 1; i < NX - 1; ++i) {
-        for (int j = 1; j < NY - 1; ++j) {
-            for (int k = kstart; k < kend; ++k) {
-                int idx = IDX(i, j, k);
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            int lo, hi;
+            for (int pos = 0; g.nextSegment(i, run, &pos, &lo, &hi); ) {
+                NoiseRun noise(params, step, g.runCellId(i, run) + lo, hi - lo);
+                for (int n = lo; n < hi; ++n) {
+                    int idx = start + n;
 
-                // Compute anisotropic fluxes
-                double rj = fb->ac_right[idx] * (fb->ac_right[idx] * fb->DERX_right[idx]
-                                                 - fb->ac_p_right[idx] * fb->DERY_right[idx]);
-                double lj = fb->ac_left[idx]  * (fb->ac_left[idx]  * fb->DERX_left[idx]
-                                                 - fb->ac_p_left[idx]  * fb->DERY_left[idx]);
-                double tj = fb->ac_top[idx]   * (fb->ac_top[idx]   * fb->DERY_top[idx]
-                                                 + fb->ac_p_top[idx]   * fb->DERX_top[idx]);
-                double bj = fb->ac_bottom[idx]* (fb->ac_bottom[idx]* fb->DERY_bottom[idx]
-                                                 + fb->ac_p_bottom[idx]* fb->DERX_bottom[idx]);
+                    // Compute anisotropic fluxes
+                    Accum rj = fluxX(fb->ac_right[idx],  fb->ac_p_right[idx],  fb->DERX_right[idx],  fb->DERY_right[idx]);
+                    Accum lj = fluxX(fb->ac_left[idx],   fb->ac_p_left[idx],   fb->DERX_left[idx],   fb->DERY_left[idx]);
+                    Accum tj = fluxY(fb->ac_top[idx],    fb->ac_p_top[idx],    fb->DERY_top[idx],    fb->DERX_top[idx]);
+                    Accum bj = fluxY(fb->ac_bottom[idx], fb->ac_p_bottom[idx], fb->DERY_bottom[idx], fb->DERX_bottom[idx]);
 
-                // Add noise term: a * (rand() - 0.5) scaled by phi(1-phi)
-                double noise = a * ((double)std::rand() / RAND_MAX - 0.5);
-                noise *= phi[idx] * (1.0 - phi[idx]);
+                    // Add noise term: a * (u - 0.5) scaled by phi(1-phi)
+                    const Accum p = phi[idx];
+                    Accum eta = noise.next() * (p * (Accum(1.0) - p));
 
-                // Compute time derivative dphi/dt
-                double dphi = (rj - lj) * r[0] + (tj - bj) * r[1];
-                dphi += fb->dfdphi[idx];
-                dphi += noise;
-                dphi /= tau;
-                fb->dphi_dt[idx] = dphi;
+                    // Compute time derivative dphi/dt
+                    Accum dphi = (rj - lj) * r[0] + (tj - bj) * r[1];
+                    dphi += fb->dfdphi[idx];
+                    dphi += eta;
+                    dphi /= tau;
+                    fb->dphi_dt[idx] = dphi;
 
-                // Update phi
-                fb->phi_new[idx] = phi[idx] + dt * dphi;
+                    // Update phi
+                    fb->phi_new[idx] = p + dt * dphi;
+                }
+                if (g.tiles) recordPhiActivity(g, i, run, lo, hi, fb->dphi_dt);
             }
         }
     }
 }
 
-/**
- * @brief Copy updated phi values from src to dst for interior grid points.
- *
- * @param dst     Destination phi array to update.
- * @param src     Source phi_new array containing new phi values.
- * @param params  Simulation parameters for grid dims.
- * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1].
- */
-void copyInterior(double *dst, double *src, const SimParams *params, int strides[]) {
-    int NX = params->Num_X;
-    int NY = params->Num_Y;
-    int dim = params->DIM;
-    int kstart = (dim == 3) ? 1 : 0;
-    int kend   = (dim == 3) ? params->Num_Z - 1 : 1;
-
-    for (int i = 1; i < NX - 1; ++i) {
-        for (int j = 1; j < NY - 1; ++j) {
-            for (int k = kstart; k < kend; ++k) {
-                int idx = IDX(i, j, k);
-                dst[idx] = src[idx];
-            }
-        }
-    }
-}
+template void updatePhiKernel<2>(Real*, FieldBuffers*, const SimParams*, Accum[], int[], int);
+template void updatePhiKernel<3>(Real*, FieldBuffers*, const SimParams*, Accum[], int[], int);
 
 #undef IDX
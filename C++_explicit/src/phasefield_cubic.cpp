@@ -0,0 +1,139 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include "vecmath.hpp"
+#include <cmath>
+
+/*
+ * phasefield_cubic.cpp
+ *
+ * Single-pass phase-field update for DIM = 3 with cubic anisotropy. Each
+ * cell gathers the 19-point stencil of phi, forms the full 3D gradient on
+ * its six faces (normal component by forward difference, tangential
+ * components by averaging the central differences of the two cells sharing
+ * the face), and takes the divergence of the anisotropic flux of cubicFlux:
+ *
+ *   tau dphi/dt = (Jx_e - Jx_w)/dx + (Jy_n - Jy_s)/dy + (Jz_f - Jz_b)/dz
+ *                 + phi (1 - phi)(phi - 1/2 + m(T)) + noise
+ *
+ * The cells of a unit-stride k-run are handled CUBIC_CHUNK at a time: the
+ * noise and the free-energy atan of the chunk are evaluated first (atan
+ * with vecmath.hpp when MATH_MODE = VECTOR), then a branch-free loop along
+ * k computes the fluxes and the update, which the compiler vectorizes.
+ * With NARROW_BAND only the band part of each run is visited.
+ */
+
+// Cells of a k-run per pass of the vector loop
+static constexpr int CUBIC_CHUNK = 64;
+
+/**
+ * @brief Phase-field update for DIM = 3 (replaces updatePhiFusedKernel<3>).
+ *
+ * @tparam VEC    true: free-energy atan from vecmath.hpp (MATH_MODE = VECTOR)
+ * @param phi     Input phase-field array.
+ * @param temp    Temperature field array.
+ * @param fb      FieldBuffers receiving phi_new and dphi_dt.
+ * @param params  Simulation parameters including grid dims, dt, tau, a.
+ * @param r       Inverse grid spacings: [1/dx, 1/dy, 1/dz].
+ * @param strides Strides for flattening 3D indices.
+ * @param step    Timestep number, part of the noise counter.
+ */
+template <bool VEC>
+void updatePhiCubicKernel(Real *phi, Real *temp, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[], int step) {
+    const Interior<3> g(params, strides);
+    const int sx = g.sx;
+    const int sy = g.sy;
+    const Accum dt  = params->dt;
+    const Accum tau = params->tau;
+    const Accum rx = r[0], ry = r[1], rz = r[2];
+    const Accum coef  = params->alpha / M_PI;
+    const Accum gamma = params->gamma;
+    const Accum T_e   = params->T_e;
+    const CubicCoeffs cc = makeCubicCoeffs(params);
+    const Real * __restrict__ P = phi;
+    Real * __restrict__ phi_new = fb->phi_new;
+    Real * __restrict__ dphi_dt = fb->dphi_dt;
+
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            int lo, hi;
+            for (int pos = 0; g.nextSegment(i, run, &pos, &lo, &hi); ) {
+                NoiseRun noise(params, step, g.runCellId(i, run) + lo, hi - lo);
+                for (int k0 = lo; k0 < hi; k0 += CUBIC_CHUNK) {
+                    const int n = (hi - k0 < CUBIC_CHUNK) ? hi - k0 : CUBIC_CHUNK;
+                    const int base = start + k0;
+
+                    // Noise and free-energy driving force m(T) of the chunk
+                    Accum u[CUBIC_CHUNK], m[CUBIC_CHUNK];
+                    for (int c = 0; c < n; ++c) {
+                        u[c] = noise.next();
+                    }
+                    if (VEC) {
+                        for (int c = 0; c < n; c += VM_LANES) {
+                            const int lanes = (n - c < VM_LANES) ? n - c : VM_LANES;
+                            vm_double T = vm_load(temp + base + c, lanes);
+                            vm_store(m + c, (double)coef * vm_atan((double)gamma * ((double)T_e - T)), lanes);
+                        }
+                    } else {
+                        for (int c = 0; c < n; ++c) {
+                            m[c] = coef * std::atan(gamma * (T_e - Accum(temp[base + c])));
+                        }
+                    }
+
+                    #pragma GCC ivdep
+                    for (int c = 0; c < n; ++c) {
+                        const int idx = base + c;
+
+                        // 19-point stencil: e/w = x, n/s = y, f/b = z (k+1/k-1)
+                        const Accum p   = P[idx];
+                        const Accum pe  = P[idx + sx],      pw  = P[idx - sx];
+                        const Accum pn  = P[idx + sy],      ps  = P[idx - sy];
+                        const Accum pf  = P[idx + 1],       pb  = P[idx - 1];
+                        const Accum pen = P[idx + sx + sy], pes = P[idx + sx - sy];
+                        const Accum pwn = P[idx - sx + sy], pws = P[idx - sx - sy];
+                        const Accum pef = P[idx + sx + 1],  peb = P[idx + sx - 1];
+                        const Accum pwf = P[idx - sx + 1],  pwb = P[idx - sx - 1];
+                        const Accum pnf = P[idx + sy + 1],  pnb = P[idx + sy - 1];
+                        const Accum psf = P[idx - sy + 1],  psb = P[idx - sy - 1];
+
+                        // Face gradients and fluxes: x faces
+                        const Accum je = cubicFlux<0>((pe - p) * rx,
+                                                      Accum(0.25) * ((pn + pen) - (ps + pes)) * ry,
+                                                      Accum(0.25) * ((pf + pef) - (pb + peb)) * rz, cc);
+                        const Accum jw = cubicFlux<0>((p - pw) * rx,
+                                                      Accum(0.25) * ((pn + pwn) - (ps + pws)) * ry,
+                                                      Accum(0.25) * ((pf + pwf) - (pb + pwb)) * rz, cc);
+                        // y faces
+                        const Accum jn = cubicFlux<1>(Accum(0.25) * ((pe + pen) - (pw + pwn)) * rx,
+                                                      (pn - p) * ry,
+                                                      Accum(0.25) * ((pf + pnf) - (pb + pnb)) * rz, cc);
+                        const Accum js = cubicFlux<1>(Accum(0.25) * ((pe + pes) - (pw + pws)) * rx,
+                                                      (p - ps) * ry,
+                                                      Accum(0.25) * ((pf + psf) - (pb + psb)) * rz, cc);
+                        // z faces
+                        const Accum jf = cubicFlux<2>(Accum(0.25) * ((pe + pef) - (pw + pwf)) * rx,
+                                                      Accum(0.25) * ((pn + pnf) - (ps + psf)) * ry,
+                                                      (pf - p) * rz, cc);
+                        const Accum jb = cubicFlux<2>(Accum(0.25) * ((pe + peb) - (pw + pwb)) * rx,
+                                                      Accum(0.25) * ((pn + pnb) - (ps + psb)) * ry,
+                                                      (p - pb) * rz, cc);
+
+                        // Free energy and noise, both scaled by phi(1-phi)
+                        const Accum pp = p * (Accum(1.0) - p);
+                        Accum dphi = (je - jw) * rx + (jn - js) * ry + (jf - jb) * rz;
+                        dphi += pp * (p - Accum(0.5) + m[c]);
+                        dphi += u[c] * pp;
+                        dphi /= tau;
+                        dphi_dt[idx] = dphi;
+                        phi_new[idx] = p + dt * dphi;
+                    }
+                }
+                if (g.tiles) recordPhiActivity(g, i, run, lo, hi, dphi_dt);
+            }
+        }
+    }
+}
+
+template void updatePhiCubicKernel<false>(Real*, Real*, FieldBuffers*, const SimParams*, Accum[], int[], int);
+template void updatePhiCubicKernel<true>(Real*, Real*, FieldBuffers*, const SimParams*, Accum[], int[], int);
@@ -0,0 +1,108 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include <cmath>
+
+/**
+ * @brief Single-pass phase-field update (FUSED_KERNEL = 1).
+ *
+ * Performs the work of computedfdphi, computeGradientPhi, computeAnisotropy
+ * and updatePhi in one sweep. Face gradients, anisotropy values and fluxes
+ * are kept in registers for each cell, so only phi and temp are read and
+ * only phi_new and dphi_dt are written. The arithmetic is identical to the
+ * split path, including the noise, which depends only on the cell id.
+ * With NARROW_BAND it visits the same band cells as the split path.
+ *
+ * @tparam DIM    Spatial dimension; instantiated for 2 only, DIM = 3 runs
+ *                updatePhiCubicKernel (phasefield_cubic.cpp).
+ * @tparam J      Anisotropy symmetry for the algebraic engine (4, 6) or 0 for trig.
+ * @param phi     Input phase-field array.
+ * @param temp    Temperature field array.
+ * @param fb      FieldBuffers receiving phi_new and dphi_dt.
+ * @param params  Simulation parameters including grid dims, dt, tau, a.
+ * @param r       Inverse grid spacings: [1/dx, 1/dy, 1/dz].
+ * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1].
+ * @param step    Timestep number, part of the noise counter.
+ */
+template <int DIM, int J>
+void updatePhiFusedKernel(Real *phi, Real *temp, FieldBuffers *fb, const SimParams *params, Accum r[], int strides[], int step) {
+    const Interior<DIM> g(params, strides);
+    const int sx = g.sx;
+    const int sy = g.sy;
+    Accum dt = params->dt;
+    Accum tau= params->tau;
+    const Accum coef  = params->alpha / M_PI;
+    const Accum gamma = params->gamma;
+    const Accum T_e   = params->T_e;
+    const AnisotropyCoeffs coeffs = makeAnisotropyCoeffs(params);
+
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            int lo, hi;
+            for (int pos = 0; g.nextSegment(i, run, &pos, &lo, &hi); ) {
+                NoiseRun noise(params, step, g.runCellId(i, run) + lo, hi - lo);
+                for (int n = lo; n < hi; ++n) {
+                    int idx = start + n;
+
+                    // Stencil values, widened to the arithmetic type
+                    const Accum p   = phi[idx];
+                    const Accum pe  = phi[idx + sx],      pw  = phi[idx - sx];
+                    const Accum pn  = phi[idx + sy],      ps  = phi[idx - sy];
+                    const Accum pne = phi[idx + sx + sy], pnw = phi[idx - sx + sy];
+                    const Accum pse = phi[idx + sx - sy], psw = phi[idx - sx - sy];
+                    const Accum T   = temp[idx];
+
+                    // Free-energy derivative
+                    Accum m = coef * std::atan(gamma * (T_e - T));
+                    Accum dfdphi = p * (Accum(1.0) - p) * (p - Accum(0.5) + m);
+
+                    // Forward differences
+                    Accum DERX_right  = (pe - p) * r[0];
+                    Accum DERX_left   = (p - pw) * r[0];
+                    Accum DERY_top    = (pn - p) * r[1];
+                    Accum DERY_bottom = (p - ps) * r[1];
+
+                    // Mixed-direction derivatives
+                    Accum DERX_top    = Accum(0.25) * ((pe + pne + p + pn) - (pw + pnw + p + pn)) * r[0];
+                    Accum DERX_bottom = Accum(0.25) * ((pe + pse + p + ps) - (pw + psw + p + ps)) * r[0];
+                    Accum DERY_right  = Accum(0.25) * ((pn + pne + p + pe) - (ps + pse + p + pe)) * r[1];
+                    Accum DERY_left   = Accum(0.25) * ((pn + pnw + p + pw) - (ps + psw + p + pw)) * r[1];
+
+                    // Anisotropy at the four faces
+                    Accum ac_right, ac_p_right, ac_left, ac_p_left;
+                    Accum ac_top, ac_p_top, ac_bottom, ac_p_bottom;
+                    anisotropyAt<J>(DERX_right,  DERY_right,  coeffs, &ac_right,  &ac_p_right);
+                    anisotropyAt<J>(DERX_left,   DERY_left,   coeffs, &ac_left,   &ac_p_left);
+                    anisotropyAt<J>(DERX_top,    DERY_top,    coeffs, &ac_top,    &ac_p_top);
+                    anisotropyAt<J>(DERX_bottom, DERY_bottom, coeffs, &ac_bottom, &ac_p_bottom);
+
+                    // Compute anisotropic fluxes
+                    Accum rj = fluxX(ac_right,  ac_p_right,  DERX_right,  DERY_right);
+                    Accum lj = fluxX(ac_left,   ac_p_left,   DERX_left,   DERY_left);
+                    Accum tj = fluxY(ac_top,    ac_p_top,    DERY_top,    DERX_top);
+                    Accum bj = fluxY(ac_bottom, ac_p_bottom, DERY_bottom, DERX_bottom);
+
+                    // Add noise term: a * (u - 0.5) scaled by phi(1-phi)
+                    Accum eta = noise.next() * (p * (Accum(1.0) - p));
+
+                    // Compute time derivative dphi/dt
+                    Accum dphi = (rj - lj) * r[0] + (tj - bj) * r[1];
+                    dphi += dfdphi;
+                    dphi += eta;
+                    dphi /= tau;
+                    fb->dphi_dt[idx] = dphi;
+
+                    // Update phi
+                    fb->phi_new[idx] = p + dt * dphi;
+                }
+                if (g.tiles) recordPhiActivity(g, i, run, lo, hi, fb->dphi_dt);
+            }
+        }
+    }
+}
+
+template void updatePhiFusedKernel<2, 0>(Real*, Real*, FieldBuffers*, const SimParams*, Accum[], int[], int);
+template void updatePhiFusedKernel<2, 4>(Real*, Real*, FieldBuffers*, const SimParams*, Accum[], int[], int);
+template void updatePhiFusedKernel<2, 6>(Real*, Real*, FieldBuffers*, const SimParams*, Accum[], int[], int);
+
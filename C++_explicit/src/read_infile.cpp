@@ -38,9 +38,13 @@ void trim(char *str) {
  * Parses key=value; pairs and populates SimParams. Supports:
  *  - Grid dimensions and spacing (DIM, Num_X/Y/Z, dx/dy/dz)
  *  - Time stepping parameters (dt, total_steps, timebreak)
+ *  - Adaptive time stepping (ADAPTIVE_DT, DT_SAFETY, DT_PHI_TOL, end_time, output_time)
  *  - Material constants (epsilon, tau, delta, j, theta_0, alpha, gamma, a, K, T_e)
+ *  - Noise seed (noise_seed, optional, default 0)
  *  - Boundary and fill specifications for each variable
  *  - Respawn and output options
+ *  - Kernel options (FUSED_KERNEL, ANISOTROPY_ENGINE, MATH_MODE, TEMP_SOLVER, MG_*, SPECTRAL, PHI_SOLVER, IMEX_STAB, NARROW_BAND, NB_TOL, NB_MARGIN, TILE_SKIP, TILE_SIZE, TILE_TOL, TILE_DRIFT, AMR, AMR_BLOCK, AMR_PHI_TOL, AMR_GRAD_TOL, MOVING_WINDOW, WINDOW_TRIGGER, LTS, LTS_LEVELS, LTS_TOL, BLOCK_STEPS, BLOCK_WIDTH)
+ *  - Parallel options (NUM_THREADS, NUMA_REPORT)
  *
  * @param filename Path to the input file.
  * @param params   Pointer to SimParams to populate.
@@ -83,6 +87,11 @@ int readParameters(const char *filename,  SimParams *params) {
         else if (strcasecmp(key,"dt")==0)    { params->dt=std::atof(value); found_dt=1; }
         else if (strcasecmp(key,"total_steps")==0) { params->total_timesteps=std::atoi(value); found_total_steps=1; }
         else if (strcasecmp(key,"timebreak")==0)   { params->timebreak=std::atoi(value); found_timebreak=1; }
+        else if (strcasecmp(key,"ADAPTIVE_DT")==0) { params->ADAPTIVE_DT=std::atoi(value); }
+        else if (strcasecmp(key,"DT_SAFETY")==0)   { params->DT_SAFETY=std::atof(value); }
+        else if (strcasecmp(key,"DT_PHI_TOL")==0)  { params->DT_PHI_TOL=std::atof(value); }
+        else if (strcasecmp(key,"end_time")==0)    { params->end_time=std::atof(value); }
+        else if (strcasecmp(key,"output_time")==0) { params->output_time=std::atof(value); }
         else if (strcasecmp(key,"epsilon")==0) { params->epsilon=std::atof(value); found_epsilon=1; }
         else if (strcasecmp(key,"tau")==0)     { params->tau=std::atof(value); found_tau=1; }
         else if (strcasecmp(key,"delta")==0)   { params->delta=std::atof(value); found_delta=1; }
@@ -219,6 +228,70 @@ int readParameters(const char *filename,  SimParams *params) {
         else if (strcasecmp(key,"restart_time")==0){ params->restart_time=atoi(value); found_restarttime=1; }
         else if (strcasecmp(key,"WRITE_TO_CSV")==0){ params->WRITE_TO_CSV=atoi(value); found_write_to_csv=1; }
         else if (strcasecmp(key,"WRITE_TO_VTK")==0){ params->WRITE_TO_VTK=atoi(value); found_write_to_vtk=1; }
+        else if (strcasecmp(key,"FUSED_KERNEL")==0){ params->FUSED_KERNEL=atoi(value); }
+        else if (strcasecmp(key,"ANISOTROPY_ENGINE")==0) {
+            if (strcasecmp(value,"TRIG")==0)           params->ANISOTROPY_ENGINE=ANISOTROPY_TRIG;
+            else if (strcasecmp(value,"ALGEBRAIC")==0) params->ANISOTROPY_ENGINE=ANISOTROPY_ALGEBRAIC;
+            else {
+                fprintf(stderr, "Error: unknown anisotropy engine '%s'.\n", value);
+                fclose(fp);
+                return 1;
+            }
+        }
+        else if (strcasecmp(key,"BLOCK_STEPS")==0){ params->BLOCK_STEPS=atoi(value); }
+        else if (strcasecmp(key,"BLOCK_WIDTH")==0){ params->BLOCK_WIDTH=atoi(value); }
+        else if (strcasecmp(key,"noise_seed")==0) { params->noise_seed=strtoull(value,NULL,10); }
+        else if (strcasecmp(key,"NUM_THREADS")==0){ params->NUM_THREADS=atoi(value); }
+        else if (strcasecmp(key,"NUMA_REPORT")==0){ params->NUMA_REPORT=atoi(value); }
+        else if (strcasecmp(key,"MATH_MODE")==0) {
+            if (strcasecmp(value,"LIBM")==0)        params->MATH_MODE=MATH_LIBM;
+            else if (strcasecmp(value,"VECTOR")==0) params->MATH_MODE=MATH_VECTOR;
+            else {
+                fprintf(stderr, "Error: unknown math mode '%s'.\n", value);
+                fclose(fp);
+                return 1;
+            }
+        }
+        else if (strcasecmp(key,"TEMP_SOLVER")==0) {
+            if (strcasecmp(value,"EXPLICIT")==0) params->TEMP_SOLVER=TEMP_EXPLICIT;
+            else if (strcasecmp(value,"ADI")==0) params->TEMP_SOLVER=TEMP_ADI;
+            else if (strcasecmp(value,"MULTIGRID")==0) params->TEMP_SOLVER=TEMP_MULTIGRID;
+            else {
+                fprintf(stderr, "Error: unknown temperature solver '%s'.\n", value);
+                fclose(fp);
+                return 1;
+            }
+        }
+        else if (strcasecmp(key,"MG_THETA")==0) { params->MG_THETA=atof(value); }
+        else if (strcasecmp(key,"MG_TOL")==0) { params->MG_TOL=atof(value); }
+        else if (strcasecmp(key,"MG_MAX_CYCLES")==0) { params->MG_MAX_CYCLES=atoi(value); }
+        else if (strcasecmp(key,"SPECTRAL")==0) { params->SPECTRAL=atoi(value); }
+        else if (strcasecmp(key,"PHI_SOLVER")==0) {
+            if (strcasecmp(value,"EXPLICIT")==0) params->PHI_SOLVER=PHI_EXPLICIT;
+            else if (strcasecmp(value,"IMEX")==0) params->PHI_SOLVER=PHI_IMEX;
+            else {
+                fprintf(stderr, "Error: unknown phase-field solver '%s'.\n", value);
+                fclose(fp);
+                return 1;
+            }
+        }
+        else if (strcasecmp(key,"IMEX_STAB")==0) { params->IMEX_STAB=atof(value); }
+        else if (strcasecmp(key,"NARROW_BAND")==0) { params->NARROW_BAND=atoi(value); }
+        else if (strcasecmp(key,"NB_TOL")==0) { params->NB_TOL=atof(value); }
+        else if (strcasecmp(key,"NB_MARGIN")==0) { params->NB_MARGIN=atoi(value); }
+        else if (strcasecmp(key,"TILE_SKIP")==0) { params->TILE_SKIP=atoi(value); }
+        else if (strcasecmp(key,"TILE_SIZE")==0) { params->TILE_SIZE=atoi(value); }
+        else if (strcasecmp(key,"TILE_TOL")==0) { params->TILE_TOL=atof(value); }
+        else if (strcasecmp(key,"TILE_DRIFT")==0) { params->TILE_DRIFT=atof(value); }
+        else if (strcasecmp(key,"AMR")==0) { params->AMR=atoi(value); }
+        else if (strcasecmp(key,"AMR_BLOCK")==0) { params->AMR_BLOCK=atoi(value); }
+        else if (strcasecmp(key,"AMR_PHI_TOL")==0) { params->AMR_PHI_TOL=atof(value); }
+        else if (strcasecmp(key,"AMR_GRAD_TOL")==0) { params->AMR_GRAD_TOL=atof(value); }
+        else if (strcasecmp(key,"MOVING_WINDOW")==0) { params->MOVING_WINDOW=atoi(value); }
+        else if (strcasecmp(key,"WINDOW_TRIGGER")==0) { params->WINDOW_TRIGGER=atof(value); }
+        else if (strcasecmp(key,"LTS")==0) { params->LTS=atoi(value); }
+        else if (strcasecmp(key,"LTS_LEVELS")==0) { params->LTS_LEVELS=atoi(value); }
+        else if (strcasecmp(key,"LTS_TOL")==0) { params->LTS_TOL=atof(value); }
         else { std::fprintf(stderr,"Warning: Unrecognized key '%s'\n",key); }
     }
     std::fclose(fp);
@@ -228,6 +301,221 @@ int readParameters(const char *filename,  SimParams *params) {
         std::fprintf(stderr,"Error: Invalid 3D parameters\n"); return 1;
     }
 
+    if (params->ANISOTROPY_ENGINE==ANISOTROPY_ALGEBRAIC && params->j!=4 && params->j!=6) {
+        fprintf(stderr,"Note: ALGEBRAIC anisotropy supports j = 4 and 6; using TRIG for j = %d.\n", params->j);
+    }
+    if (params->DIM==3) {
+        // 3D runs the single-pass kernel with cubic anisotropy (phasefield_cubic.cpp)
+        if (params->j!=4) {
+            fprintf(stderr,"Note: DIM = 3 uses cubic anisotropy (j = 4); j = %d is ignored.\n", params->j);
+        }
+        if (!params->FUSED_KERNEL) {
+            fprintf(stderr,"Note: DIM = 3 runs the single-pass cubic kernel; FUSED_KERNEL set to 1.\n");
+            params->FUSED_KERNEL=1;
+        }
+    }
+    if (params->MATH_MODE==MATH_VECTOR && params->FUSED_KERNEL && params->DIM==2) {
+        fprintf(stderr,"Note: MATH_MODE = VECTOR applies to the split kernels; the fused kernel uses libm.\n");
+    }
+    if (params->ADAPTIVE_DT) {
+        // Physical end and output times default to those of the fixed-dt run
+        if (params->DT_SAFETY<=0) params->DT_SAFETY=0.9;
+        if (params->end_time<=0) params->end_time=params->total_timesteps*params->dt;
+        if (params->output_time<=0) params->output_time=params->timebreak*params->dt;
+        if (params->BLOCK_STEPS>1) {
+            fprintf(stderr,"Note: ADAPTIVE_DT changes dt every step; stepping without temporal blocking.\n");
+            params->BLOCK_STEPS=0;
+        }
+    }
+    if (params->TEMP_SOLVER==TEMP_ADI && params->BLOCK_STEPS>1) {
+        fprintf(stderr,"Note: TEMP_SOLVER = ADI couples whole grid lines; stepping without temporal blocking.\n");
+        params->BLOCK_STEPS=0;
+    }
+    if (params->TEMP_SOLVER==TEMP_MULTIGRID) {
+        if (params->MG_THETA<=0) params->MG_THETA=1.0;
+        if (params->MG_THETA<0.5 || params->MG_THETA>1.0) {
+            fprintf(stderr,"Error: MG_THETA must lie in [0.5, 1].\n"); return 1;
+        }
+        if (params->BLOCK_STEPS>1) {
+            fprintf(stderr,"Note: TEMP_SOLVER = MULTIGRID couples the whole grid; stepping without temporal blocking.\n");
+            params->BLOCK_STEPS=0;
+        }
+    }
+    if (params->SPECTRAL) {
+        // The Fourier modes are those of a fully periodic box
+        for (int v=0; v<params->numVariables; ++v) {
+            const FaceBoundary &bc = params->variables[v].bc;
+            int periodic = bc.top==BOUNDARY_PERIODIC && bc.bottom==BOUNDARY_PERIODIC
+                        && bc.left==BOUNDARY_PERIODIC && bc.right==BOUNDARY_PERIODIC;
+            if (params->DIM==3) periodic = periodic && bc.front==BOUNDARY_PERIODIC && bc.back==BOUNDARY_PERIODIC;
+            if (!periodic) {
+                fprintf(stderr,"Error: SPECTRAL = 1 needs PERIODIC on every face of '%s'.\n", params->variables[v].varName);
+                return 1;
+            }
+        }
+        if (params->TEMP_SOLVER!=TEMP_EXPLICIT) {
+            fprintf(stderr,"Note: SPECTRAL = 1 integrates the temperature in Fourier space; TEMP_SOLVER is ignored.\n");
+            params->TEMP_SOLVER=TEMP_EXPLICIT;
+        }
+        if (params->PHI_SOLVER!=PHI_EXPLICIT) {
+            fprintf(stderr,"Note: SPECTRAL = 1 stabilizes the phase field in Fourier space; PHI_SOLVER is ignored.\n");
+            params->PHI_SOLVER=PHI_EXPLICIT;
+        }
+        if (params->BLOCK_STEPS>1) {
+            fprintf(stderr,"Note: SPECTRAL = 1 couples the whole grid; stepping without temporal blocking.\n");
+            params->BLOCK_STEPS=0;
+        }
+    }
+    if (params->PHI_SOLVER==PHI_IMEX) {
+        if (params->IMEX_STAB<=0) params->IMEX_STAB=1.0;
+        if (params->IMEX_STAB<0.5) {
+            fprintf(stderr,"Note: IMEX_STAB = %g is below 1/2; the IMEX step may be unstable.\n", params->IMEX_STAB);
+        }
+        if (params->BLOCK_STEPS>1) {
+            fprintf(stderr,"Note: PHI_SOLVER = IMEX couples the whole grid; stepping without temporal blocking.\n");
+            params->BLOCK_STEPS=0;
+        }
+    }
+    if (params->LTS) {
+        if (params->LTS_LEVELS<=0) params->LTS_LEVELS=4;
+        if (params->LTS_TOL<=0) params->LTS_TOL=1e-4;
+        if (params->TILE_SIZE<=0) params->TILE_SIZE=16;
+        if (params->SPECTRAL || params->PHI_SOLVER!=PHI_EXPLICIT || params->TEMP_SOLVER!=TEMP_EXPLICIT || params->ADAPTIVE_DT) {
+            // The tiles take explicit steps of fixed multiples of dt
+            fprintf(stderr,"Note: %s couples the whole grid or changes dt; LTS is ignored.\n",
+                    params->SPECTRAL ? "SPECTRAL = 1" : (params->PHI_SOLVER!=PHI_EXPLICIT) ? "PHI_SOLVER = IMEX"
+                    : params->ADAPTIVE_DT ? "ADAPTIVE_DT = 1" : "an implicit TEMP_SOLVER");
+            params->LTS=0;
+        } else {
+            // The levels select tiles through the flags of the tile map
+            if (params->NARROW_BAND) {
+                fprintf(stderr,"Note: LTS steps whole tiles; NARROW_BAND is ignored.\n");
+                params->NARROW_BAND=0;
+            }
+            if (params->TILE_SKIP) {
+                fprintf(stderr,"Note: LTS steps quiescent tiles by longer steps; TILE_SKIP is ignored.\n");
+                params->TILE_SKIP=0;
+            }
+            if (params->AMR) {
+                fprintf(stderr,"Note: LTS steps whole tiles; AMR is ignored.\n");
+                params->AMR=0;
+            }
+            if (params->MOVING_WINDOW) {
+                fprintf(stderr,"Note: LTS keeps levels per tile of the grid; MOVING_WINDOW is ignored.\n");
+                params->MOVING_WINDOW=0;
+            }
+            if (params->BLOCK_STEPS>1) {
+                fprintf(stderr,"Note: LTS selects the tiles of each step on the whole grid; stepping without temporal blocking.\n");
+                params->BLOCK_STEPS=0;
+            }
+        }
+    }
+    if (params->MOVING_WINDOW) {
+        if (params->WINDOW_TRIGGER<=0 || params->WINDOW_TRIGGER>=1) params->WINDOW_TRIGGER=0.5;
+        // The planes exposed at +x take far-field values
+        for (int v=0; v<params->numVariables; ++v) {
+            const FaceBoundary &bc = params->variables[v].bc;
+            if (bc.left==BOUNDARY_PERIODIC || bc.right==BOUNDARY_PERIODIC) {
+                fprintf(stderr,"Error: MOVING_WINDOW = 1 needs non-periodic x faces of '%s'.\n", params->variables[v].varName);
+                return 1;
+            }
+        }
+        // Their state belongs to the cells of the grid, which the shift moves
+        if (params->NARROW_BAND) {
+            fprintf(stderr,"Note: MOVING_WINDOW shifts the fields between steps; NARROW_BAND is ignored.\n");
+            params->NARROW_BAND=0;
+        }
+        if (params->TILE_SKIP) {
+            fprintf(stderr,"Note: MOVING_WINDOW shifts the fields between steps; TILE_SKIP is ignored.\n");
+            params->TILE_SKIP=0;
+        }
+        if (params->AMR) {
+            fprintf(stderr,"Note: MOVING_WINDOW shifts the fields between steps; AMR is ignored.\n");
+            params->AMR=0;
+        }
+        if (params->BLOCK_STEPS>1) {
+            fprintf(stderr,"Note: MOVING_WINDOW shifts the fields between steps; stepping without temporal blocking.\n");
+            params->BLOCK_STEPS=0;
+        }
+    }
+    if (params->NARROW_BAND) {
+        if (params->NB_TOL<=0) params->NB_TOL=1e-6;
+        if (params->NB_MARGIN<=0) params->NB_MARGIN=2;
+        if (params->SPECTRAL || params->PHI_SOLVER==PHI_IMEX) {
+            // Both rewrite phi on every cell after the explicit kernel
+            fprintf(stderr,"Note: %s updates phi on every cell; NARROW_BAND is ignored.\n",
+                    params->SPECTRAL ? "SPECTRAL = 1" : "PHI_SOLVER = IMEX");
+            params->NARROW_BAND=0;
+        } else if (params->BLOCK_STEPS>1) {
+            fprintf(stderr,"Note: NARROW_BAND tracks the interface on the whole grid; stepping without temporal blocking.\n");
+            params->BLOCK_STEPS=0;
+        }
+    }
+    if (params->TILE_SKIP) {
+        if (params->TILE_SIZE<=0) params->TILE_SIZE=16;
+        if (params->TILE_TOL<0) {
+            fprintf(stderr,"Error: TILE_TOL must not be negative.\n"); return 1;
+        }
+        if (params->TILE_DRIFT<=0) params->TILE_DRIFT=1e-6;
+        if (params->SPECTRAL || params->PHI_SOLVER==PHI_IMEX) {
+            fprintf(stderr,"Note: %s updates phi on every cell; TILE_SKIP is ignored.\n",
+                    params->SPECTRAL ? "SPECTRAL = 1" : "PHI_SOLVER = IMEX");
+            params->TILE_SKIP=0;
+        } else {
+            if (params->BLOCK_STEPS>1) {
+                fprintf(stderr,"Note: TILE_SKIP classifies the tiles of the whole grid; stepping without temporal blocking.\n");
+                params->BLOCK_STEPS=0;
+            }
+            if (params->TEMP_SOLVER!=TEMP_EXPLICIT) {
+                fprintf(stderr,"Note: TEMP_SOLVER = %s solves temp on the whole grid; TILE_SKIP skips phi tiles only.\n",
+                        (params->TEMP_SOLVER==TEMP_ADI) ? "ADI" : "MULTIGRID");
+            }
+        }
+    }
+    if (params->AMR) {
+        if (params->AMR_BLOCK<=0) params->AMR_BLOCK=8;
+        if (params->AMR_PHI_TOL<=0) params->AMR_PHI_TOL=1e-3;
+        if (params->AMR_GRAD_TOL<=0) params->AMR_GRAD_TOL=1e-2;
+        if (params->SPECTRAL || params->PHI_SOLVER!=PHI_EXPLICIT || params->TEMP_SOLVER!=TEMP_EXPLICIT || params->ADAPTIVE_DT) {
+            // The patches take explicit substeps of a fixed dt
+            fprintf(stderr,"Note: %s couples the whole grid or changes dt; AMR is ignored.\n",
+                    params->SPECTRAL ? "SPECTRAL = 1" : (params->PHI_SOLVER!=PHI_EXPLICIT) ? "PHI_SOLVER = IMEX"
+                    : params->ADAPTIVE_DT ? "ADAPTIVE_DT = 1" : "an implicit TEMP_SOLVER");
+            params->AMR=0;
+        } else {
+            if (params->NARROW_BAND) {
+                fprintf(stderr,"Note: AMR refines around the interface; NARROW_BAND is ignored.\n");
+                params->NARROW_BAND=0;
+            }
+            if (params->TILE_SKIP) {
+                fprintf(stderr,"Note: AMR refines around the interface; TILE_SKIP is ignored.\n");
+                params->TILE_SKIP=0;
+            }
+            if (params->BLOCK_STEPS>1) {
+                fprintf(stderr,"Note: AMR regrids after every step; stepping without temporal blocking.\n");
+                params->BLOCK_STEPS=0;
+            }
+        }
+    }
+    if (params->TEMP_SOLVER==TEMP_MULTIGRID || params->PHI_SOLVER==PHI_IMEX) {
+        if (params->MG_TOL<=0) params->MG_TOL=1e-8;
+        if (params->MG_MAX_CYCLES<=0) params->MG_MAX_CYCLES=30;
+    }
+    if (params->BLOCK_STEPS>1) {
+        // The x-slabs wrap around periodic faces only when both faces of both fields are periodic
+        int periodic=-1, mixed=0;
+        for (int v=0; v<params->numVariables; ++v) {
+            const FaceBoundary &bc = params->variables[v].bc;
+            int p = (bc.left==BOUNDARY_PERIODIC);
+            if (p!=(bc.right==BOUNDARY_PERIODIC) || (periodic>=0 && p!=periodic)) mixed=1;
+            periodic = p;
+        }
+        if (mixed) {
+            fprintf(stderr,"Note: BLOCK_STEPS needs the same periodicity on both x faces of every field; stepping without temporal blocking.\n");
+            params->BLOCK_STEPS=0;
+        }
+    }
+
     int error=0;
     if(!found_DIM){fprintf(stderr,"Error: DIM missing.\n"); error=1;}    
     if(!found_Num_X){fprintf(stderr,"Error: Num_X missing.\n"); error=1;}    
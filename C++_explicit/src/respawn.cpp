@@ -19,7 +19,7 @@
  * @param params   Simulation parameters for grid sizing.
  * @param strides  Strides for flattening 3D indices.
  */
-void read_input_vtk(const char *filename, double *arr, const SimParams *params, int strides[]) {
+void read_input_vtk(const char *filename, Real *arr, const SimParams *params, int strides[]) {
     FILE *fp = std::fopen(filename, "r");
     if (!fp) {
         std::fprintf(stderr, "Warning: Could not open VTK file %s for reading.\n", filename);
@@ -45,11 +45,13 @@ void read_input_vtk(const char *filename, double *arr, const SimParams *params,
     for (int i = 1; i < NX - 1; ++i) {
         for (int j = 1; j < NY - 1; ++j) {
             int idx = IDX(i, j, kstart);
-            if (std::fscanf(fp, "%lf", &arr[idx]) != 1) {
+            double value;
+            if (std::fscanf(fp, "%lf", &value) != 1) {
                 std::fprintf(stderr, "Error reading data at (%d,%d).\n", i, j);
                 std::fclose(fp);
                 std::exit(EXIT_FAILURE);
             }
+            arr[idx] = value;
         }
     }
 
@@ -67,7 +69,7 @@ void read_input_vtk(const char *filename, double *arr, const SimParams *params,
  * @param params   Simulation parameters for grid sizing.
  * @param strides  Strides for flattening 3D indices.
  */
-void read_input_csv(const char *filename, double *arr, const SimParams *params, int strides[]) {
+void read_input_csv(const char *filename, Real *arr, const SimParams *params, int strides[]) {
     FILE *fp = std::fopen(filename, "r");
     if (!fp) {
         std::fprintf(stderr, "Warning: Could not open CSV file %s for reading.", filename);
@@ -0,0 +1,345 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * temperature_adi.cpp
+ *
+ * Implicit temperature integrator (TEMP_SOLVER = ADI): the Douglas-Gunn
+ * ADI splitting of Crank-Nicolson for dT/dt = lap T + K dphi/dt,
+ *
+ *   (1 - h Ax) T1 = (1 + h Ax + 2h (Ay + Az)) T + dt K dphi/dt
+ *   (1 - h Ay) T2 = T1 - h Ay T
+ *   (1 - h Az) T' = T2 - h Az T          (3D; in 2D T' = T2)
+ *
+ * with h = dt/2 and Ax, Ay, Az the second differences along each axis.
+ * Second order in time and unconditionally stable, so dt is limited by
+ * the phase field alone; in 2D it is equivalent to the Peaceman-Rachford
+ * scheme of the C prototype (C_explicit_implicit/src/temperature.c).
+ *
+ * Every stage solves one tridiagonal system per grid line along its axis.
+ * The coefficients are the same for all lines, so the Thomas factors are
+ * computed once per dt (factorAxis) and a line solve is one forward and one
+ * backward recurrence. Lines that are adjacent in memory (x lines in 2D,
+ * x and y lines in 3D) are solved together, the recurrence running across
+ * lines in the inner loop; lines along the contiguous axis are solved one
+ * at a time. Lines are shared out across the team with orphaned omp for.
+ *
+ * Boundaries, per axis, from the temp boundary conditions:
+ *  - NOFLUX: the ghost equals the adjacent cell (diagonal 1 + r)
+ *  - PERIODIC on both faces: cyclic system, Sherman-Morrison correction
+ *  - otherwise: the ghost value of temp is held fixed (right-hand side)
+ */
+
+// Adjacent lines solved together by one work item
+#define ADI_CHUNK 64
+
+// Factors of (1 - r A) on the lines of one axis
+struct AdiAxis {
+    int    n;               // unknowns per line
+    Accum  r;               // h / dx^2 along the axis
+    int    cyclic;          // PERIODIC on both faces
+    int    fixed_lo, fixed_hi;  // ghost value held fixed on that face
+    Accum *inv_m;           // 1 / pivot of each row
+    Accum *cp;              // super-diagonal over pivot
+    Accum *z;               // cyclic: solution for the Sherman-Morrison vector
+    Accum  sm_ratio;        // cyclic: beta / gamma
+    Accum  sm_inv_den;      // cyclic: 1 / (1 + z_0 + beta/gamma z_{n-1})
+};
+
+// Factors of the current dt, refreshed when dt or the grid changes
+static struct {
+    double  dt;
+    int     dims[MAX_DIM];
+    AdiAxis axis[MAX_DIM];
+    Accum  *storage;
+} adi;
+
+/**
+ * @brief Thomas factors of (1 - r A) for one axis.
+ *
+ * Row p reads -r x_{p-1} + (1 + 2r) x_p - r x_{p+1} = d_p. A NOFLUX face
+ * folds its ghost into the diagonal; for a cyclic axis the corners are
+ * removed by the Sherman-Morrison update A = A' + u v^T with
+ * u = (gamma, 0, ..., 0, -r), v = (1, 0, ..., 0, -r/gamma), gamma = -b_0.
+ */
+static void factorAxis(AdiAxis *ax, int n, Accum r, BoundaryType lo, BoundaryType hi, Accum *storage) {
+    ax->n = n;
+    ax->r = r;
+    ax->cyclic = (lo == BOUNDARY_PERIODIC && hi == BOUNDARY_PERIODIC && n > 1);
+    ax->fixed_lo = !ax->cyclic && lo != BOUNDARY_NOFLUX;
+    ax->fixed_hi = !ax->cyclic && hi != BOUNDARY_NOFLUX;
+    ax->inv_m = storage;
+    ax->cp    = storage + n;
+    ax->z     = storage + 2 * n;
+
+    const Accum b = Accum(1.0) + Accum(2.0) * r;
+    const Accum gamma = -b;
+    Accum first = b, last = b;
+    if (ax->cyclic) {
+        first = b - gamma;
+        last  = b - r * r / gamma;
+    } else if (n == 1) {
+        // A single cell: the ghosts enter only through fixed faces
+        first = last = Accum(1.0) + (ax->fixed_lo ? r : Accum(0.0)) + (ax->fixed_hi ? r : Accum(0.0));
+    } else {
+        if (lo == BOUNDARY_NOFLUX) first = b - r;
+        if (hi == BOUNDARY_NOFLUX) last  = b - r;
+    }
+
+    Accum prev_cp = 0.0;
+    for (int p = 0; p < n; ++p) {
+        const Accum diag = (p == 0) ? first : (p == n - 1) ? last : b;
+        const Accum m = diag + r * prev_cp;    // b_p - a_p c'_{p-1}, a_p = -r
+        ax->inv_m[p] = Accum(1.0) / m;
+        ax->cp[p] = -r / m;
+        prev_cp = ax->cp[p];
+    }
+
+    if (ax->cyclic) {
+        // z = A'^{-1} u
+        for (int p = 0; p < n; ++p) ax->z[p] = 0.0;
+        ax->z[0] = gamma;
+        ax->z[n - 1] = -r;
+        ax->z[0] *= ax->inv_m[0];
+        for (int p = 1; p < n; ++p) ax->z[p] = (ax->z[p] + r * ax->z[p - 1]) * ax->inv_m[p];
+        for (int p = n - 2; p >= 0; --p) ax->z[p] -= ax->cp[p] * ax->z[p + 1];
+        ax->sm_ratio = -r / gamma;
+        ax->sm_inv_den = Accum(1.0) / (Accum(1.0) + ax->z[0] + ax->sm_ratio * ax->z[n - 1]);
+    }
+}
+
+/**
+ * @brief Refresh the factors of all axes for the current dt. Runs in omp single.
+ */
+static void refreshFactors(const SimParams *params, Accum r2[]) {
+    const int dims[MAX_DIM] = { params->Num_X - 2, params->Num_Y - 2,
+                                (params->DIM == 3) ? params->Num_Z - 2 : 0 };
+    if (adi.storage && adi.dt == params->dt && std::memcmp(adi.dims, dims, sizeof(dims)) == 0) return;
+
+    FaceBoundary bc;
+    bc.top = bc.bottom = bc.left = bc.right = bc.front = bc.back = BOUNDARY_UNDEFINED;
+    for (int v = 0; v < params->numVariables; ++v) {
+        if (std::strcmp(params->variables[v].varName, "temp") == 0) bc = params->variables[v].bc;
+    }
+
+    if (!adi.storage || std::memcmp(adi.dims, dims, sizeof(dims)) != 0) {
+        std::free(adi.storage);
+        adi.storage = (Accum*)std::malloc(3 * (size_t)(dims[0] + dims[1] + dims[2]) * sizeof(Accum));
+    }
+    const Accum h = Accum(0.5 * params->dt);
+    factorAxis(&adi.axis[0], dims[0], h * r2[0], bc.left, bc.right, adi.storage);
+    factorAxis(&adi.axis[1], dims[1], h * r2[1], bc.bottom, bc.top, adi.storage + 3 * dims[0]);
+    if (params->DIM == 3) {
+        factorAxis(&adi.axis[2], dims[2], h * r2[2], bc.back, bc.front,
+                   adi.storage + 3 * (dims[0] + dims[1]));
+    }
+    adi.dt = params->dt;
+    std::memcpy(adi.dims, dims, sizeof(dims));
+}
+
+/**
+ * @brief Solve (1 - r A) x = d in place on `width` adjacent lines.
+ *
+ * Line q holds its unknowns at x[q + p * stride], p = 0 .. n-1, on entry
+ * the right-hand side. t points at the same cells of temp, whose ghosts
+ * supply the values of fixed faces.
+ */
+static void solveLines(Real *x, size_t stride, int width, const AdiAxis &ax, const Real *t) {
+    const int n = ax.n;
+    const Accum r = ax.r;
+    Real *last = x + (size_t)(n - 1) * stride;
+
+    if (ax.fixed_lo) {
+        const Real *ghost = t - stride;
+        for (int q = 0; q < width; ++q) x[q] += r * Accum(ghost[q]);
+    }
+    if (ax.fixed_hi) {
+        const Real *ghost = t + (size_t)n * stride;
+        for (int q = 0; q < width; ++q) last[q] += r * Accum(ghost[q]);
+    }
+
+    // Forward elimination
+    for (int q = 0; q < width; ++q) x[q] *= ax.inv_m[0];
+    for (int p = 1; p < n; ++p) {
+        Real *xp = x + p * stride;
+        const Real *xm = xp - stride;
+        const Accum im = ax.inv_m[p];
+        #pragma GCC ivdep
+        for (int q = 0; q < width; ++q) xp[q] = (Accum(xp[q]) + r * Accum(xm[q])) * im;
+    }
+    // Back substitution
+    for (int p = n - 2; p >= 0; --p) {
+        Real *xp = x + p * stride;
+        const Real *xn = xp + stride;
+        const Accum c = ax.cp[p];
+        #pragma GCC ivdep
+        for (int q = 0; q < width; ++q) xp[q] -= c * Accum(xn[q]);
+    }
+
+    if (ax.cyclic) {
+        Accum f[ADI_CHUNK];
+        for (int q = 0; q < width; ++q) {
+            f[q] = (Accum(x[q]) + ax.sm_ratio * Accum(last[q])) * ax.sm_inv_den;
+        }
+        for (int p = 0; p < n; ++p) {
+            Real *xp = x + p * stride;
+            const Accum zp = ax.z[p];
+            #pragma GCC ivdep
+            for (int q = 0; q < width; ++q) xp[q] -= f[q] * zp;
+        }
+    }
+}
+
+/**
+ * @brief Solve along x (stride sx): the lines of one run of cells form a bundle.
+ */
+template <int DIM>
+static void sweepX(Real *x, const Real *t, const Interior<DIM> &g, const AdiAxis &ax) {
+    const int len = g.runLength();
+    const int chunks = (len + ADI_CHUNK - 1) / ADI_CHUNK;
+    #pragma omp for schedule(static)
+    for (int item = 0; item < g.runs() * chunks; ++item) {
+        const int run = item / chunks;
+        const int q0 = (item % chunks) * ADI_CHUNK;
+        const int width = (len - q0 < ADI_CHUNK) ? len - q0 : ADI_CHUNK;
+        const size_t base = g.runStart(1, run) + q0;
+        solveLines(x + base, g.sx, width, ax, t + base);
+    }
+}
+
+/**
+ * @brief Solve along y (stride sy): bundles over k in 3D, single lines in 2D.
+ */
+template <int DIM>
+static void sweepY(Real *x, const Real *t, const Interior<DIM> &g, const AdiAxis &ax) {
+    if (DIM == 3) {
+        const int len = g.kend - g.kstart;
+        const int chunks = (len + ADI_CHUNK - 1) / ADI_CHUNK;
+        #pragma omp for schedule(static)
+        for (int item = 0; item < (g.NX - 2) * chunks; ++item) {
+            const int i = 1 + item / chunks;
+            const int q0 = (item % chunks) * ADI_CHUNK;
+            const int width = (len - q0 < ADI_CHUNK) ? len - q0 : ADI_CHUNK;
+            const size_t base = (size_t)i * g.sx + g.sy + g.kstart + q0;
+            solveLines(x + base, g.sy, width, ax, t + base);
+        }
+    } else {
+        #pragma omp for schedule(static)
+        for (int i = 1; i < g.NX - 1; ++i) {
+            const size_t base = (size_t)i * g.sx + 1;
+            solveLines(x + base, 1, 1, ax, t + base);
+        }
+    }
+}
+
+/**
+ * @brief Solve along z (unit stride, 3D): one line per (i, j).
+ */
+template <int DIM>
+static void sweepZ(Real *x, const Real *t, const Interior<DIM> &g, const AdiAxis &ax) {
+    #pragma omp for schedule(static)
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const size_t base = g.runStart(i, run);
+            solveLines(x + base, 1, 1, ax, t + base);
+        }
+    }
+}
+
+/**
+ * @brief Update the temperature field over one time step with ADI.
+ *
+ * Same interface as updateTempKernel: reads temp (ghosts filled) and
+ * fb->dphi_dt, writes the interior of fb->temp_new. fb->temp_star holds
+ * the intermediate stages. Called by every thread of the team.
+ *
+ * @tparam DIM    Spatial dimension (2 or 3).
+ * @param temp    Input temperature array.
+ * @param fb      FieldBuffers with dphi_dt, temp_star and output temp_new.
+ * @param params  Simulation parameters including grid dims, dt, K.
+ * @param strides Strides of the field arrays.
+ * @param r2      Squared inverse grid spacings: [1/dx*dx, 1/dy*dy, 1/dz*dz].
+ */
+template <int DIM>
+void updateTempADIKernel(Real *temp, FieldBuffers *fb, const SimParams *params, int strides[], Accum r2[]) {
+    const Interior<DIM> g(params, strides);
+    const int sx = g.sx;
+    const int sy = g.sy;
+    const int len = g.runLength();
+    const Accum dt = params->dt;
+    const Accum h  = Accum(0.5) * dt;
+    const Accum K  = params->K;
+    const Real * __restrict__ T = temp;
+    const Real * __restrict__ dphi_dt = fb->dphi_dt;
+    Real *S = fb->temp_star;
+    Real *N = fb->temp_new;
+
+    #pragma omp single
+    refreshFactors(params, r2);
+
+    // Stage 1: explicit right-hand side, implicit in x
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            #pragma GCC ivdep
+            for (int n = 0; n < len; ++n) {
+                const int idx = start + n;
+                const Accum c = T[idx];
+                Accum ax = (Accum(T[idx + sx]) - Accum(2.0) * c + Accum(T[idx - sx])) * r2[0];
+                Accum ay = (Accum(T[idx + sy]) - Accum(2.0) * c + Accum(T[idx - sy])) * r2[1];
+                if (DIM == 3) ay += (Accum(T[idx + 1]) - Accum(2.0) * c + Accum(T[idx - 1])) * r2[2];
+                S[idx] = c + h * ax + dt * (ay + K * Accum(dphi_dt[idx]));
+            }
+        }
+    }
+    sweepX<DIM>(S, T, g, adi.axis[0]);
+
+    // Stage 2: correction implicit in y; the last stage in 2D writes temp_new
+    Real *Y = (DIM == 3) ? S : N;
+    #pragma omp for
+    for (int i = 1; i < g.NX - 1; ++i) {
+        for (int run = 0; run < g.runs(); ++run) {
+            const int start = g.runStart(i, run);
+            #pragma GCC ivdep
+            for (int n = 0; n < len; ++n) {
+                const int idx = start + n;
+                const Accum c = T[idx];
+                Y[idx] = Accum(S[idx]) - h * (Accum(T[idx + sy]) - Accum(2.0) * c + Accum(T[idx - sy])) * r2[1];
+            }
+        }
+    }
+    sweepY<DIM>(Y, T, g, adi.axis[1]);
+
+    // Stage 3 (3D): correction implicit in z
+    if (DIM == 3) {
+        #pragma omp for
+        for (int i = 1; i < g.NX - 1; ++i) {
+            for (int run = 0; run < g.runs(); ++run) {
+                const int start = g.runStart(i, run);
+                #pragma GCC ivdep
+                for (int n = 0; n < len; ++n) {
+                    const int idx = start + n;
+                    const Accum c = T[idx];
+                    N[idx] = Accum(S[idx]) - h * (Accum(T[idx + 1]) - Accum(2.0) * c + Accum(T[idx - 1])) * r2[2];
+                }
+            }
+        }
+        sweepZ<DIM>(N, T, g, adi.axis[2]);
+    }
+}
+
+/**
+ * @brief Release the cached ADI factors.
+ */
+void freeAdiFactors(void) {
+    std::free(adi.storage);
+    std::memset(&adi, 0, sizeof(adi));
+}
+
+template void updateTempADIKernel<2>(Real*, FieldBuffers*, const SimParams*, int[], Accum[]);
+template void updateTempADIKernel<3>(Real*, FieldBuffers*, const SimParams*, int[], Accum[]);
+
+#undef ADI_CHUNK
@@ -0,0 +1,580 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * temporal_blocking.cpp
+ *
+ * Temporal blocking of the explicit time loop (BLOCK_STEPS > 1). The
+ * interior cells are split into tiles of BLOCK_WIDTH cells per edge along
+ * x, y and (in 3D) z; an axis with a periodic face is not split. For a block
+ * of up to BLOCK_STEPS steps, each tile is copied together with a halo of
+ * BLOCK_STEPS + 1 cells on every side into a per-thread local grid sized to
+ * stay in cache, advanced through every step of the block there with the
+ * regular kernels, and only its own cells are written back. Neighbouring
+ * tiles recompute the halo redundantly (overlapped, trapezoidal tiles): the
+ * outermost halo layer is never updated and its ghosts are not refilled,
+ * and after s steps the next s layers are stale too, so the owned cells are
+ * exact after BLOCK_STEPS. Stale layers are dropped from the sweep as they
+ * appear, which halves the redundant work.
+ *  - setupTemporalBlocking: tile edges, per-slab column lists, workspaces
+ *  - temporalBlockLength: number of steps in the block starting at step t
+ *  - advanceTemporalBlock: advance phi and temp through one block
+ *  - freeTemporalBlocking: release the column lists and workspaces
+ *
+ * Boundaries: the y and z faces of the global grid use the selected
+ * boundary kernels unchanged on the tiles that touch them; on a halo side
+ * the face is UNDEFINED, so the halo layer keeps its data. The x ghost
+ * columns are rebuilt after every substep from the tile's own data: NOFLUX
+ * copies the adjacent column and UNDEFINED keeps the ghost column. For
+ * PERIODIC x the tile columns are taken around the ring 1..NX-2, and
+ * wherever it wraps from NX-2 to 1 the ghost pair (NX-1, 0) is inserted and
+ * refilled as applyBoundaryConditions would. Ghost edge cells that no face
+ * kernel writes keep their values, and noise cell ids use global indices,
+ * so the result is bitwise identical to the per-step sweep for any block
+ * length, tile size and thread count.
+ */
+
+// Role of a local column
+enum ColumnRole {
+    COL_INTERIOR,   // interior column of the global grid
+    COL_GHOST,      // x ghost column (0 or NX-1) of a non-periodic face
+    COL_WRAP_HI,    // ghost column NX-1 of a periodic face, copy of column 1
+    COL_WRAP_LO     // ghost column 0 of a periodic face, copy of column NX-2
+};
+
+// Fallback when the L2 size is not reported
+static constexpr long TILE_DEFAULT_L2 = 1L << 20;
+
+/**
+ * @brief List the global columns of the slab owning interior columns [X0, X1).
+ *
+ * cols/role may be null to count only.
+ *
+ * @return Number of local columns.
+ */
+static int tileColumns(int X0, int X1, int halo, int NX, bool periodic,
+                       int *cols, char *role, int *owned_first) {
+    int n = 0;
+    if (!periodic) {
+        const int lo = (X0 - halo > 0) ? X0 - halo : 0;
+        const int hi = (X1 - 1 + halo < NX - 1) ? X1 - 1 + halo : NX - 1;
+        for (int g = lo; g <= hi; ++g, ++n) {
+            if (cols) {
+                cols[n] = g;
+                role[n] = (g == 0 || g == NX - 1) ? COL_GHOST : COL_INTERIOR;
+            }
+        }
+        if (owned_first) *owned_first = X0 - lo;
+        return n;
+    }
+
+    // Walk the ring of interior columns; the halo may wrap more than once on
+    // narrow grids, in which case columns simply repeat
+    const int P = NX - 2;
+    for (int pos = X0 - halo; pos < X1 + halo; ++pos) {
+        const int g = ((pos - 1) % P + P) % P + 1;
+        if (g == 1 && n > 0) {
+            if (cols) {
+                cols[n] = NX - 1;  role[n] = COL_WRAP_HI;
+                cols[n + 1] = 0;   role[n + 1] = COL_WRAP_LO;
+            }
+            n += 2;
+        }
+        if (pos == X0 && owned_first) *owned_first = n;
+        if (cols) {
+            cols[n] = g;
+            role[n] = COL_INTERIOR;
+        }
+        ++n;
+    }
+    return n;
+}
+
+/**
+ * @brief Local cells [lo, hi) along y or z of the tile owning interior
+ * cells [A0, A1) of an axis of N cells, ghosts included.
+ */
+static void tileSpan(int A0, int A1, int halo, int N, int *lo, int *hi) {
+    *lo = (A0 - halo > 0) ? A0 - halo : 0;
+    *hi = (A1 + halo < N) ? A1 + halo : N;
+}
+
+/**
+ * @brief Bytes of a local grid of tiles with `edge` cells per split axis,
+ * halo included: two generations of phi and temp and the buffers.
+ */
+static size_t localGridBytes(const SimParams *params, int edge, int halo, bool split_y, bool split_z) {
+    SimParams local = *params;
+    local.BLOCK_STEPS = 0;
+    local.Num_X = edge + 2 * halo;
+    if (split_y && edge + 2 * halo < params->Num_Y) local.Num_Y = edge + 2 * halo;
+    if (split_z && edge + 2 * halo < params->Num_Z) local.Num_Z = edge + 2 * halo;
+    int strides[3];
+    fieldStrides(&local, strides);
+    return (4 + fieldBufferCount(&local)) * fieldArrayBytes(&local, strides);
+}
+
+/**
+ * @brief Build the tiles and the per-thread workspaces.
+ *
+ * Leaves tb->steps = 0 (per-step sweep) unless BLOCK_STEPS > 1. Call after
+ * the thread count has been resolved into params->NUM_THREADS.
+ *
+ * @param params  Simulation parameters (grid, BLOCK_STEPS, BLOCK_WIDTH, boundaries)
+ * @param tb      TemporalBlocking to populate
+ */
+void setupTemporalBlocking(const SimParams *params, TemporalBlocking *tb) {
+    std::memset(tb, 0, sizeof(*tb));
+    if (params->BLOCK_STEPS <= 1) {
+        return;
+    }
+
+    const int NX = params->Num_X;
+    const int NY = params->Num_Y;
+    const int NZ = params->Num_Z;
+    const bool is3D = (params->DIM == 3);
+    const int halo = params->BLOCK_STEPS + 1;
+    const int interior = NX - 2;
+
+    // readParameters guarantees both fields agree on x-periodicity; y and z
+    // are split only when no field is periodic along them
+    bool periodic = false, split_y = true, split_z = is3D;
+    for (int v = 0; v < params->numVariables; ++v) {
+        const FaceBoundary &bc = params->variables[v].bc;
+        if (bc.left == BOUNDARY_PERIODIC) periodic = true;
+        if (bc.bottom == BOUNDARY_PERIODIC || bc.top == BOUNDARY_PERIODIC) split_y = false;
+        if (bc.back == BOUNDARY_PERIODIC || bc.front == BOUNDARY_PERIODIC) split_z = false;
+    }
+
+    // Tile edge: the local grid, halo and row padding included, in half the L2
+    int edge = params->BLOCK_WIDTH;
+    if (edge <= 0) {
+        long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (l2 <= 0) l2 = TILE_DEFAULT_L2;
+        const size_t budget = (size_t)l2 / 2;
+        SimParams local = *params;
+        local.BLOCK_STEPS = 0;
+        const int arrays = 4 + fieldBufferCount(&local);
+        double cells = (double)budget / (arrays * sizeof(Real));
+        int axes = 1;
+        if (split_y) ++axes; else cells /= NY;
+        if (split_z) ++axes; else if (is3D) cells /= NZ;
+        edge = (int)std::pow(cells, 1.0 / axes) - 2 * halo;
+        while (edge > 4 * halo && localGridBytes(params, edge, halo, split_y, split_z) > budget) --edge;
+        // Below four halo widths the redundant work would exceed the gain
+        if (edge < 4 * halo) {
+            edge = 4 * halo;
+            std::fprintf(stderr, "Note: the tiles of BLOCK_STEPS = %d do not fit in half the L2 cache; "
+                                 "using %d cells per edge.\n", params->BLOCK_STEPS, edge);
+        }
+    }
+    tb->height = (split_y && edge < NY - 2) ? edge : NY - 2;
+    tb->depth  = !is3D ? 1 : (split_z && edge < NZ - 2) ? edge : NZ - 2;
+    tb->ytiles = (NY - 2 + tb->height - 1) / tb->height;
+    tb->ztiles = is3D ? (NZ - 2 + tb->depth - 1) / tb->depth : 1;
+
+    // At least one tile per thread when the edge is sized from the cache
+    int width = (edge < interior) ? edge : interior;
+    const int others = tb->ytiles * tb->ztiles;
+    if (params->BLOCK_WIDTH <= 0 && ((interior + width - 1) / width) * others < params->NUM_THREADS) {
+        const int slabs = (params->NUM_THREADS + others - 1) / others;
+        width = (interior + slabs - 1) / slabs;
+    }
+
+    tb->steps  = params->BLOCK_STEPS;
+    tb->width  = width;
+    tb->xtiles = (interior + width - 1) / width;
+    tb->ntiles = tb->xtiles * others;
+    tb->tile_start  = (int*)std::malloc((tb->xtiles + 1) * sizeof(int));
+    tb->owned_first = (int*)std::malloc(tb->xtiles * sizeof(int));
+    tb->owned_count = (int*)std::malloc(tb->xtiles * sizeof(int));
+
+    // Count the columns of every slab, then fill the lists
+    int total = 0;
+    for (int t = 0; t < tb->xtiles; ++t) {
+        const int X0 = 1 + t * width;
+        const int X1 = (X0 + width < NX - 1) ? X0 + width : NX - 1;
+        const int n = tileColumns(X0, X1, halo, NX, periodic, nullptr, nullptr, nullptr);
+        tb->tile_start[t] = total;
+        tb->owned_count[t] = X1 - X0;
+        if (n > tb->max_cols) tb->max_cols = n;
+        total += n;
+    }
+    tb->tile_start[tb->xtiles] = total;
+    tb->col_global = (int*)std::malloc(total * sizeof(int));
+    tb->col_role   = (char*)std::malloc(total);
+    if (!tb->tile_start || !tb->owned_first || !tb->owned_count || !tb->col_global || !tb->col_role) {
+        std::fprintf(stderr, "Error: Could not allocate the temporal blocking tables.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    for (int t = 0; t < tb->xtiles; ++t) {
+        const int X0 = 1 + t * width;
+        const int X1 = X0 + tb->owned_count[t];
+        tileColumns(X0, X1, halo, NX, periodic, tb->col_global + tb->tile_start[t],
+                    tb->col_role + tb->tile_start[t], &tb->owned_first[t]);
+    }
+
+    // Largest local extent along y and z
+    tb->max_rows = 0;
+    for (int t = 0; t < tb->ytiles; ++t) {
+        int lo, hi;
+        tileSpan(1 + t * tb->height, 1 + (t + 1) * tb->height, halo, NY, &lo, &hi);
+        if (hi - lo > tb->max_rows) tb->max_rows = hi - lo;
+    }
+    tb->max_planes = NZ;
+    if (is3D) {
+        tb->max_planes = 0;
+        for (int t = 0; t < tb->ztiles; ++t) {
+            int lo, hi;
+            tileSpan(1 + t * tb->depth, 1 + (t + 1) * tb->depth, halo, NZ, &lo, &hi);
+            if (hi - lo > tb->max_planes) tb->max_planes = hi - lo;
+        }
+    }
+
+    // One local grid per thread; it is never blocked itself
+    SimParams local = *params;
+    local.Num_X = tb->max_cols;
+    local.Num_Y = tb->max_rows;
+    local.Num_Z = tb->max_planes;
+    local.BLOCK_STEPS = 0;
+    local.global_NY = NY;
+    local.global_NZ = NZ;
+    fieldStrides(&local, tb->strides);
+    const int arrays = 4 + fieldBufferCount(&local);
+    const size_t arrayBytes = fieldArrayBytes(&local, tb->strides);
+
+    tb->nworkspaces = params->NUM_THREADS;
+    tb->ws = (TileWorkspace*)std::malloc(tb->nworkspaces * sizeof(TileWorkspace));
+    if (!tb->ws) {
+        std::fprintf(stderr, "Error: Could not allocate the temporal blocking workspaces.\n");
+        std::exit(EXIT_FAILURE);
+    }
+    for (int w = 0; w < tb->nworkspaces; ++w) {
+        TileWorkspace *ws = &tb->ws[w];
+        ws->params = local;
+        // Two generations of phi and temp plus the intermediate buffers
+        createArena(&ws->arena, arrays, arrayBytes);
+        ws->phi  = arenaAlloc(&ws->arena);
+        ws->temp = arenaAlloc(&ws->arena);
+        allocateFieldBuffers(&ws->params, &ws->fb, &ws->arena);
+        ws->fb.phi_new  = arenaAlloc(&ws->arena);
+        ws->fb.temp_new = arenaAlloc(&ws->arena);
+    }
+
+    if (is3D) {
+        std::printf("Temporal blocking: up to %d steps per block, %d tile(s) of %d x %d x %d cells, "
+                    "halo %d, %.0f KiB per local grid\n", tb->steps, tb->ntiles, tb->width,
+                    tb->height, tb->depth, halo, arrays * arrayBytes / 1024.0);
+    } else {
+        std::printf("Temporal blocking: up to %d steps per block, %d tile(s) of %d x %d cells, "
+                    "halo %d, %.0f KiB per local grid\n", tb->steps, tb->ntiles, tb->width,
+                    tb->height, halo, arrays * arrayBytes / 1024.0);
+    }
+}
+
+/**
+ * @brief Number of steps in the block that starts at step t.
+ *
+ * Blocks end at every output step (multiples of timebreak) and at the last step.
+ */
+int temporalBlockLength(const SimParams *params, const TemporalBlocking *tb, int t) {
+    int n = tb->steps;
+    const int to_output = params->timebreak - (t - 1) % params->timebreak;
+    const int to_end = params->total_timesteps - t + 1;
+    if (n > to_output) n = to_output;
+    if (n > to_end) n = to_end;
+    return n;
+}
+
+/**
+ * @brief Copy one column of a tile, ny rows of nz cells, between grids of
+ * different strides; dst and src point at its first cell. In 2D the column
+ * is one contiguous row of ny cells and nz is ignored.
+ */
+template <int DIM>
+static void copyTileColumn(Real *dst, int dst_sy, const Real *src, int src_sy, int ny, int nz) {
+    if (DIM == 2) {
+        std::memcpy(dst, src, (size_t)ny * sizeof(Real));
+        return;
+    }
+    for (int j = 0; j < ny; ++j) {
+        std::memcpy(dst + (size_t)j * dst_sy, src + (size_t)j * src_sy, (size_t)nz * sizeof(Real));
+    }
+}
+
+/**
+ * @brief Rebuild the x ghost columns of a local field after a substep.
+ *
+ * Runs after the y/z face kernels, which also write the edge cells of the
+ * periodic ghost columns; those are restored from the global field, where
+ * they are never written, before the interior rows are refilled.
+ *
+ * @param arr      Local field
+ * @param global   Global field of the same variable, at row and plane 0 of the tile
+ * @param gstrides Strides of the global field
+ * @param cols     Global column of each local column
+ * @param role     ColumnRole of each local column
+ * @param ncols    Number of local columns
+ * @param bc       Boundary conditions of the variable
+ * @param g        Interior bounds of the local grid
+ */
+template <int DIM>
+static void rebuildGhostColumns(Real *arr, const Real *global, const int gstrides[], const int *cols,
+                                const char *role, int ncols, FaceBoundary bc, const Interior<DIM> &g) {
+    const size_t run = (size_t)g.runLength() * sizeof(Real);
+    const int nz = g.kend + 1;
+    for (int c = 0; c < ncols; ++c) {
+        int src = -1;
+        switch (role[c]) {
+            case COL_GHOST:
+                if ((cols[c] == 0 ? bc.left : bc.right) == BOUNDARY_NOFLUX) {
+                    src = (cols[c] == 0) ? c + 1 : c - 1;
+                }
+                break;
+            case COL_WRAP_HI:
+                copyTileColumn<DIM>(arr + (size_t)c * g.sx, g.sy, global + (size_t)cols[c] * gstrides[0],
+                                    gstrides[1], g.NY, nz);
+                src = c + 2;
+                break;
+            case COL_WRAP_LO:
+                copyTileColumn<DIM>(arr + (size_t)c * g.sx, g.sy, global + (size_t)cols[c] * gstrides[0],
+                                    gstrides[1], g.NY, nz);
+                src = c - 2;
+                break;
+            default:
+                break;
+        }
+        if (src < 0 || src >= ncols) continue;
+        for (int r = 0; r < g.runs(); ++r) {
+            std::memcpy(arr + g.runStart(c, r), arr + g.runStart(src, r), run);
+        }
+    }
+}
+
+/**
+ * @brief FieldBuffers whose arrays start `shift` elements further on (null stays null).
+ *
+ * Lets the kernels run on a window of columns of a larger grid; also used
+ * by the domain decomposition (decomposition.cpp).
+ */
+FieldBuffers shiftFieldBuffers(const FieldBuffers &fb, size_t shift) {
+    FieldBuffers w;
+    Real * const *src[] = {
+        &fb.phi_new, &fb.temp_new, &fb.dphi_dt, &fb.dfdphi, &fb.temp_star,
+        &fb.ac, &fb.ac_right, &fb.ac_left, &fb.ac_top, &fb.ac_bottom,
+        &fb.ac_p, &fb.ac_p_right, &fb.ac_p_left, &fb.ac_p_top, &fb.ac_p_bottom,
+        &fb.DERX_c, &fb.DERY_c,
+        &fb.DERX_right, &fb.DERX_left, &fb.DERY_top, &fb.DERY_bottom,
+        &fb.DERY_right, &fb.DERY_left, &fb.DERX_top, &fb.DERX_bottom };
+    Real **dst[] = {
+        &w.phi_new, &w.temp_new, &w.dphi_dt, &w.dfdphi, &w.temp_star,
+        &w.ac, &w.ac_right, &w.ac_left, &w.ac_top, &w.ac_bottom,
+        &w.ac_p, &w.ac_p_right, &w.ac_p_left, &w.ac_p_top, &w.ac_p_bottom,
+        &w.DERX_c, &w.DERY_c,
+        &w.DERX_right, &w.DERX_left, &w.DERY_top, &w.DERY_bottom,
+        &w.DERY_right, &w.DERY_left, &w.DERX_top, &w.DERX_bottom };
+    for (size_t n = 0; n < sizeof(dst) / sizeof(dst[0]); ++n) {
+        *dst[n] = *src[n] ? *src[n] + shift : nullptr;
+    }
+    return w;
+}
+
+/**
+ * @brief Advance one tile through nsteps steps and write back its own cells.
+ */
+template <int DIM>
+static void advanceTile(int tile, TemporalBlocking *tb, TileWorkspace *ws, Real *phi, Real *temp,
+                        FieldBuffers *fb, const SimParams *params, const KernelTable *kt,
+                        Accum r[], Accum r2[], int strides[], int step, int nsteps) {
+    const int slab = tile / (tb->ytiles * tb->ztiles);
+    const int first = tb->tile_start[slab];
+    const int ncols = tb->tile_start[slab + 1] - first;
+    const int *cols = tb->col_global + first;
+    const char *role = tb->col_role + first;
+    int *ls = tb->strides;
+    const int halo = tb->steps + 1;
+
+    // Owned rows [Y0, Y1) and planes [Z0, Z1), and the local ones [y0, y1)
+    // and [z0, z1), ghosts included on the faces of the global grid
+    const int NY = params->Num_Y;
+    const int NZ = params->Num_Z;
+    int Y0 = 1 + (tile / tb->ztiles % tb->ytiles) * tb->height;
+    int Y1 = (Y0 + tb->height < NY - 1) ? Y0 + tb->height : NY - 1;
+    int y0, y1;
+    tileSpan(Y0, Y1, halo, NY, &y0, &y1);
+    int Z0 = 0, Z1 = 1, z0 = 0, z1 = NZ;
+    if (DIM == 3) {
+        Z0 = 1 + (tile % tb->ztiles) * tb->depth;
+        Z1 = (Z0 + tb->depth < NZ - 1) ? Z0 + tb->depth : NZ - 1;
+        tileSpan(Z0, Z1, halo, NZ, &z0, &z1);
+        if (z0 == 0) Z0 = 0;
+        if (z1 == NZ) Z1 = NZ;
+    }
+    if (y0 == 0) Y0 = 0;
+    if (y1 == NY) Y1 = NY;
+    const int ny = y1 - y0;
+    const int nz = z1 - z0;
+    const size_t base = (size_t)y0 * strides[1] + z0;
+
+    // Full local grid, for the ghost columns
+    SimParams *lp = &ws->params;
+    lp->Num_X = ncols;
+    lp->Num_Y = ny;
+    if (DIM == 3) lp->Num_Z = nz;
+    const Interior<DIM> g(lp, ls);
+
+    // Both generations start from the same data, so cells the kernels never
+    // write (ghost edges, outermost halo layers) agree after every swap
+    FieldBuffers lfb = ws->fb;
+    Real *lphi = ws->phi;
+    Real *ltemp = ws->temp;
+    for (int c = 0; c < ncols; ++c) {
+        const size_t off = (size_t)c * ls[0];
+        const size_t src = (size_t)cols[c] * strides[0] + base;
+        copyTileColumn<DIM>(lphi + off, ls[1], phi + src, strides[1], ny, nz);
+        copyTileColumn<DIM>(lfb.phi_new + off, ls[1], phi + src, strides[1], ny, nz);
+        copyTileColumn<DIM>(ltemp + off, ls[1], temp + src, strides[1], ny, nz);
+        copyTileColumn<DIM>(lfb.temp_new + off, ls[1], temp + src, strides[1], ny, nz);
+    }
+
+    // The y and z faces of the global grid keep their conditions; halo
+    // sides are left alone
+    FaceBoundary phiBC = {}, tempBC = {};
+    for (int v = 0; v < params->numVariables; ++v) {
+        if (std::strcmp(params->variables[v].varName, "phi") == 0)  phiBC  = params->variables[v].bc;
+        if (std::strcmp(params->variables[v].varName, "temp") == 0) tempBC = params->variables[v].bc;
+    }
+    FaceBoundary phiTile = phiBC, tempTile = tempBC;
+    if (y0 > 0)  phiTile.bottom = tempTile.bottom = BOUNDARY_UNDEFINED;
+    if (y1 < NY) phiTile.top    = tempTile.top    = BOUNDARY_UNDEFINED;
+    if (z0 > 0)  phiTile.back   = tempTile.back   = BOUNDARY_UNDEFINED;
+    if (z1 < NZ) phiTile.front  = tempTile.front  = BOUNDARY_UNDEFINED;
+    const BoundaryKernel phiFaces = selectBoundaryKernel(params, phiTile);
+    const BoundaryKernel tempFaces = selectBoundaryKernel(params, tempTile);
+
+    // Halo sides lose one valid layer per substep, so the kernels run on a
+    // window that shrinks by one layer there each substep (the trapezoid);
+    // sides on a face of the global grid keep their ghost layer
+    const bool shrink_lo = (role[0] != COL_GHOST);
+    const bool shrink_hi = (role[ncols - 1] != COL_GHOST);
+
+    for (int s = 0; s < nsteps; ++s) {
+        const int lo = shrink_lo ? s : 0;
+        const int hi = shrink_hi ? s : 0;
+        const int ylo = (y0 > 0) ? s : 0;
+        const int yhi = (y1 < NY) ? s : 0;
+        const int zlo = (z0 > 0) ? s : 0;
+        const int zhi = (z1 < NZ) ? s : 0;
+        const size_t shift = (size_t)lo * ls[0] + (size_t)ylo * ls[1] + zlo;
+        lp->Num_X = ncols - lo - hi;
+        lp->Num_Y = ny - ylo - yhi;
+        if (DIM == 3) lp->Num_Z = nz - zlo - zhi;
+        lp->global_x = cols + lo;
+        lp->global_y0 = y0 + ylo;
+        lp->global_z0 = z0 + zlo;
+        FieldBuffers wfb = shiftFieldBuffers(lfb, shift);
+        Real *wphi = lphi + shift;
+        Real *wtemp = ltemp + shift;
+
+        // Boundary conditions and update of phi
+        phiFaces.faceY(wphi, lp, ls, 1, lp->Num_X - 1);
+        if (phiFaces.faceZ) phiFaces.faceZ(wphi, lp, ls, 1, lp->Num_X - 1);
+        rebuildGhostColumns<DIM>(lphi, phi + base, strides, cols, role, ncols, phiBC, g);
+        if (lp->FUSED_KERNEL) {
+            kt->updatePhiFused(wphi, wtemp, &wfb, lp, r, ls, step + s);
+        } else {
+            kt->computedfdphi(wphi, wfb.dfdphi, wtemp, lp, ls);
+            kt->computeGradientPhi(wphi, &wfb, lp, r, ls);
+            kt->computeAnisotropy(&wfb, lp, ls);
+            kt->updatePhi(wphi, &wfb, lp, r, ls, step + s);
+        }
+
+        // Boundary conditions and update of temp
+        tempFaces.faceY(wtemp, lp, ls, 1, lp->Num_X - 1);
+        if (tempFaces.faceZ) tempFaces.faceZ(wtemp, lp, ls, 1, lp->Num_X - 1);
+        rebuildGhostColumns<DIM>(ltemp, temp + base, strides, cols, role, ncols, tempBC, g);
+        kt->updateTemp(wtemp, &wfb, lp, ls, r2);
+
+        // The new generation becomes the current one
+        Real *tmp = lphi;  lphi = lfb.phi_new;   lfb.phi_new = tmp;
+        tmp = ltemp;         ltemp = lfb.temp_new; lfb.temp_new = tmp;
+    }
+
+    // Owned cells go to the global new generation; the global fields are
+    // still read by the other tiles
+    const int c0 = tb->owned_first[slab];
+    const size_t own = (size_t)Y0 * strides[1] + Z0;
+    const size_t lown = (size_t)(Y0 - y0) * ls[1] + (Z0 - z0);
+    for (int c = c0; c < c0 + tb->owned_count[slab]; ++c) {
+        const size_t off = (size_t)c * ls[0] + lown;
+        const size_t dst = (size_t)cols[c] * strides[0] + own;
+        copyTileColumn<DIM>(fb->phi_new + dst, strides[1], lphi + off, ls[1], Y1 - Y0, Z1 - Z0);
+        copyTileColumn<DIM>(fb->temp_new + dst, strides[1], ltemp + off, ls[1], Y1 - Y0, Z1 - Z0);
+    }
+}
+
+/**
+ * @brief Advance phi and temp from step `step` through step + nsteps - 1.
+ *
+ * Called by every thread of the team: tiles are shared out with an omp for
+ * and each writes its owned cells into fb->phi_new and fb->temp_new, the
+ * next generation of the fields. The caller swaps the generations afterwards.
+ *
+ * @param phi     Phase-field array
+ * @param temp    Temperature array
+ * @param fb      Global buffers; phi_new and temp_new receive the tiles
+ * @param tb      Tiles from setupTemporalBlocking
+ * @param params  Simulation parameters
+ * @param kt      Selected kernels, applied to the local grids
+ * @param r       Inverse grid spacings: [1/dx, 1/dy, 1/dz]
+ * @param r2      Squared inverse grid spacings
+ * @param strides Strides for flattening 3D indices: [NY*NZ, NZ, 1]
+ * @param step    Number of the first step (noise counter)
+ * @param nsteps  Steps in this block, at most tb->steps
+ */
+void advanceTemporalBlock(Real *phi, Real *temp, FieldBuffers *fb, TemporalBlocking *tb,
+                          const SimParams *params, const KernelTable *kt,
+                          Accum r[], Accum r2[], int strides[], int step, int nsteps) {
+    #pragma omp for schedule(static)
+    for (int tile = 0; tile < tb->ntiles; ++tile) {
+#ifdef _OPENMP
+        TileWorkspace *ws = &tb->ws[omp_get_thread_num()];
+#else
+        TileWorkspace *ws = &tb->ws[0];
+#endif
+        // The kernels' orphaned omp for bind to this one-thread region, so
+        // the tile is advanced entirely by the thread that owns it
+        #pragma omp parallel num_threads(1)
+        {
+            if (params->DIM == 3) {
+                advanceTile<3>(tile, tb, ws, phi, temp, fb, params, kt, r, r2, strides, step, nsteps);
+            } else {
+                advanceTile<2>(tile, tb, ws, phi, temp, fb, params, kt, r, r2, strides, step, nsteps);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Release the column lists and the per-thread workspaces.
+ */
+void freeTemporalBlocking(TemporalBlocking *tb) {
+    for (int w = 0; w < tb->nworkspaces; ++w) {
+        releaseArena(&tb->ws[w].arena);
+    }
+    std::free(tb->ws);
+    std::free(tb->tile_start);
+    std::free(tb->owned_first);
+    std::free(tb->owned_count);
+    std::free(tb->col_global);
+    std::free(tb->col_role);
+    std::memset(tb, 0, sizeof(*tb));
+}
@@ -0,0 +1,303 @@
+#include "header.hpp"
+#include "kernels.hpp"
+#include "interval_timer.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * tile_activity.cpp
+ *
+ * Tile activity map (TILE_SKIP = 1). Far from the crystal both fields stop
+ * changing for long stretches of a run, so the interior is split into tiles
+ * of TILE_SIZE cells per edge, each with one flag per field, and the kernels
+ * skip the tiles whose flag is clear (Interior::nextSegment). The phi
+ * kernels record the largest |dphi_dt| of every tile they update, the
+ * explicit temperature update the largest |grad T| (recordPhiActivity,
+ * recordTempActivity). From these, after every step, a tile is live in phi
+ * when dt |dphi_dt| exceeds TILE_TOL, and live in temp when the bound
+ *   dt (2 |grad T| (1/dx + 1/dy [+ 1/dz]) + K |dphi_dt|)
+ * on the change of any of its temperatures does. The next step updates phi
+ * on the tiles next to (or on) a tile live in phi, and temp on those next
+ * to a tile live in either field, so a quiescent tile wakes up as soon as a
+ * neighbour changes. A tile that falls asleep gets its new values in both
+ * generations of the field, and a zero dphi_dt, so it keeps them exactly
+ * while skipped and adds no latent heat.
+ *
+ * With the default TILE_TOL = 0 only tiles that did not change at all fall
+ * asleep: their stencils, and those of their neighbours, hold the same
+ * values at the next step, so skipping them changes nothing. A positive
+ * TILE_TOL is an approximation: an asleep tile misses up to the change per
+ * step measured at its last update. The missed change is summed per tile
+ * and field over the run, and the tile is kept awake once the sum would
+ * exceed TILE_DRIFT. With an implicit temperature
+ * solver (TEMP_SOLVER = ADI or MULTIGRID) only phi tiles are skipped.
+ *  - setupTileActivity: allocate the map and publish it through params->tiles
+ *  - trackTileActivity: flags of the next step, after the phi and temp updates
+ *  - reportTileInterval / startTileInterval: skipped tiles and throughput
+ *    of each output interval
+ *  - printTileReport: skipped tiles over the whole run
+ *  - freeTileActivity: release the map
+ */
+
+// Tiles updated in the step being classified: reduction variables of an
+// orphaned omp for must be shared in the enclosing parallel region
+static long phiTiles, tempTiles;
+
+/**
+ * @brief Allocate the tile map of the grid and set params->tiles (null unless
+ * TILE_SKIP or LTS, whose levels select tiles through its flags).
+ *
+ * Every tile starts active in both fields. Neighbours wrap around the
+ * faces that are periodic in phi or temp.
+ */
+void setupTileActivity(SimParams *params, TileMap *tm) {
+    std::memset(tm, 0, sizeof(*tm));
+    params->tiles = nullptr;
+    if (!params->TILE_SKIP && !params->LTS) return;
+
+    const int T = params->TILE_SIZE;
+    tm->size = T;
+    tm->ntx = (params->Num_X - 2 + T - 1) / T;
+    tm->nty = (params->Num_Y - 2 + T - 1) / T;
+    tm->ntz = (params->DIM == 3) ? (params->Num_Z - 2 + T - 1) / T : 1;
+    tm->perPlane = tm->nty * tm->ntz;
+    tm->count = tm->ntx * tm->perPlane;
+    tm->skip_temp = (params->TEMP_SOLVER == TEMP_EXPLICIT);
+
+    tm->change = (double*)std::calloc((size_t)2 * tm->count, sizeof(double));
+    tm->drift  = (double*)std::calloc((size_t)2 * tm->count, sizeof(double));
+    unsigned char **flags[5] = { &tm->phi_on, &tm->temp_on, &tm->next_phi, &tm->next_temp, &tm->live };
+    for (int f = 0; f < 5; ++f) {
+        *flags[f] = (unsigned char*)std::calloc(tm->count, 1);
+    }
+    std::memset(tm->phi_on, 1, tm->count);
+    std::memset(tm->temp_on, 1, tm->count);
+    // Records of every x-plane, ghost planes included (never written)
+    tm->phi_rate  = (double*)std::calloc((size_t)params->Num_X * tm->perPlane, sizeof(double));
+    tm->temp_grad = (double*)std::calloc((size_t)params->Num_X * tm->perPlane, sizeof(double));
+
+    const char *fields[2] = { "phi", "temp" };
+    for (int f = 0; f < 2; ++f) {
+        const VariableBoundary *vb = findVariableBoundary(fields[f], params);
+        if (!vb) continue;
+        const FaceBoundary &bc = vb->bc;
+        tm->wrap[0] |= bc.left == BOUNDARY_PERIODIC || bc.right == BOUNDARY_PERIODIC;
+        tm->wrap[1] |= bc.bottom == BOUNDARY_PERIODIC || bc.top == BOUNDARY_PERIODIC;
+        tm->wrap[2] |= params->DIM == 3 && (bc.back == BOUNDARY_PERIODIC || bc.front == BOUNDARY_PERIODIC);
+    }
+    params->tiles = tm;
+}
+
+/**
+ * @brief Copy the new values of one field over the cells of tile t into its
+ * current generation, and zero rate over them when it is not null.
+ */
+template <int DIM>
+static void freezeTile(const TileMap *tm, int t, Real *cur, const Real *next, Real *rate,
+                       const SimParams *params, const int strides[]) {
+    const Interior<DIM> g(params, strides);
+    const int T = tm->size;
+    const int tx = t / tm->perPlane, ty = (t / tm->ntz) % tm->nty, tz = t % tm->ntz;
+    const int i0 = 1 + tx * T, i1 = (i0 + T < g.NX - 1) ? i0 + T : g.NX - 1;
+    // Runs of the tile and the cells of each, as in Interior::tileRow
+    const int r0 = (DIM == 3) ? ty * T : 0;
+    const int r1 = (DIM == 3) ? ((r0 + T < g.runs()) ? r0 + T : g.runs()) : 1;
+    const int n0 = ((DIM == 3) ? tz : ty) * T;
+    const int n1 = (n0 + T < g.runLength()) ? n0 + T : g.runLength();
+    for (int i = i0; i < i1; ++i) {
+        for (int r = r0; r < r1; ++r) {
+            const int start = g.runStart(i, r);
+            std::memcpy(cur + start + n0, next + start + n0, (size_t)(n1 - n0) * sizeof(Real));
+            if (rate) {
+                for (int n = n0; n < n1; ++n) rate[start + n] = 0.0;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Flags of the next step from the activity recorded by the kernels
+ * of the step just taken.
+ *
+ * Called by every thread of the team after updateTemp (and trackNarrowBand)
+ * and before the generations are swapped.
+ */
+void trackTileActivity(Real *phi, Real *temp, FieldBuffers *fb, TileMap *tm, const SimParams *params, int strides[]) {
+    const int T = tm->size;
+    const int per = tm->perPlane;
+    const double tol = params->TILE_TOL;
+    const double budget = params->TILE_DRIFT;
+    const double dt = params->dt;
+    const double K = std::fabs(params->K);
+    double rsum = 1.0 / params->dx + 1.0 / params->dy;
+    if (params->DIM == 3) rsum += 1.0 / params->dz;
+
+    #pragma omp single
+    {
+        phiTiles = 0;
+        tempTiles = 0;
+    }
+
+    // Largest rates of every tile over its x-planes; the records start over
+    #pragma omp for reduction(+ : phiTiles, tempTiles)
+    for (int t = 0; t < tm->count; ++t) {
+        const int i0 = 1 + (t / per) * T;
+        const int i1 = (i0 + T < params->Num_X - 1) ? i0 + T : params->Num_X - 1;
+        double rate = 0.0, grad = 0.0;
+        for (int i = i0; i < i1; ++i) {
+            double *pr = tm->phi_rate + (size_t)i * per + t % per;
+            double *tg = tm->temp_grad + (size_t)i * per + t % per;
+            if (*pr > rate) rate = *pr;
+            if (*tg > grad) grad = *tg;
+            *pr = 0.0;
+            *tg = 0.0;
+        }
+        unsigned char live = 0;
+        if (tm->phi_on[t]) {
+            ++phiTiles;
+            tm->change[2 * t] = dt * rate;
+            if (tm->change[2 * t] > tol) live |= 1;
+        }
+        if (tm->skip_temp && tm->temp_on[t]) {
+            ++tempTiles;
+            tm->change[2 * t + 1] = dt * (2.0 * grad * rsum + K * rate);
+            if (tm->change[2 * t + 1] > tol) live |= 2;
+        }
+        tm->live[t] = live;
+    }
+
+    // Next flags from the live tiles around each; tiles falling asleep keep
+    // their new values in both generations
+    const int n[3] = { tm->ntx, tm->nty, tm->ntz };
+    #pragma omp for
+    for (int t = 0; t < tm->count; ++t) {
+        const int c[3] = { t / per, (t / tm->ntz) % tm->nty, t % tm->ntz };
+        unsigned char any = 0;
+        for (int dx = -1; dx <= 1; ++dx) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dz = -1; dz <= 1; ++dz) {
+                    int q[3] = { c[0] + dx, c[1] + dy, c[2] + dz };
+                    bool inside = true;
+                    for (int a = 0; a < 3; ++a) {
+                        if (q[a] >= 0 && q[a] < n[a]) continue;
+                        if (tm->wrap[a] && n[a] > 1) {
+                            q[a] = (q[a] + n[a]) % n[a];
+                        } else {
+                            inside = false;
+                        }
+                    }
+                    if (inside) any |= tm->live[(q[0] * tm->nty + q[1]) * tm->ntz + q[2]];
+                }
+            }
+        }
+        tm->next_phi[t] = any & 1;
+        tm->next_temp[t] = tm->skip_temp ? (any != 0) : 1;
+        // An asleep tile misses its last change per step (0 unless TILE_TOL > 0)
+        unsigned char *next[2] = { &tm->next_phi[t], &tm->next_temp[t] };
+        for (int f = 0; f < 2; ++f) {
+            if (*next[f]) continue;
+            double &missed = tm->drift[2 * t + f];
+            if (missed + tm->change[2 * t + f] > budget) {
+                *next[f] = 1;
+            } else {
+                missed += tm->change[2 * t + f];
+            }
+        }
+
+        if (tm->phi_on[t] && !tm->next_phi[t]) {
+            if (params->DIM == 3) {
+                freezeTile<3>(tm, t, phi, fb->phi_new, fb->dphi_dt, params, strides);
+            } else {
+                freezeTile<2>(tm, t, phi, fb->phi_new, fb->dphi_dt, params, strides);
+            }
+        }
+        if (tm->temp_on[t] && !tm->next_temp[t]) {
+            if (params->DIM == 3) {
+                freezeTile<3>(tm, t, temp, fb->temp_new, nullptr, params, strides);
+            } else {
+                freezeTile<2>(tm, t, temp, fb->temp_new, nullptr, params, strides);
+            }
+        }
+    }
+
+    #pragma omp single
+    {
+        unsigned char *f = tm->phi_on; tm->phi_on = tm->next_phi; tm->next_phi = f;
+        f = tm->temp_on; tm->temp_on = tm->next_temp; tm->next_temp = f;
+        tm->phi_tiles = phiTiles;
+        tm->temp_tiles = tm->skip_temp ? tempTiles : tm->count;
+        tm->interval_phi += tm->phi_tiles;
+        tm->interval_temp += tm->temp_tiles;
+        tm->interval_steps++;
+        tm->total_phi += tm->phi_tiles;
+        tm->total_temp += tm->temp_tiles;
+        tm->total_steps++;
+    }
+}
+
+/**
+ * @brief Start timing an output interval; called serially (omp single).
+ */
+void startTileInterval(TileMap *tm) {
+    tm->interval_start = wallSeconds();
+}
+
+/**
+ * @brief Skipped tiles and throughput of the output interval ending at
+ * step; called serially (omp single), before the output is written.
+ *
+ * The throughput counts every interior cell, as the time-loop report does,
+ * so it compares directly with a run without tile skipping.
+ */
+void reportTileInterval(TileMap *tm, const SimParams *params, int step) {
+    const double interior = interiorCells(params);
+    const double seconds = wallSeconds() - tm->interval_start;
+    const int steps = tm->interval_steps;
+    const double updates = (steps > 0) ? (double)steps * tm->count : 1.0;
+    std::printf("Tile skipping, steps %d-%d: %.2f%% of phi and %.2f%% of temp tiles skipped, %.3f s, %.2f Mcell-updates/s\n",
+                step - steps + 1, step, 100.0 * (1.0 - tm->interval_phi / updates),
+                100.0 * (1.0 - tm->interval_temp / updates), seconds,
+                cellRate(interior, steps, seconds));
+    tm->interval_phi = 0.0;
+    tm->interval_temp = 0.0;
+    tm->interval_steps = 0;
+}
+
+/**
+ * @brief Skipped tiles over the run, and with TILE_TOL > 0 the largest
+ * change a tile missed; prints nothing unless TILE_SKIP.
+ */
+void printTileReport(const TileMap *tm, const SimParams *params) {
+    if (!params->TILE_SKIP || tm->total_steps == 0) return;
+    const double updates = (double)tm->total_steps * tm->count;
+    std::printf("Tile skipping: %.2f%% of phi and %.2f%% of temp tile updates skipped over %ld steps, %d tiles of %d^%d cells\n",
+                100.0 * (1.0 - tm->total_phi / updates), 100.0 * (1.0 - tm->total_temp / updates),
+                tm->total_steps, tm->count, tm->size, params->DIM);
+    if (params->TILE_TOL > 0.0) {
+        double phi = 0.0, temp = 0.0;
+        for (int t = 0; t < tm->count; ++t) {
+            if (tm->drift[2 * t] > phi) phi = tm->drift[2 * t];
+            if (tm->drift[2 * t + 1] > temp) temp = tm->drift[2 * t + 1];
+        }
+        std::printf("  largest change missed by a tile: phi %.3e, temp %.3e (TILE_DRIFT = %g)\n",
+                    phi, temp, params->TILE_DRIFT);
+    }
+}
+
+/**
+ * @brief Release the tile map.
+ */
+void freeTileActivity(TileMap *tm) {
+    std::free(tm->phi_on);
+    std::free(tm->temp_on);
+    std::free(tm->next_phi);
+    std::free(tm->next_temp);
+    std::free(tm->live);
+    std::free(tm->change);
+    std::free(tm->drift);
+    std::free(tm->phi_rate);
+    std::free(tm->temp_grad);
+    std::memset(tm, 0, sizeof(*tm));
+}
@@ -0,0 +1,166 @@
+#include "header.hpp"
+#include <cmath>
+
+/*
+ * timestep.cpp
+ *
+ * Adaptive time stepping (ADAPTIVE_DT = 1). Each step uses the largest dt
+ * allowed by
+ *  - the explicit stability limit of the phi and temp updates (phi only
+ *    with an implicit TEMP_SOLVER, the phi reaction term only with
+ *    PHI_SOLVER = IMEX or SPECTRAL), from the parameters, scaled by DT_SAFETY
+ *  - DT_PHI_TOL / max |dphi/dt| of the previous step, when DT_PHI_TOL > 0,
+ *    so that dt grows as the interface slows down
+ *  - DT_GROWTH times the previous dt
+ * and steps are shortened to land exactly on the output times (multiples
+ * of output_time) and on end_time.
+ *  - phiStiffnessBounds: stiffness bounds of the phase-field terms
+ *  - stableTimestep: explicit stability limit from the parameters
+ *  - setupTimeControl: clock, output schedule and the first dt
+ *  - maxAbsInterior: largest |value| of a field over the interior cells
+ *  - advanceClock: move the clock past a step and choose the next dt
+ */
+
+// Largest factor by which dt grows from one step to the next
+static constexpr double DT_GROWTH = 1.1;
+
+/**
+ * @brief Stiffness bounds of the phase-field equation.
+ *
+ * tau dphi/dt = div J + f(phi): the flux J grows with the gradient at most
+ * as fast as D = epsilon^2 amax (amax + c delta), amax = 1 + |delta|, c = j
+ * in 2D (a' <= j delta) and 33 for the 3D cubic flux, and
+ * |df/dphi| <= L = 3/4 + |alpha|/2 on [0, 1].
+ *
+ * @param params Simulation parameters (epsilon, delta, j, alpha)
+ * @param D      Bound of the flux stiffness
+ * @param L      Bound of the reaction stiffness
+ */
+void phiStiffnessBounds(const SimParams *params, double *D, double *L) {
+    const double d = std::fabs(params->delta);
+    const double amax = 1.0 + d;
+    const double c = (params->DIM == 3) ? 33.0 : std::abs(params->j);
+    *D = params->epsilon * params->epsilon * amax * (amax + c * d);
+    *L = 0.75 + 0.5 * std::fabs(params->alpha);
+}
+
+/**
+ * @brief Explicit (forward Euler) stability limit of one step.
+ *
+ * Temperature: dT/dt = lap T + K dphi/dt, limited by the Laplacian to
+ * dt <= 1 / (2 sum 1/dx^2). Phase field: with the bounds D and L of
+ * phiStiffnessBounds, dt <= 2 tau / (4 D sum 1/dx^2 + L).
+ * The implicit temperature solvers (TEMP_SOLVER = ADI, MULTIGRID) have no
+ * limit of their own. The IMEX phase-field step (PHI_SOLVER = IMEX,
+ * multigrid.cpp) and the spectral mode (SPECTRAL = 1, spectral.cpp)
+ * stabilize the phi flux, leaving the reaction limit dt <= 2 tau / L.
+ *
+ * @param params Simulation parameters (spacings, epsilon, delta, j, tau, alpha)
+ * @return The smallest limit of the terms stepped explicitly
+ */
+double stableTimestep(const SimParams *params) {
+    double sum_r2 = 1.0 / (params->dx * params->dx) + 1.0 / (params->dy * params->dy);
+    if (params->DIM == 3) sum_r2 += 1.0 / (params->dz * params->dz);
+
+    const double dt_temp = 1.0 / (2.0 * sum_r2);
+
+    double D, L;
+    phiStiffnessBounds(params, &D, &L);
+    if (params->SPECTRAL || params->PHI_SOLVER == PHI_IMEX) D = 0.0;
+    const double dt_phi = 2.0 * params->tau / (4.0 * D * sum_r2 + L);
+
+    if (params->SPECTRAL || params->TEMP_SOLVER != TEMP_EXPLICIT) return dt_phi;
+    return (dt_phi < dt_temp) ? dt_phi : dt_temp;
+}
+
+/**
+ * @brief Shorten dt so that the step lands on the next output time or the end.
+ *
+ * A remainder of less than two steps is split evenly rather than leaving
+ * a sliver step. Sets params->dt and the end of the step.
+ */
+static void planStep(TimeControl *tc, SimParams *params, double dt) {
+    const double next_output = (tc->outputs + 1) * tc->output_time;
+    const double target = (next_output < tc->end_time) ? next_output : tc->end_time;
+    const double remaining = target - tc->time;
+    if (remaining <= dt) {
+        dt = remaining;
+        tc->step_end = target;
+        tc->lands_on_output = (target == next_output);
+    } else {
+        if (remaining < 2.0 * dt) dt = 0.5 * remaining;
+        tc->step_end = tc->time + dt;
+        tc->lands_on_output = 0;
+    }
+    params->dt = dt;
+}
+
+/**
+ * @brief Start the clock and choose the first dt.
+ *
+ * The first step is the input dt, capped by the stability limit. Does
+ * nothing unless ADAPTIVE_DT is set; params->dt is then left alone.
+ *
+ * @param params Simulation parameters; dt is set to the first step
+ * @param tc     TimeControl to initialize
+ */
+void setupTimeControl(SimParams *params, TimeControl *tc) {
+    std::memset(tc, 0, sizeof(*tc));
+    tc->adaptive = params->ADAPTIVE_DT;
+    if (!tc->adaptive) return;
+
+    tc->end_time = params->end_time;
+    tc->output_time = params->output_time;
+    tc->dt_limit = params->DT_SAFETY * stableTimestep(params);
+    tc->dt_free = (params->dt > 0.0 && params->dt < tc->dt_limit) ? params->dt : tc->dt_limit;
+    planStep(tc, params, tc->dt_free);
+}
+
+// Shared accumulator of maxAbsInterior: a reduction variable of an orphaned
+// omp for must be shared in the enclosing parallel region
+static double interiorMax;
+
+/**
+ * @brief Largest absolute value of a field over the interior cells.
+ *
+ * Called by every thread of the team (orphaned omp for); all get the result.
+ */
+double maxAbsInterior(const Real *arr, const SimParams *params, int strides[]) {
+    const int kstart = (params->DIM == 3) ? 1 : 0;
+    const int kend   = (params->DIM == 3) ? params->Num_Z - 1 : 1;
+
+    #pragma omp single
+    interiorMax = 0.0;
+
+    #pragma omp for reduction(max : interiorMax)
+    for (int i = 1; i < params->Num_X - 1; ++i) {
+        for (int j = 1; j < params->Num_Y - 1; ++j) {
+            const Real *row = arr + (size_t)i * strides[0] + (size_t)j * strides[1];
+            for (int k = kstart; k < kend; ++k) {
+                const double v = std::fabs((double)row[k]);
+                if (v > interiorMax) interiorMax = v;
+            }
+        }
+    }
+    return interiorMax;
+}
+
+/**
+ * @brief Move the clock to the end of the step just taken and choose the next dt.
+ *
+ * @param tc     TimeControl from setupTimeControl
+ * @param params Simulation parameters; dt is set to the next step
+ * @param rate   max |dphi/dt| of the step just taken (used if DT_PHI_TOL > 0)
+ */
+void advanceClock(TimeControl *tc, SimParams *params, double rate) {
+    tc->time = tc->step_end;
+    tc->steps++;
+    tc->output_due = tc->lands_on_output;
+    if (tc->output_due) tc->outputs++;
+
+    double dt = DT_GROWTH * tc->dt_free;
+    if (dt > tc->dt_limit) dt = tc->dt_limit;
+    if (params->DT_PHI_TOL > 0.0 && rate * dt > params->DT_PHI_TOL) dt = params->DT_PHI_TOL / rate;
+    tc->dt_free = dt;
+    planStep(tc, params, dt);
+}
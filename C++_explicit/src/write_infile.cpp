@@ -36,6 +36,13 @@ void writeParameters(const char *outfile, const SimParams *params) {
     std::fprintf(fp, "dt = %g\n", params->dt);
     std::fprintf(fp, "total_steps = %d\n", params->total_timesteps);
     std::fprintf(fp, "timebreak = %d\n", params->timebreak);
+    if (params->ADAPTIVE_DT) {
+        std::fprintf(fp, "ADAPTIVE_DT = %d\n", params->ADAPTIVE_DT);
+        std::fprintf(fp, "DT_SAFETY = %g\n", params->DT_SAFETY);
+        std::fprintf(fp, "DT_PHI_TOL = %g\n", params->DT_PHI_TOL);
+        std::fprintf(fp, "end_time = %g\n", params->end_time);
+        std::fprintf(fp, "output_time = %g\n", params->output_time);
+    }
     std::fprintf(fp, "epsilon = %g\n", params->epsilon);
     std::fprintf(fp, "tau = %g\n", params->tau);
     std::fprintf(fp, "delta = %g\n", params->delta);
@@ -45,6 +52,7 @@ void writeParameters(const char *outfile, const SimParams *params) {
     std::fprintf(fp, "a = %g\n", params->a);
     std::fprintf(fp, "K = %g\n", params->K);
     std::fprintf(fp, "T_e = %g\n", params->T_e);
+    std::fprintf(fp, "noise_seed = %llu\n", (unsigned long long)params->noise_seed);
 
     // Fill definitions
     for (int i = 0; i < params->numVariables; ++i) {
@@ -129,6 +137,58 @@ void writeParameters(const char *outfile, const SimParams *params) {
     if (params->WRITE_TO_VTK)   std::fprintf(fp, "WRITE_TO_VTK = %d\n", params->WRITE_TO_VTK);
     if (params->WRITE_TO_CSV)   std::fprintf(fp, "WRITE_TO_CSV = %d\n", params->WRITE_TO_CSV);
 
+    // Kernel options
+    if (params->FUSED_KERNEL)   std::fprintf(fp, "FUSED_KERNEL = %d\n", params->FUSED_KERNEL);
+    if (params->ANISOTROPY_ENGINE == ANISOTROPY_ALGEBRAIC) std::fprintf(fp, "ANISOTROPY_ENGINE = ALGEBRAIC\n");
+    if (params->MATH_MODE == MATH_VECTOR) std::fprintf(fp, "MATH_MODE = VECTOR\n");
+    if (params->TEMP_SOLVER == TEMP_ADI)  std::fprintf(fp, "TEMP_SOLVER = ADI\n");
+    if (params->TEMP_SOLVER == TEMP_MULTIGRID) {
+        std::fprintf(fp, "TEMP_SOLVER = MULTIGRID\n");
+        std::fprintf(fp, "MG_THETA = %g\n", params->MG_THETA);
+    }
+    if (params->PHI_SOLVER == PHI_IMEX) {
+        std::fprintf(fp, "PHI_SOLVER = IMEX\n");
+        std::fprintf(fp, "IMEX_STAB = %g\n", params->IMEX_STAB);
+    }
+    if (params->TEMP_SOLVER == TEMP_MULTIGRID || params->PHI_SOLVER == PHI_IMEX) {
+        std::fprintf(fp, "MG_TOL = %g\n", params->MG_TOL);
+        std::fprintf(fp, "MG_MAX_CYCLES = %d\n", params->MG_MAX_CYCLES);
+    }
+    if (params->SPECTRAL)       std::fprintf(fp, "SPECTRAL = %d\n", params->SPECTRAL);
+    if (params->NARROW_BAND) {
+        std::fprintf(fp, "NARROW_BAND = %d\n", params->NARROW_BAND);
+        std::fprintf(fp, "NB_TOL = %g\n", params->NB_TOL);
+        std::fprintf(fp, "NB_MARGIN = %d\n", params->NB_MARGIN);
+    }
+    if (params->TILE_SKIP) {
+        std::fprintf(fp, "TILE_SKIP = %d\n", params->TILE_SKIP);
+        std::fprintf(fp, "TILE_SIZE = %d\n", params->TILE_SIZE);
+        std::fprintf(fp, "TILE_TOL = %g\n", params->TILE_TOL);
+        if (params->TILE_TOL > 0) std::fprintf(fp, "TILE_DRIFT = %g\n", params->TILE_DRIFT);
+    }
+    if (params->AMR) {
+        std::fprintf(fp, "AMR = %d\n", params->AMR);
+        std::fprintf(fp, "AMR_BLOCK = %d\n", params->AMR_BLOCK);
+        std::fprintf(fp, "AMR_PHI_TOL = %g\n", params->AMR_PHI_TOL);
+        std::fprintf(fp, "AMR_GRAD_TOL = %g\n", params->AMR_GRAD_TOL);
+    }
+    if (params->MOVING_WINDOW) {
+        std::fprintf(fp, "MOVING_WINDOW = %d\n", params->MOVING_WINDOW);
+        std::fprintf(fp, "WINDOW_TRIGGER = %g\n", params->WINDOW_TRIGGER);
+    }
+    if (params->LTS) {
+        std::fprintf(fp, "LTS = %d\n", params->LTS);
+        std::fprintf(fp, "LTS_LEVELS = %d\n", params->LTS_LEVELS);
+        std::fprintf(fp, "LTS_TOL = %g\n", params->LTS_TOL);
+        std::fprintf(fp, "TILE_SIZE = %d\n", params->TILE_SIZE);
+    }
+    if (params->BLOCK_STEPS)    std::fprintf(fp, "BLOCK_STEPS = %d\n", params->BLOCK_STEPS);
+    if (params->BLOCK_WIDTH)    std::fprintf(fp, "BLOCK_WIDTH = %d\n", params->BLOCK_WIDTH);
+
+    // Parallel options
+    if (params->NUM_THREADS)    std::fprintf(fp, "NUM_THREADS = %d\n", params->NUM_THREADS);
+    if (params->NUMA_REPORT)    std::fprintf(fp, "NUMA_REPORT = %d\n", params->NUMA_REPORT);
+
     // Close file
     std::fclose(fp);
 }
@@ -9,14 +9,15 @@
  * @brief Write field data to a CSV file.
  *
  * In 2D: writes lines "i,j,value" for each interior point.
- * In 3D: writes lines "i,j,k,value".
+ * In 3D: writes lines "i,j,k,value". With a moving window, i is the
+ * global column.
  *
  * @param filename Path for CSV output.
  * @param arr      Data array of size NX*NY*NZ.
  * @param params   Simulation parameters for dimensions.
  * @param strides  Strides for flattening: [NY*NZ, NZ, 1].
  */
-void write_output_csv(const char *filename, double *arr, const SimParams *params, int strides[]) {
+void write_output_csv(const char *filename, Real *arr, const SimParams *params, int strides[]) {
     FILE *fp = std::fopen(filename, "w");
     if (!fp) {
         std::fprintf(stderr, "Warning: Could not open file %s for writing CSV output.\n", filename);
@@ -29,15 +30,17 @@ void write_output_csv(const char *filename, double *arr, const SimParams *params
     int dim = params->DIM;
     int kstart = (dim == 3) ? 1 : 0;
     int kend   = (dim == 3) ? NZ - 1 : 1;
+    // Global x index of the first column of a moving window
+    long offset = params->window ? params->window->offset : 0;
 
     for (int i = 1; i < NX - 1; ++i) {
         for (int j = 1; j < NY - 1; ++j) {
             for (int k = kstart; k < kend; ++k) {
                 int idx = IDX(i, j, k);
                 if (dim == 2) {
-                    std::fprintf(fp, "%d,%d,%.8lf\n", i, j, arr[idx]);
+                    std::fprintf(fp, "%ld,%d,%.8lf\n", i + offset, j, arr[idx]);
                 } else {
-                    std::fprintf(fp, "%d,%d,%d,%.8lf\n", i, j, k, arr[idx]);
+                    std::fprintf(fp, "%ld,%d,%d,%.8lf\n", i + offset, j, k, arr[idx]);
                 }
             }
         }
@@ -49,13 +52,14 @@ void write_output_csv(const char *filename, double *arr, const SimParams *params
  * @brief Write field data to an ASCII VTK Structured Points file.
  *
  * Outputs header and then scalar values per point in row-major order.
+ * With a moving window, the origin is the x offset of the window.
  *
  * @param filename Path for VTK output.
  * @param arr      Data array of size NX*NY*NZ.
  * @param params   Simulation parameters for dimensions and spacing.
  * @param strides  Strides for flattening: [NY*NZ, NZ, 1].
  */
-void write_output_vtk(const char *filename, double *arr, const SimParams *params, int strides[]) {
+void write_output_vtk(const char *filename, Real *arr, const SimParams *params, int strides[]) {
     FILE *fp = std::fopen(filename, "w");
     if (!fp) {
         std::fprintf(stderr, "Error: Could not open %s for writing VTK output.\n", filename);
@@ -66,6 +70,8 @@ void write_output_vtk(const char *filename, double *arr, const SimParams *params
     int NY = params->Num_Y;
     int NZ = params->Num_Z;
     int dim = params->DIM;
+    // Origin of a moving window along x
+    double x0 = params->window ? params->window->offset * params->dx : 0.0;
 
     // VTK header
     std::fprintf(fp, "# vtk DataFile Version 3.0\n");
@@ -75,12 +81,12 @@ void write_output_vtk(const char *filename, double *arr, const SimParams *params
 
     if (dim == 2) {
         std::fprintf(fp, "DIMENSIONS %d %d 1\n", NX - 2, NY - 2);
-        std::fprintf(fp, "ORIGIN 0 0 0\n");
+        std::fprintf(fp, "ORIGIN %g 0 0\n", x0);
         std::fprintf(fp, "SPACING %g %g 1.0\n", params->dx, params->dy);
         std::fprintf(fp, "POINT_DATA %d\n", (NX - 2) * (NY - 2));
     } else {
         std::fprintf(fp, "DIMENSIONS %d %d %d\n", NX - 2, NY - 2, NZ - 2);
-        std::fprintf(fp, "ORIGIN 0 0 0\n");
+        std::fprintf(fp, "ORIGIN %g 0 0\n", x0);
         std::fprintf(fp, "SPACING %g %g %g\n", params->dx, params->dy, params->dz);
         std::fprintf(fp, "POINT_DATA %d\n", (NX - 2) * (NY - 2) * (NZ - 2));
     }
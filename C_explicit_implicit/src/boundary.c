@@ -8,15 +8,17 @@ void applyBoundaryConditions(double *arr, SimParams *params, int strides[], Face
 
     #define IDX(i, j, k) ((i) * strides[0] + (j) * strides[1] + (k) * strides[2])
 
+    // In 2D k only takes the value 0, for which IDX reduces to the 2D index
+    int kstart = (dim == 3) ? 1 : 0;
+    int kend   = (dim == 3) ? NZ - 1 : 1;
+
     // X-direction
     for (int j = 1; j < NY - 1; j++) {
-        int kstart = (dim == 3) ? 1 : 0;
-        int kend   = (dim == 3) ? NZ - 1 : 1;
         for (int k = kstart; k < kend; k++) {
-            int left_index  = (dim == 2) ? (0 * strides[0] + j * strides[1]) : IDX(0, j, k);
-            int right_index = (dim == 2) ? ((NX - 1) * strides[0] + j * strides[1]) : IDX(NX - 1, j, k);
-            int lref_index  = (dim == 2) ? (1 * strides[0] + j * strides[1]) : IDX(1, j, k);
-            int rref_index  = (dim == 2) ? ((NX - 2) * strides[0] + j * strides[1]) : IDX(NX - 2, j, k);
+            int left_index  = IDX(0, j, k);
+            int right_index = IDX(NX - 1, j, k);
+            int lref_index  = IDX(1, j, k);
+            int rref_index  = IDX(NX - 2, j, k);
 
             if (bc.left == BOUNDARY_PERIODIC)
                 arr[left_index] = arr[rref_index];
@@ -32,13 +34,11 @@ void applyBoundaryConditions(double *arr, SimParams *params, int strides[], Face
 
     // Y-direction
     for (int i = 1; i < NX - 1; i++) {
-        int kstart = (dim == 3) ? 1 : 0;
-        int kend   = (dim == 3) ? NZ - 1 : 1;
         for (int k = kstart; k < kend; k++) {
-            int bot_index  = (dim == 2) ? (i * strides[0] + 0 * strides[1]) : IDX(i, 0, k);
-            int top_index  = (dim == 2) ? (i * strides[0] + (NY - 1) * strides[1]) : IDX(i, NY - 1, k);
-            int bref_index = (dim == 2) ? (i * strides[0] + 1 * strides[1]) : IDX(i, 1, k);
-            int tref_index = (dim == 2) ? (i * strides[0] + (NY - 2) * strides[1]) : IDX(i, NY - 2, k);
+            int bot_index  = IDX(i, 0, k);
+            int top_index  = IDX(i, NY - 1, k);
+            int bref_index = IDX(i, 1, k);
+            int tref_index = IDX(i, NY - 2, k);
 
             if (bc.bottom == BOUNDARY_PERIODIC)
                 arr[bot_index] = arr[tref_index];
@@ -15,7 +15,8 @@
 //-----------------------------------------------------------------------------
 #define MAX_VAR_NAME 32      // Maximum length for variable names.
 #define MAX_VARIABLES 10     // Maximum number of variables supported (can be increased dynamically as needed).
-#define MAX_DIM  3           // Maximum spatial dimensions     
+#define MAX_DIM  3           // Maximum spatial dimensions
+#define TRI_LANES 8          // Lines solved together by the ADI tridiagonal solver (one per SIMD lane)     
 
 /*--------------------------------------------------------------
  * Enum to represent boundary & filling type.
@@ -78,7 +79,8 @@ typedef struct {
 
 typedef struct {
     char varName[MAX_VAR_NAME];
-    double *dataArray;  // Pointer to the variable's data
+    double *dataArray;  // Pointer to the variable's current data
+    double *nextArray;  // Data written by the next time step; swapped with dataArray
     size_t dataSize;    // Optionally, store the size (number of elements) in the array
 } VariableData;
 
@@ -123,8 +125,8 @@ typedef struct SimParams{
 //-----------------------------------------------------------------------------
 
 typedef struct FieldBuffers{
-  double *phi_new;
-  double *temp_new;
+  double *phi_new;      // next generation of phi (not owned)
+  double *temp_new;     // next generation of temp (not owned)
   double *dphi_dt;
   double *dfdphi;
   double *ac;
@@ -149,6 +151,10 @@ typedef struct FieldBuffers{
   double *DERX_bottom;
   double *temp_buf1;
   double *temp_buf2;
+  double *tri_cp;         // ADI: super-diagonal factors of the current sweep
+  double *tri_m;          // ADI: pivots of the current sweep
+  double *tri_tile;       // ADI: one tile of TRI_LANES interleaved lines per thread
+  size_t tri_tile_size;   // elements per thread tile
 } FieldBuffers;
 
 
@@ -186,8 +192,10 @@ void trim(char *str);
 void setupVariables(SimParams *params);
 static double *alloc3(int NX, int NY, int NZ);
 void freeGlobalVariableArrays(void);
-void addVariableData(const char* varName, double *array, size_t dataSize);
+void addVariableData(const char* varName, double *array, double *next, size_t dataSize);
 double* getDataArray(const char* varName);    
+double* getNextDataArray(const char* varName);
+void swapDataArrays(void);
 VariableBoundary* findVariableBoundary(const char *name, SimParams *params);
 
 /*--------------------------------------------------------------
@@ -207,7 +215,6 @@ void computedfdphi(double *phi, double *dfdphi, double *temp, SimParams *params,
 void updatePhi(double *phi, FieldBuffers *fb, SimParams *params, double r[], int strides[]);
 void computeGradientPhi(double *phi, FieldBuffers *fb, SimParams *params, double r[], int strides[]); 
 void computeAnisotropy(FieldBuffers *fb, SimParams *params, int strides[]);     
-void copyInterior(double *dst, double *src, SimParams *params, int strides[]);
 
                  
 
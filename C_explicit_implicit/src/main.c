@@ -88,6 +88,9 @@ int main(int argc, char *argv[]) {
 
     FieldBuffers fb;
     allocateFieldBuffers(&params, &fb);
+    // The updates write into the next generation of phi and temp
+    fb.phi_new  = getNextDataArray("phi");
+    fb.temp_new = getNextDataArray("temp");
 
 
     
@@ -169,10 +172,13 @@ int main(int argc, char *argv[]) {
         updateTemp(temp, &fb, &params, strides, r2); 
 
 
-        /* g) Copy phi_new back to phi */
-        copyInterior(phi, fb.phi_new, &params, strides);
-        /* h) Copy temp_new back to temp */
-        copyInterior(temp, fb.temp_new, &params, strides);
+        /* g) Swap generations: the new fields become the current ones;
+              their ghost cells are refilled by the BCs of the next step */
+        swapDataArrays();
+        phi  = getDataArray("phi");
+        temp = getDataArray("temp");
+        fb.phi_new  = getNextDataArray("phi");
+        fb.temp_new = getNextDataArray("temp");
 
         
         /* f) Periodic output */
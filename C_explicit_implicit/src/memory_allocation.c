@@ -1,4 +1,5 @@
 #include "header.h"
+#include <omp.h>
 
 double *allocate_vector(int Num_X, int Num_Y, int Num_Z) {
     double *arr = (double *)malloc((Num_X * Num_Y * Num_Z) * sizeof(double));
@@ -24,10 +25,10 @@ static double *alloc3(int NX, int NY, int NZ) {
     return ptr;
 }
 
+// phi_new and temp_new are not allocated here: they point at the next
+// generation of the registered variables (getNextDataArray).
 void allocateFieldBuffers(const SimParams *params, FieldBuffers *fb) {
   int NX=params->Num_X, NY=params->Num_Y, NZ=params->Num_Z;
-  fb->phi_new      = alloc3(NX,NY,NZ);
-  fb->temp_new     = alloc3(NX,NY,NZ);
   fb->dphi_dt      = alloc3(NX,NY,NZ);
   fb->dfdphi       = alloc3(NX,NY,NZ);
   fb->ac           = alloc3(NX,NY,NZ);
@@ -52,11 +53,16 @@ void allocateFieldBuffers(const SimParams *params, FieldBuffers *fb) {
   fb->DERX_bottom  = alloc3(NX,NY,NZ);
   fb->temp_buf1    = alloc3(NX,NY,NZ);
   fb->temp_buf2    = alloc3(NX,NY,NZ);
+  // ADI workspaces: factors for the longer of the two sweeps and one tile
+  // of interleaved Y lines per thread
+  int M = (NX > NY) ? NX : NY;
+  fb->tri_cp        = alloc3(M,1,1);
+  fb->tri_m         = alloc3(M,1,1);
+  fb->tri_tile_size = (size_t)TRI_LANES * NY;
+  fb->tri_tile      = alloc3(omp_get_max_threads(),TRI_LANES,NY);
 }
 
 void freeFieldBuffers(FieldBuffers *fb) {
-  free_vector(fb->phi_new);
-  free_vector(fb->temp_new);
   free_vector(fb->dphi_dt);
   free_vector(fb->dfdphi);
   free_vector(fb->ac);
@@ -81,6 +87,9 @@ void freeFieldBuffers(FieldBuffers *fb) {
   free_vector(fb->DERX_bottom);
   free_vector(fb->temp_buf1);
   free_vector(fb->temp_buf2);
+  free_vector(fb->tri_cp);
+  free_vector(fb->tri_m);
+  free_vector(fb->tri_tile);
 }
 
 
@@ -91,24 +100,32 @@ VariableData globalVars[MAX_VARIABLES];
 int numGlobalVars = 0;
 
 
+/*
+ * Allocates both generations of each variable. They start zeroed so that the
+ * ghost cells the boundary routine never writes agree in both.
+ */
 void setupVariables(SimParams *params) {
     int totalElements;
-    double *data;
+    double *data, *next;
     for (int i = 0; i < params->numVariables; i++) {
         char *varName = params->variables[i].varName;
         totalElements = params->Num_X * params->Num_Y * params->Num_Z;
         data = allocate_vector(params->Num_X, params->Num_Y, params->Num_Z);
-        addVariableData(varName, data, totalElements);
+        next = allocate_vector(params->Num_X, params->Num_Y, params->Num_Z);
+        memset(data, 0, totalElements * sizeof(double));
+        memset(next, 0, totalElements * sizeof(double));
+        addVariableData(varName, data, next, totalElements);
     }
 }
 
 /*
- * Registers a variable and its data array into the global mapping.
+ * Registers a variable and its two data arrays into the global mapping.
  * varName: name of the variable
- * array: pointer to the data array
+ * array: pointer to the current data array
+ * next: pointer to the array the next time step writes into
  * dataSize: the number of elements in the array (optional, can be used later)
  */
-void addVariableData(const char* varName, double *array, size_t dataSize) {
+void addVariableData(const char* varName, double *array, double *next, size_t dataSize) {
     if (numGlobalVars >= MAX_VARIABLES) {
         fprintf(stderr, "Error: Exceeded maximum number of variables (%d).\n", MAX_VARIABLES);
         return;
@@ -117,6 +134,7 @@ void addVariableData(const char* varName, double *array, size_t dataSize) {
     strncpy(globalVars[numGlobalVars].varName, varName, MAX_VAR_NAME - 1);
     globalVars[numGlobalVars].varName[MAX_VAR_NAME - 1] = '\0';
     globalVars[numGlobalVars].dataArray = array;
+    globalVars[numGlobalVars].nextArray = next;
     globalVars[numGlobalVars].dataSize = dataSize;
     numGlobalVars++;
 }
@@ -135,6 +153,32 @@ double* getDataArray(const char* varName) {
     return NULL;
 }
 
+/*
+ * Returns the array the next time step of the given variable writes into.
+ * If the variable is not found, returns NULL.
+ */
+double* getNextDataArray(const char* varName) {
+    for (int i = 0; i < numGlobalVars; i++) {
+        if (strcmp(globalVars[i].varName, varName) == 0) {
+            return globalVars[i].nextArray;
+        }
+    }
+    fprintf(stderr, "Warning: Variable '%s' not found.\n", varName);
+    return NULL;
+}
+
+/*
+ * End of a time step: the next generation of every variable becomes the
+ * current one, and the old current one is overwritten by the next step.
+ */
+void swapDataArrays(void) {
+    for (int i = 0; i < numGlobalVars; i++) {
+        double *tmp = globalVars[i].dataArray;
+        globalVars[i].dataArray = globalVars[i].nextArray;
+        globalVars[i].nextArray = tmp;
+    }
+}
+
 VariableBoundary* findVariableBoundary(const char *name, SimParams *params) {
     for (int i = 0; i < params->numVariables; i++) {
         if (strcmp(params->variables[i].varName, name) == 0) {
@@ -148,7 +192,9 @@ VariableBoundary* findVariableBoundary(const char *name, SimParams *params) {
 void freeGlobalVariableArrays(void) {
     for (int i = 0; i < numGlobalVars; i++) {
         free(globalVars[i].dataArray);
+        free(globalVars[i].nextArray);
         globalVars[i].dataArray = NULL;  // Optional: clear pointer after free.
+        globalVars[i].nextArray = NULL;
     }
     numGlobalVars = 0;  // Optionally reset the count.
 }
@@ -39,19 +39,4 @@ void updatePhi(double *phi, FieldBuffers *fb, SimParams *params, double r[], int
      				
 }
 
-void copyInterior(double *dst, double *src, SimParams *params, int strides[]) {
-    int NX = params->Num_X;
-    int NY = params->Num_Y;
-    int NZ = params->Num_Z;
-    int dim = params->DIM;
-
-        for (int i = 1; i < NX - 1; i++) {
-            for (int j = 1; j < NY - 1; j++) {
-                int index = IDX(i, j, 0);
-                dst[index] = src[index];
-            }
-        }
-    
-}
-
 #undef IDX
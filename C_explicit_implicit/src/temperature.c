@@ -1,4 +1,5 @@
 #include "header.h"
+#include <omp.h>
 
 #define IDX(i,j,k) ((i)*strides[0] + (j)*strides[1] + (k)*strides[2])
 
@@ -13,85 +14,117 @@ static inline double lapY(double *field, int i, int j, int *strides) {
 }
 
 
-// Solve tridiagonal system a*x_{k-1} + b*x_k + c*x_{k+1} = d_k of size M
-static void thomas(int M, double *a, double *b, double *c, double *d, double *x) {
-    double *c_prime = malloc(M * sizeof(double));
-    double *d_prime = malloc(M * sizeof(double));
-    c_prime[0] = c[0] / b[0];
-    d_prime[0] = d[0] / b[0];
+/*
+ * Tridiagonal engine of the ADI sweeps. Every line of a sweep solves the
+ * same system -r x_{p-1} + (1+2r) x_p - r x_{p+1} = d_p of size M, so the
+ * system is factored once per sweep and the lines only run the forward
+ * and backward recurrences. TRI_LANES lines are solved together, one per
+ * SIMD lane, with the recurrence running over the lines in the inner loop;
+ * the bundles are shared out across threads. All workspaces live in
+ * FieldBuffers, so a step does no allocation.
+ */
+
+// Factor the system of size M with the Neumann adjustments of the first and
+// last rows: cp[p] = c'_p and m[p] the pivot of row p
+static void factorTridiagonal(int M, double r, double *cp, double *m) {
+    const double a = -r, c = -r;
+    double b_first = 1.0 + 2.0*r;
+    double b_last  = 1.0 + 2.0*r;
+    b_first -= a;
+    if (M == 1) b_first -= c;
+    else        b_last  -= c;
+
+    m[0]  = b_first;
+    cp[0] = c / m[0];
     for (int p = 1; p < M; p++) {
-        double m = b[p] - a[p] * c_prime[p - 1];
-        c_prime[p] = c[p] / m;
-        d_prime[p] = (d[p] - a[p] * d_prime[p - 1]) / m;
+        double b = (p == M - 1) ? b_last : 1.0 + 2.0*r;
+        m[p]  = b - a * cp[p - 1];
+        cp[p] = c / m[p];
+    }
+}
+
+// Solve the factored system on `width` lines in place: line q holds its
+// right-hand side at x[q + p*stride], p = 0..M-1, and receives the solution
+static void solveBatch(int M, double r, const double *cp, const double *m,
+                       double *x, int stride, int width) {
+    const double a = -r;
+    #pragma omp simd
+    for (int q = 0; q < width; q++) {
+        x[q] = x[q] / m[0];
+    }
+    for (int p = 1; p < M; p++) {
+        double *xp = x + (size_t)p * stride;
+        const double *xm = xp - stride;
+        const double mp = m[p];
+        #pragma omp simd
+        for (int q = 0; q < width; q++) {
+            xp[q] = (xp[q] - a * xm[q]) / mp;
+        }
     }
-    x[M - 1] = d_prime[M - 1];
     for (int p = M - 2; p >= 0; p--) {
-        x[p] = d_prime[p] - c_prime[p] * x[p + 1];
+        double *xp = x + (size_t)p * stride;
+        const double *xn = xp + stride;
+        const double cpp = cp[p];
+        #pragma omp simd
+        for (int q = 0; q < width; q++) {
+            xp[q] = xp[q] - cpp * xn[q];
+        }
     }
-    free(c_prime);
-    free(d_prime);
 }
 
-// ADI step 1: implicit in X, explicit in Y using discrete Laplacians
+// ADI step 1: implicit in X, explicit in Y using discrete Laplacians.
+// The X lines of TRI_LANES neighbouring rows j are adjacent in memory and
+// are solved in place in out.
 static void adi_step1_X(int NX, int NY, double rx, double ry,
-                        double *in, double *out, int strides[]) {
+                        double *in, double *out, int strides[], FieldBuffers *fb) {
     int M = NX - 2;  // system size
-    double *a = malloc(M * sizeof(double));
-    double *b = malloc(M * sizeof(double));
-    double *c = malloc(M * sizeof(double));
-    double *d = malloc(M * sizeof(double));
-    double *x = malloc(M * sizeof(double));
-
-    for (int j = 1; j < NY - 1; j++) {
-        // build tridiagonal for row j
-        for (int i = 1; i < NX - 1; i++) {
-            int k = i - 1;
-            a[k] = -rx;
-            b[k] = 1.0 + 2.0*rx;
-            c[k] = -rx;
-            d[k] = in[IDX(i,j,0)] + ry * lapY(in, i, j, strides);
-        }
-        // Neumann BC adjustments
-        b[0]     -= a[0];
-        b[M - 1] -= c[M - 1];
-        thomas(M, a, b, c, d, x);
-        // write back solution
+    int bundles = (NY - 2 + TRI_LANES - 1) / TRI_LANES;
+    factorTridiagonal(M, rx, fb->tri_cp, fb->tri_m);
+
+    #pragma omp parallel for schedule(static)
+    for (int n = 0; n < bundles; n++) {
+        int j0 = 1 + n * TRI_LANES;
+        int width = (NY - 1 - j0 < TRI_LANES) ? NY - 1 - j0 : TRI_LANES;
+        // right-hand sides of the bundle
         for (int i = 1; i < NX - 1; i++) {
-            out[IDX(i,j,0)] = x[i - 1];
+            for (int j = j0; j < j0 + width; j++) {
+                out[IDX(i,j,0)] = in[IDX(i,j,0)] + ry * lapY(in, i, j, strides);
+            }
         }
+        solveBatch(M, rx, fb->tri_cp, fb->tri_m, out + IDX(1,j0,0), strides[0], width);
     }
-    free(a); free(b); free(c); free(d); free(x);
 }
 
-// ADI step 2: implicit in Y, explicit in X using discrete Laplacians
+// ADI step 2: implicit in Y, explicit in X using discrete Laplacians.
+// The Y lines are contiguous, so TRI_LANES of them are transposed into the
+// thread's tile (one line per lane), solved there and transposed back.
 static void adi_step2_Y(int NX, int NY, double rx, double ry,
-                        double *in, double *out, int strides[]) {
+                        double *in, double *out, int strides[], FieldBuffers *fb) {
     int M = NY - 2;
-    double *a = malloc(M * sizeof(double));
-    double *b = malloc(M * sizeof(double));
-    double *c = malloc(M * sizeof(double));
-    double *d = malloc(M * sizeof(double));
-    double *x = malloc(M * sizeof(double));
-
-    for (int i = 1; i < NX - 1; i++) {
-        // build tridiagonal for column i
-        for (int j = 1; j < NY - 1; j++) {
-            int p = j - 1;
-            a[p] = -ry;
-            b[p] = 1 + 2*ry;
-            c[p] = -ry;
-            d[p] = in[IDX(i,j,0)] + rx * lapX(in, i, j, strides);
+    int bundles = (NX - 2 + TRI_LANES - 1) / TRI_LANES;
+    factorTridiagonal(M, ry, fb->tri_cp, fb->tri_m);
+
+    #pragma omp parallel for schedule(static)
+    for (int n = 0; n < bundles; n++) {
+        double *tile = fb->tri_tile + (size_t)omp_get_thread_num() * fb->tri_tile_size;
+        int i0 = 1 + n * TRI_LANES;
+        int width = (NX - 1 - i0 < TRI_LANES) ? NX - 1 - i0 : TRI_LANES;
+        // gather the right-hand sides, one column i per lane
+        for (int q = 0; q < width; q++) {
+            int i = i0 + q;
+            for (int j = 1; j < NY - 1; j++) {
+                tile[(j - 1) * TRI_LANES + q] = in[IDX(i,j,0)] + rx * lapX(in, i, j, strides);
+            }
         }
-        // Neumann BC adjustments
-        b[0]     -= a[0];
-        b[M - 1] -= c[M - 1];
-        thomas(M, a, b, c, d, x);
+        solveBatch(M, ry, fb->tri_cp, fb->tri_m, tile, TRI_LANES, width);
         // write back solution
-        for (int j = 1; j < NY - 1; j++) {
-            out[IDX(i,j,0)] = x[j - 1];
+        for (int q = 0; q < width; q++) {
+            int i = i0 + q;
+            for (int j = 1; j < NY - 1; j++) {
+                out[IDX(i,j,0)] = tile[(j - 1) * TRI_LANES + q];
+            }
         }
     }
-    free(a); free(b); free(c); free(d); free(x);
 }
 
 void updateTemp(double *T, FieldBuffers *fb, SimParams *params, int strides[], double r2[]) {
@@ -129,7 +162,7 @@ void updateTemp(double *T, FieldBuffers *fb, SimParams *params, int strides[], d
     }
 
 
-    adi_step1_X(NX, NY, rx, ry, T1, T2, strides);
+    adi_step1_X(NX, NY, rx, ry, T1, T2, strides, fb);
 
          
     if (vb_temp) {
@@ -144,18 +177,9 @@ void updateTemp(double *T, FieldBuffers *fb, SimParams *params, int strides[], d
         }
     }
     //applyTemperatureBC(T2, params, strides);
-    adi_step2_Y(NX, NY, rx, ry, T2, T1, strides);
-    if (vb_temp) {
-       applyBoundaryConditions(T1, params, strides, vb_temp->bc);
-    }
-    
-
-    for (int i = 1; i < NX - 1; i++) {
-        for (int j = 1; j < NY - 1; j++) {
-            int index = IDX(i, j, 0);
-            Tn[index] = T1[index];
-        }
-    }
+    // the second half-step writes the next generation directly; its ghost
+    // cells are refilled when it becomes the current one
+    adi_step2_Y(NX, NY, rx, ry, T2, Tn, strides, fb);
         
 }
 